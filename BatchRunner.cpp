@@ -0,0 +1,401 @@
+#include "BatchRunner.h"
+
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+#include "MemoryAccounting.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+using json = nlohmann::json;
+
+namespace {
+    // Results are collected here and written in large blocks.
+    constexpr std::size_t kFlushBytes = 64 * 1024;
+
+    const char* const kOps[] = {
+        "add", "update", "remove", "stock-in", "stock-out", "stock-batch", "find", "search", "query", "count", "checkpoint", "metrics", "memory"
+    };
+
+    // A trace span keeps only a pointer to its name; unknown ops get none.
+    const char* knownOp(const std::string& op) {
+        for (const char* known : kOps)
+            if (op == known)
+                return known;
+        return nullptr;
+    }
+
+    // Command text is not checked for UTF-8; bytes that are not valid UTF-8
+    // come out as U+FFFD instead of failing the whole result line.
+    std::string dumpResult(const json& r) {
+        return r.dump(-1, ' ', false, json::error_handler_t::replace);
+    }
+
+    struct Command {
+        std::string op;
+        std::string serial;
+        std::string term;
+        long long amount = 0;
+        bool hasAmount = false;
+        json product;
+        json lines;
+    };
+
+    std::string nextToken(const std::string& line, std::size_t& at) {
+        while (at < line.size() && (line[at] == ' ' || line[at] == '\t'))
+            at++;
+        std::size_t start = at;
+        while (at < line.size() && line[at] != ' ' && line[at] != '\t')
+            at++;
+        return line.substr(start, at - start);
+    }
+
+    std::string rest(const std::string& line, std::size_t at) {
+        while (at < line.size() && (line[at] == ' ' || line[at] == '\t'))
+            at++;
+        std::size_t end = line.size();
+        while (end > at && (line[end - 1] == ' ' || line[end - 1] == '\t' || line[end - 1] == '\r'))
+            end--;
+        return line.substr(at, end - at);
+    }
+
+    bool parseAmount(const std::string& text, long long& amount) {
+        try {
+            std::size_t used = 0;
+            amount = std::stoll(text, &used);
+            return used == text.size();
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    bool parseText(const std::string& line, Command& command, std::string& error) {
+        std::size_t at = 0;
+        command.op = nextToken(line, at);
+
+        if (command.op == "add") {
+            command.product = json::parse(rest(line, at), nullptr, false);
+        }
+        else if (command.op == "update") {
+            command.serial = nextToken(line, at);
+            command.product = json::parse(rest(line, at), nullptr, false);
+        }
+        else if (command.op == "stock-in" || command.op == "stock-out") {
+            command.serial = nextToken(line, at);
+            command.hasAmount = parseAmount(nextToken(line, at), command.amount);
+            if (!command.hasAmount) {
+                error = "invalid amount";
+                return false;
+            }
+        }
+        else if (command.op == "stock-batch") {
+            command.lines = json::parse(rest(line, at), nullptr, false);
+        }
+        else if (command.op == "search" || command.op == "query" || command.op == "count") {
+            command.term = rest(line, at);
+        }
+        else if (command.op == "remove" || command.op == "find") {
+            command.serial = nextToken(line, at);
+        }
+        return true;
+    }
+
+    bool parseJson(const std::string& line, Command& command, std::string& error) {
+        json j = json::parse(line, nullptr, false);
+        if (j.is_discarded() || !j.is_object()) {
+            error = "invalid JSON";
+            return false;
+        }
+
+        try {
+            command.op = j.value("op", "");
+            command.serial = j.value("serial", "");
+            command.term = j.value("term", "");
+            if (j.contains("amount")) {
+                if (!j["amount"].is_number_integer()) {
+                    error = "invalid amount";
+                    return false;
+                }
+                command.amount = j["amount"].get<long long>();
+                command.hasAmount = true;
+            }
+            if (j.contains("product"))
+                command.product = j["product"];
+            if (j.contains("lines"))
+                command.lines = j["lines"];
+        }
+        catch (...) {
+            error = "invalid field type";
+            return false;
+        }
+        return true;
+    }
+
+    // [{"serial":"SN1","delta":5},{"serial":"SN2","delta":-2}]: a positive
+    // delta is a stock-in, a negative one a stock-out. A zero delta is kept
+    // and refused by applyBatch as an invalid amount.
+    bool parseStockLines(const json& lines, std::vector<StockOperation>& operations, std::string& error) {
+        if (!lines.is_array() || lines.empty()) {
+            error = "expected a JSON array of {serial, delta}";
+            return false;
+        }
+
+        operations.reserve(lines.size());
+        for (std::size_t i = 0; i < lines.size(); i++) {
+            const json& l = lines[i];
+            if (!l.is_object() || !l.contains("serial") || !l["serial"].is_string() ||
+                !l.contains("delta") || !l["delta"].is_number_integer()) {
+                error = "invalid batch line " + std::to_string(i + 1);
+                return false;
+            }
+
+            long long delta = l["delta"].get<long long>();
+            if (delta > std::numeric_limits<int>::max() || delta < -static_cast<long long>(std::numeric_limits<int>::max())) {
+                error = "invalid amount on batch line " + std::to_string(i + 1);
+                return false;
+            }
+            operations.push_back({ delta < 0 ? StockOperation::Out : StockOperation::In,
+                l["serial"].get<std::string>(), static_cast<int>(delta < 0 ? -delta : delta) });
+        }
+        return true;
+    }
+
+    const char* statusName(StockLineStatus status) {
+        switch (status) {
+        case StockLineStatus::Ok: return "ok";
+        case StockLineStatus::NotFound: return "product not found";
+        case StockLineStatus::InvalidAmount: return "invalid amount";
+        case StockLineStatus::InsufficientStock: return "not enough quantity";
+        }
+        return "unknown";
+    }
+}
+
+BatchRunner::BatchRunner(Inventory& inventory, const std::string& snapshotFile)
+    : inventory(inventory), snapshotFile(snapshotFile) {
+}
+
+// ===================== RUN =====================
+
+BatchSummary BatchRunner::run(std::istream& in, std::ostream& out) {
+    Trace::Span span("batch", "batch");
+    auto started = std::chrono::steady_clock::now();
+    BatchSummary summary;
+
+    std::string buffer;
+    buffer.reserve(kFlushBytes * 2);
+
+    std::string line;
+    std::string result;
+    std::size_t lineNumber = 0;
+
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        summary.commands++;
+        if (execute(line.substr(first), lineNumber, result))
+            summary.succeeded++;
+        else
+            summary.failed++;
+
+        buffer += result;
+        buffer += '\n';
+        if (buffer.size() >= kFlushBytes) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    span.arg("commands", summary.commands);
+    span.arg("failed", summary.failed);
+    return summary;
+}
+
+// ===================== COMMANDS =====================
+
+// A command that throws fails its own line only; the lines before it keep
+// their results and the ones after it still run.
+bool BatchRunner::execute(const std::string& line, std::size_t lineNumber, std::string& result) const {
+    try {
+        return executeCommand(line, lineNumber, result);
+    }
+    catch (const std::exception& e) {
+        json r;
+        r["line"] = lineNumber;
+        r["ok"] = false;
+        r["error"] = std::string("internal error: ") + e.what();
+        result = dumpResult(r);
+        return false;
+    }
+}
+
+// Command and result documents are charged to the JSON DOM; productFromJson
+// charges the products it builds to the products.
+bool BatchRunner::executeCommand(const std::string& line, std::size_t lineNumber, std::string& result) const {
+    MemoryAccounting::Scope memory(MemorySubsystem::JsonDom);
+    Command command;
+    std::string error;
+    bool parsed = line[0] == '{' ? parseJson(line, command, error) : parseText(line, command, error);
+
+    const char* known = knownOp(command.op);
+    Trace::Span span(known ? known : "unknown", "batch");
+    span.arg("line", lineNumber);
+
+    json r;
+    r["line"] = lineNumber;
+    if (known)
+        r["op"] = known;
+
+    auto fail = [&](const std::string& why) {
+        r["ok"] = false;
+        r["error"] = why;
+        result = dumpResult(r);
+        return false;
+    };
+
+    if (!parsed)
+        return fail(error);
+
+    // A refused journal write is the reason whenever the journal is failing.
+    auto failChange = [&](const std::string& why) {
+        return fail(inventory.journalFailed() ? "journal write failed" : why);
+    };
+
+    if (!known)
+        return fail(command.op.empty() ? "missing op" : "unknown op");
+
+    const std::string& op = command.op;
+
+    if (op == "add" || op == "update") {
+        if (command.product.is_discarded() || !command.product.is_object())
+            return fail("invalid product JSON");
+
+        if (op == "add") {
+            auto product = Inventory::productFromJson(command.product);
+            if (!product)
+                return fail("invalid product");
+            if (!inventory.addProduct(product))
+                return failChange("duplicate or empty serial");
+            r["serial"] = product->getSerialNumber();
+        }
+        else {
+            if (!inventory.serialExists(command.serial))
+                return fail("product not found");
+            if (!inventory.updateProductFromJson(command.serial, command.product))
+                return failChange("invalid product or serial taken");
+            r["serial"] = command.serial;
+        }
+    }
+    else if (op == "remove") {
+        if (!inventory.removeProductBySerial(command.serial))
+            return failChange("product not found");
+        r["serial"] = command.serial;
+    }
+    else if (op == "stock-in" || op == "stock-out") {
+        if (!command.hasAmount || command.amount <= 0 || command.amount > std::numeric_limits<int>::max())
+            return fail("amount must be > 0");
+
+        const int amount = static_cast<int>(command.amount);
+        const bool in = op == "stock-in";
+        if (!(in ? inventory.stockIn(command.serial, amount) : inventory.stockOut(command.serial, amount))) {
+            auto product = inventory.findBySerial(command.serial);
+            if (!product)
+                return fail("product not found");
+            r["available"] = product->getQuantity();
+            return failChange(in ? "quantity would overflow" : "not enough quantity");
+        }
+
+        r["serial"] = command.serial;
+        if (auto product = inventory.findBySerial(command.serial))
+            r["quantity"] = product->getQuantity();
+    }
+    else if (op == "stock-batch") {
+        std::vector<StockOperation> operations;
+        std::string why;
+        if (!parseStockLines(command.lines, operations, why))
+            return fail(why);
+
+        // All lines or none: a single refused line leaves every quantity as it was.
+        BatchResult batch = inventory.applyBatch(operations);
+        json lines = json::array();
+        for (StockLineStatus status : batch.lines)
+            lines.push_back(statusName(status));
+        r["lines"] = std::move(lines);
+
+        if (batch.journalFailed)
+            return fail("journal write failed");
+        if (!batch.applied)
+            return fail(std::to_string(batch.failedLines()) + " of " + std::to_string(operations.size()) + " lines refused");
+    }
+    else if (op == "find") {
+        auto product = inventory.findBySerial(command.serial);
+        if (!product)
+            return fail("product not found");
+        r["product"] = product->toJson();
+    }
+    else if (op == "search") {
+        if (command.term.empty())
+            return fail("empty search term");
+
+        auto matches = inventory.searchByName(command.term);
+        json serials = json::array();
+        for (std::size_t i = 0; i < matches.size() && i < kMaxListed; i++)
+            serials.push_back(matches[i]->getSerialNumber());
+
+        r["count"] = matches.size();
+        r["serials"] = std::move(serials);
+        if (matches.size() > kMaxListed)
+            r["truncated"] = true;
+    }
+    else if (op == "query") {
+        ProductQuery query;
+        std::string why;
+        if (!ProductQuery::parse(command.term, query, why))
+            return fail("invalid query: " + why);
+
+        QueryResult matches = inventory.query(query);
+        json serials = json::array();
+        for (std::size_t i = 0; i < matches.products.size() && i < kMaxListed; i++)
+            serials.push_back(matches.products[i]->getSerialNumber());
+
+        r["count"] = matches.products.size();
+        r["serials"] = std::move(serials);
+        if (matches.products.size() > kMaxListed)
+            r["truncated"] = true;
+        r["plan"] = matches.plan;
+    }
+    else if (op == "count") {
+        ProductQuery query;
+        std::string why;
+        if (!ProductQuery::parse(command.term, query, why))
+            return fail("invalid query: " + why);
+
+        QueryCount matches = inventory.countMatching(query);
+        r["count"] = matches.count;
+        r["plan"] = matches.plan;
+    }
+    else if (op == "checkpoint") {
+        if (!inventory.checkpoint(snapshotFile))
+            return fail("checkpoint failed");
+    }
+    else if (op == "metrics") {
+        r["metrics"] = Metrics::toJson();
+    }
+    else if (op == "memory") {
+        r["memory"] = MemoryAccounting::toJson(inventory.memoryUsage());
+    }
+
+    r["ok"] = true;
+    result = dumpResult(r);
+    return true;
+}
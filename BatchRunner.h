@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "Inventory.h"
+
+struct BatchSummary {
+    std::size_t commands = 0;
+    std::size_t succeeded = 0;
+    std::size_t failed = 0;
+    double seconds = 0.0;
+};
+
+// Headless counterpart of ConsoleMenu: reads one command per line and
+// writes one compact JSON result line per command. A line is either text
+//
+//   add {product json}            update <serial> {product json}
+//   remove <serial>               find <serial>
+//   stock-in <serial> <amount>    search <name term>
+//   stock-out <serial> <amount>   checkpoint
+//   query <filter expression>     count <filter expression>
+//   metrics                       memory
+//   stock-batch [{"serial":<serial>,"delta":<+in/-out>}, ...]
+//
+// or a JSON object such as {"op":"stock-in","serial":"SN1","amount":5};
+// product commands carry the product under "product", search, query and
+// count their text under "term", stock-batch its array under "lines". A
+// stock-batch is applied and journaled as one record, or not at all.
+// Blank lines and lines starting with '#' are skipped.
+class BatchRunner {
+public:
+    // `snapshotFile` is where the "checkpoint" command writes.
+    BatchRunner(Inventory& inventory, const std::string& snapshotFile);
+
+    BatchSummary run(std::istream& in, std::ostream& out);
+
+    // One command line (without its newline) to one result line; false when
+    // the command failed. Safe to call from several threads at once, and
+    // never throws: a command that does fails with "internal error".
+    bool execute(const std::string& line, std::size_t lineNumber, std::string& result) const;
+
+private:
+    bool executeCommand(const std::string& line, std::size_t lineNumber, std::string& result) const;
+
+    Inventory& inventory;
+    std::string snapshotFile;
+
+    // Search results listed in full up to this many serials.
+    static constexpr std::size_t kMaxListed = 50;
+};
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "Inventory.h"
+#include "ProcessStats.h"
+#include "ProductGenerator.h"
+#include "ProductRenderer.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// Self-contained benchmark of Inventory's hot paths over synthetic
+// catalogs. Prints one JSON document so runs can be diffed over time.
+
+struct BenchOptions {
+    std::vector<std::size_t> sizes = { 1000, 100000, 1000000 };
+    std::uint64_t maxOps = 200000;
+    double budgetSeconds = 2.0;
+    std::uint64_t seed = 42;
+    std::string outFile;
+    std::string workDir = ".";
+};
+
+// How many distinct inputs each operation cycles through.
+static const std::size_t kInputPool = 4096;
+
+// Swallows output, so rendering is timed without a terminal behind it.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+static double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    std::size_t at = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(at, sorted.size() - 1)];
+}
+
+// Runs op(i) until maxOps calls or the time budget, timing each call.
+template <typename F>
+static json measure(const std::string& operation, std::size_t products, std::uint64_t maxOps, double budgetSeconds, F&& op) {
+    std::cerr << "  " << operation << "..." << std::flush;
+
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(maxOps, 1u << 20)));
+
+    const auto started = Clock::now();
+    const auto deadline = started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budgetSeconds));
+    std::uint64_t ops = 0;
+
+    while (ops < maxOps) {
+        const auto before = Clock::now();
+        op(ops);
+        const auto after = Clock::now();
+        latencies.push_back(std::chrono::duration<double, std::micro>(after - before).count());
+        ops++;
+        if (after >= deadline)
+            break;
+    }
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    std::sort(latencies.begin(), latencies.end());
+
+    json row;
+    row["operation"] = operation;
+    row["products"] = products;
+    row["ops"] = ops;
+    row["seconds"] = seconds;
+    row["opsPerSec"] = seconds > 0.0 ? static_cast<double>(ops) / seconds : 0.0;
+    row["p50Us"] = percentile(latencies, 0.50);
+    row["p99Us"] = percentile(latencies, 0.99);
+    row["peakRssBytes"] = ProcessStats::peakRssBytes();
+
+    std::cerr << " " << ops << " ops, " << row["opsPerSec"].get<double>() << " ops/s\n";
+    return row;
+}
+
+// ===================== WORKLOAD =====================
+
+static std::vector<std::string> randomSerials(std::mt19937_64& rng, std::size_t count) {
+    std::vector<std::string> serials;
+    serials.reserve(kInputPool);
+    for (std::size_t i = 0; i < kInputPool; i++)
+        serials.push_back(ProductGenerator::serialFor(rng() % count));
+    return serials;
+}
+
+// Pieces of real names, so most searches have hits and the trigram index works.
+static std::vector<std::string> searchTerms(const Inventory& inventory, std::mt19937_64& rng, std::size_t count) {
+    std::vector<std::string> terms;
+    terms.reserve(kInputPool);
+    for (std::size_t i = 0; i < kInputPool; i++) {
+        auto product = inventory.findBySerial(ProductGenerator::serialFor(rng() % count));
+        const std::string& name = product->getName();
+        std::size_t length = std::min<std::size_t>(name.size(), 3 + rng() % 6);
+        std::size_t start = rng() % (name.size() - length + 1);
+        terms.push_back(name.substr(start, length));
+    }
+    return terms;
+}
+
+static json runSize(std::size_t count, const BenchOptions& options) {
+    std::cerr << count << " products\n";
+    json rows = json::array();
+
+    ProductGenerator generator(options.seed);
+    std::mt19937_64 rng(options.seed ^ count);
+
+    Inventory inventory;
+    rows.push_back(measure("addProduct", count, count, 1e9, [&](std::uint64_t i) {
+        inventory.addProduct(generator.make(i));
+    }));
+
+    const std::string file = options.workDir + "/bench_" + std::to_string(count) + ".json";
+    const std::uint64_t fileOps = count >= 100000 ? 1 : 5;
+
+    rows.push_back(measure("saveToFile", count, fileOps, options.budgetSeconds, [&](std::uint64_t) {
+        inventory.saveToFile(file);
+    }));
+
+    rows.push_back(measure("loadFromFile", count, fileOps, options.budgetSeconds, [&](std::uint64_t) {
+        Inventory loaded;
+        loaded.loadFromFile(file);
+    }));
+    std::remove(file.c_str());
+
+    std::vector<std::string> serials = randomSerials(rng, count);
+    rows.push_back(measure("findBySerial", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        inventory.findBySerial(serials[i % serials.size()]);
+    }));
+
+    std::vector<std::string> terms = searchTerms(inventory, rng, count);
+    rows.push_back(measure("searchByName", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        inventory.searchByName(terms[i % terms.size()]);
+    }));
+
+    rows.push_back(measure("listByCategory", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        inventory.listByCategory(static_cast<int>(i % 3) + 1);
+    }));
+
+    // Equal numbers of ins and outs of one unit, so stock levels stay put.
+    rows.push_back(measure("stockInOutMix", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        const std::string& serial = serials[(i / 2) % serials.size()];
+        if (i % 2 == 0)
+            inventory.stockIn(serial, 1);
+        else
+            inventory.stockOut(serial, 1);
+    }));
+
+    rows.push_back(measure("findByPriceRange", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        double low = static_cast<double>(100 + (i * 37) % 2000);
+        inventory.findByPriceRange(low, low + 5.0);
+    }));
+
+    rows.push_back(measure("lowestStock", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t) {
+        inventory.lowestStock(20);
+    }));
+
+    const std::vector<std::string> queryTexts = {
+        "type=Laptop AND ramGB>=16 AND price<2000 AND quantity>0",
+        "type=Phone AND has5G=true ORDER BY price DESC LIMIT 20",
+        "price>=500 AND price<=900 AND quantity<5",
+    };
+    std::vector<ProductQuery> queries(queryTexts.size());
+    std::string error;
+    for (std::size_t i = 0; i < queryTexts.size(); i++)
+        ProductQuery::parse(queryTexts[i], queries[i], error);
+    rows.push_back(measure("query", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        inventory.query(queries[i % queries.size()]);
+    }));
+
+    ProductQuery bitmapCount;
+    ProductQuery::parse("has5G=1 AND brand=Samsung AND storageGB>=256 AND quantity>0", bitmapCount, error);
+    rows.push_back(measure("countMatching", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t) {
+        inventory.countMatching(bitmapCount);
+    }));
+
+    // The whole catalog as a table, measured and rendered like a listing.
+    NullBuffer discard;
+    std::ostream nullOut(&discard);
+    rows.push_back(measure("renderTable", count, fileOps, options.budgetSeconds, [&](std::uint64_t) {
+        ProductView view = inventory.viewProducts();
+        ProductRenderer renderer(nullOut, inventory.getCategories(), ProductRenderer::Layout::Table);
+        for (const Product& p : view)
+            renderer.measure(p);
+        renderer.header();
+        for (const Product& p : view)
+            renderer.render(p);
+    }));
+
+    std::vector<std::pair<std::string, json>> updates;
+    updates.reserve(kInputPool);
+    for (const auto& serial : serials) {
+        json j = inventory.findBySerial(serial)->toJson();
+        j["price"] = j["price"].get<double>() + 1.0;
+        updates.emplace_back(serial, std::move(j));
+    }
+    rows.push_back(measure("updateProductFromJson", count, options.maxOps, options.budgetSeconds, [&](std::uint64_t i) {
+        const auto& update = updates[i % updates.size()];
+        inventory.updateProductFromJson(update.first, update.second);
+    }));
+
+    return rows;
+}
+
+// ===================== MAIN =====================
+
+static bool parseSizes(const std::string& text, std::vector<std::size_t>& sizes) {
+    sizes.clear();
+    std::stringstream in(text);
+    std::string item;
+    try {
+        while (std::getline(in, item, ',')) {
+            std::size_t used = 0;
+            unsigned long long n = std::stoull(item, &used);
+            if (used != item.size() || n == 0)
+                return false;
+            sizes.push_back(static_cast<std::size_t>(n));
+        }
+    }
+    catch (...) {
+        return false;
+    }
+    return !sizes.empty();
+}
+
+static void printUsage() {
+    std::cerr << "Usage: TechWarehouseBench [--sizes 1000,100000,1000000] [--ops <max ops per test>]\n"
+        << "                          [--seconds <budget per test>] [--seed <n>] [--dir <work dir>] [--out <file>]\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[i + 1];
+
+        try {
+            if (option == "--sizes" && parseSizes(value, options.sizes))
+                continue;
+            if (option == "--ops") {
+                options.maxOps = std::stoull(value);
+                continue;
+            }
+            if (option == "--seconds") {
+                options.budgetSeconds = std::stod(value);
+                continue;
+            }
+            if (option == "--seed") {
+                options.seed = std::stoull(value);
+                continue;
+            }
+            if (option == "--dir") {
+                options.workDir = value;
+                continue;
+            }
+            if (option == "--out") {
+                options.outFile = value;
+                continue;
+            }
+        }
+        catch (...) {
+        }
+
+        printUsage();
+        return 1;
+    }
+
+    json report;
+    report["benchmark"] = "TechWarehouse";
+    report["seed"] = options.seed;
+    report["hardwareThreads"] = std::thread::hardware_concurrency();
+    report["results"] = json::array();
+
+    for (std::size_t size : options.sizes) {
+        for (auto& row : runSize(size, options))
+            report["results"].push_back(std::move(row));
+    }
+    report["peakRssBytes"] = ProcessStats::peakRssBytes();
+
+    if (options.outFile.empty()) {
+        std::cout << report.dump(2) << "\n";
+        return 0;
+    }
+
+    std::ofstream out(options.outFile);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write " << options.outFile << ".\n";
+        return 1;
+    }
+    out << report.dump(2) << "\n";
+    return 0;
+}
@@ -0,0 +1,389 @@
+#include "BitmapIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <typeinfo>
+
+#include "DesktopComputer.h"
+#include "Laptop.h"
+#include "Phone.h"
+
+namespace {
+    const RoaringBitmap& noRows() {
+        static const RoaringBitmap none;
+        return none;
+    }
+
+    void toggle(RoaringBitmap& bitmap, std::uint32_t row, bool on) {
+        if (on)
+            bitmap.add(row);
+        else
+            bitmap.remove(row);
+    }
+
+    template <typename Map, typename Key>
+    void toggleKey(Map& map, const Key& key, std::uint32_t row, bool on) {
+        if (on) {
+            map[key].add(row);
+            return;
+        }
+        auto it = map.find(key);
+        if (it != map.end() && it->second.remove(row) && it->second.empty())
+            map.erase(it);
+    }
+
+    bool isIntegral(double value) {
+        return std::floor(value) == value && value >= INT_MIN && value <= INT_MAX;
+    }
+
+    // Quantities never go below zero (the loaders reject such products and
+    // stock movements refuse to go there), so these tests only ask whether a
+    // product is in stock. `inStock` is the answer they want.
+    bool isStockTest(const QueryCondition& c, bool& inStock) {
+        if (c.field != QueryField::Quantity)
+            return false;
+
+        const double v = c.number;
+        switch (c.op) {
+        case QueryOp::Greater: inStock = true; return v >= 0 && v < 1;
+        case QueryOp::GreaterEqual: inStock = true; return v > 0 && v <= 1;
+        case QueryOp::NotEqual: inStock = true; return v == 0;
+        case QueryOp::Equal: inStock = false; return v == 0;
+        case QueryOp::LessEqual: inStock = false; return v >= 0 && v < 1;
+        case QueryOp::Less: inStock = false; return v > 0 && v <= 1;
+        default: return false;
+        }
+    }
+
+    bool keyMatches(QueryOp op, double key, double operand) {
+        switch (op) {
+        case QueryOp::Equal: return key == operand;
+        case QueryOp::NotEqual: return key != operand;
+        case QueryOp::Less: return key < operand;
+        case QueryOp::LessEqual: return key <= operand;
+        case QueryOp::Greater: return key > operand;
+        case QueryOp::GreaterEqual: return key >= operand;
+        default: return false;
+        }
+    }
+
+
+    const RoaringBitmap* findValue(const std::unordered_map<InternedString, RoaringBitmap>& values, const std::string& text) {
+        const std::string* interned = StringInterner::find(text);
+        if (!interned)
+            return &noRows();
+        auto it = values.find(InternedString::fromInterned(*interned));
+        return it != values.end() ? &it->second : &noRows();
+    }
+}
+
+// ===================== MAINTENANCE =====================
+
+void BitmapIndex::toggleValue(NumericField& field, int value, std::uint32_t row, bool on) {
+    toggleKey(field.values, value, row, on);
+    toggle(field.any, row, on);
+}
+
+BitmapIndex::Keys BitmapIndex::keysOf(const Product& product) {
+    Keys keys;
+    keys.brand = product.getInternedBrand();
+    keys.categoryId = product.getCategoryId();
+    assert(product.getQuantity() >= 0);
+    keys.inStock = product.getQuantity() > 0;
+
+    if (typeid(product) == typeid(Laptop)) {
+        const auto& laptop = static_cast<const Laptop&>(product);
+        keys.type = TypeLaptop;
+        keys.ramGB = laptop.getRamGB();
+        keys.storageGB = laptop.getStorageGB();
+    }
+    else if (typeid(product) == typeid(Phone)) {
+        const auto& phone = static_cast<const Phone&>(product);
+        keys.type = TypePhone;
+        keys.storageGB = phone.getStorageGB();
+        keys.has5G = phone.supports5G() ? 1 : 0;
+    }
+    else if (typeid(product) == typeid(DesktopComputer)) {
+        const auto& desktop = static_cast<const DesktopComputer&>(product);
+        keys.type = TypeDesktop;
+        keys.ramGB = desktop.getRamGB();
+        keys.hasGpu = true;
+        keys.gpu = desktop.getInternedGpu();
+    }
+    return keys;
+}
+
+void BitmapIndex::mark(std::uint32_t row, const Keys& keys, bool on) {
+    toggle(types[keys.type], row, on);
+    toggleKey(brands, keys.brand, row, on);
+    toggleValue(categories, keys.categoryId, row, on);
+    if (keys.ramGB != kNone)
+        toggleValue(ramGB, keys.ramGB, row, on);
+    if (keys.storageGB != kNone)
+        toggleValue(storageGB, keys.storageGB, row, on);
+    if (keys.hasGpu)
+        toggleKey(gpus, keys.gpu, row, on);
+    if (keys.has5G != kNone)
+        toggleValue(has5G, keys.has5G, row, on);
+    if (keys.inStock)
+        toggle(inStock, row, on);
+}
+
+void BitmapIndex::push(const Product& product) {
+    rows.push_back(keysOf(product));
+    mark(static_cast<std::uint32_t>(rows.size() - 1), rows.back(), true);
+}
+
+void BitmapIndex::removeAt(std::size_t row) {
+    const std::size_t last = rows.size() - 1;
+    mark(static_cast<std::uint32_t>(row), rows[row], false);
+    if (row != last) {
+        mark(static_cast<std::uint32_t>(last), rows[last], false);
+        rows[row] = rows[last];
+        mark(static_cast<std::uint32_t>(row), rows[row], true);
+    }
+    rows.pop_back();
+}
+
+void BitmapIndex::replaceAt(std::size_t row, const Product& product) {
+    mark(static_cast<std::uint32_t>(row), rows[row], false);
+    rows[row] = keysOf(product);
+    mark(static_cast<std::uint32_t>(row), rows[row], true);
+}
+
+void BitmapIndex::setQuantity(std::size_t row, int quantity) {
+    assert(quantity >= 0);
+    const bool now = quantity > 0;
+    if (rows[row].inStock == now)
+        return;
+    rows[row].inStock = now;
+    toggle(inStock, static_cast<std::uint32_t>(row), now);
+}
+
+void BitmapIndex::clear() {
+    rows.clear();
+    for (auto& bitmap : types)
+        bitmap.clear();
+    brands.clear();
+    gpus.clear();
+    for (auto* field : { &categories, &ramGB, &storageGB, &has5G }) {
+        field->values.clear();
+        field->any.clear();
+    }
+    inStock.clear();
+}
+
+void BitmapIndex::reserve(std::size_t count) {
+    rows.reserve(count);
+}
+
+std::size_t BitmapIndex::size() const {
+    return rows.size();
+}
+
+std::size_t BitmapIndex::bytes() const {
+    std::size_t used = rows.capacity() * sizeof(Keys) + inStock.bytes();
+    for (const auto& bitmap : types)
+        used += bitmap.bytes();
+    for (const auto* values : { &brands, &gpus }) {
+        for (const auto& entry : *values)
+            used += entry.second.bytes();
+    }
+    for (const auto* field : { &categories, &ramGB, &storageGB, &has5G }) {
+        used += field->any.bytes();
+        for (const auto& entry : field->values)
+            used += entry.second.bytes();
+    }
+    return used;
+}
+
+// ===================== COVERAGE =====================
+
+bool BitmapIndex::covers(const QueryNode& node) {
+    if (node.kind != QueryNode::Kind::Condition) {
+        for (const auto& child : node.children) {
+            if (!covers(child))
+                return false;
+        }
+        return true;
+    }
+
+    const QueryCondition& c = node.condition;
+    switch (c.field) {
+    case QueryField::Type:
+    case QueryField::Brand:
+    case QueryField::Gpu:
+        return c.op == QueryOp::Equal || c.op == QueryOp::NotEqual;
+    case QueryField::Category:
+    case QueryField::RamGB:
+    case QueryField::StorageGB:
+    case QueryField::Has5G:
+        return c.op != QueryOp::Contains;
+    case QueryField::Quantity: {
+        bool wanted;
+        return isStockTest(c, wanted);
+    }
+    default:
+        return false;
+    }
+}
+
+// ===================== EVALUATION =====================
+
+const RoaringBitmap* BitmapIndex::lookup(const QueryCondition& c) const {
+    bool wanted;
+    if (isStockTest(c, wanted))
+        return wanted ? &inStock : nullptr;
+    if (c.op != QueryOp::Equal)
+        return nullptr;
+
+    const NumericField* field = nullptr;
+    switch (c.field) {
+    case QueryField::Type:
+        if (c.text == "Laptop")
+            return &types[TypeLaptop];
+        if (c.text == "Phone")
+            return &types[TypePhone];
+        if (c.text == "DesktopComputer")
+            return &types[TypeDesktop];
+        return &noRows();
+    case QueryField::Brand:
+        return findValue(brands, c.text);
+    case QueryField::Gpu:
+        return findValue(gpus, c.text);
+    case QueryField::Category: field = &categories; break;
+    case QueryField::RamGB: field = &ramGB; break;
+    case QueryField::StorageGB: field = &storageGB; break;
+    case QueryField::Has5G: field = &has5G; break;
+    default: return nullptr;
+    }
+
+    if (!isIntegral(c.number))
+        return &noRows();
+    auto it = field->values.find(static_cast<int>(c.number));
+    return it != field->values.end() ? &it->second : &noRows();
+}
+
+RoaringBitmap BitmapIndex::evaluateCondition(const QueryCondition& c) const {
+    if (const RoaringBitmap* stored = lookup(c))
+        return *stored;
+
+    bool wanted;
+    if (isStockTest(c, wanted))
+        return RoaringBitmap::complement(inStock, rows.size());
+
+    // What remains are the NotEqual tests on text and the comparisons.
+    switch (c.field) {
+    case QueryField::Type: {
+        QueryCondition equal = c;
+        equal.op = QueryOp::Equal;
+        return RoaringBitmap::complement(*lookup(equal), rows.size());
+    }
+    case QueryField::Brand:
+        return RoaringBitmap::complement(*findValue(brands, c.text), rows.size());
+    case QueryField::Gpu:
+        // Only desktops have a gpu; every other product fails the test.
+        return RoaringBitmap::subtract(types[TypeDesktop], *findValue(gpus, c.text));
+    case QueryField::Category: return compareValues(categories, c.op, c.number);
+    case QueryField::RamGB: return compareValues(ramGB, c.op, c.number);
+    case QueryField::StorageGB: return compareValues(storageGB, c.op, c.number);
+    case QueryField::Has5G: return compareValues(has5G, c.op, c.number);
+    default: return RoaringBitmap();
+    }
+}
+
+// Values are disjoint, so the rows that pass are the union of the passing
+// values, or everything with the field minus the failing ones, whichever
+// reads fewer rows.
+RoaringBitmap BitmapIndex::compareValues(const NumericField& field, QueryOp op, double operand) {
+    std::vector<const RoaringBitmap*> passing;
+    std::vector<const RoaringBitmap*> failing;
+    std::size_t passingRows = 0;
+    for (const auto& entry : field.values) {
+        bool passes = keyMatches(op, entry.first, operand);
+        (passes ? passing : failing).push_back(&entry.second);
+        passingRows += passes ? entry.second.cardinality() : 0;
+    }
+
+    if (field.any.cardinality() - passingRows < passingRows) {
+        if (failing.size() == 1)
+            return RoaringBitmap::subtract(field.any, *failing.front());
+        return RoaringBitmap::subtract(field.any, RoaringBitmap::uniteAll(failing));
+    }
+    return RoaringBitmap::uniteAll(passing);
+}
+
+RoaringBitmap BitmapIndex::evaluate(const QueryNode& node) const {
+    switch (node.kind) {
+    case QueryNode::Kind::Condition:
+        return evaluateCondition(node.condition);
+    case QueryNode::Kind::And: {
+        std::vector<const QueryNode*> terms;
+        for (const auto& child : node.children)
+            terms.push_back(&child);
+        return evaluate(terms);
+    }
+    case QueryNode::Kind::Or: {
+        std::vector<RoaringBitmap> parts;
+        std::vector<const RoaringBitmap*> sets;
+        parts.reserve(node.children.size());
+        for (const auto& child : node.children) {
+            parts.push_back(evaluate(child));
+            sets.push_back(&parts.back());
+        }
+        return RoaringBitmap::uniteAll(sets);
+    }
+    case QueryNode::Kind::Not:
+        return RoaringBitmap::complement(evaluate(node.children.front()), rows.size());
+    }
+    return RoaringBitmap();
+}
+
+std::vector<const RoaringBitmap*> BitmapIndex::operands(const std::vector<const QueryNode*>& terms, std::vector<RoaringBitmap>& owned) const {
+    std::vector<const RoaringBitmap*> result;
+    owned.reserve(terms.size());
+    for (const QueryNode* term : terms) {
+        const RoaringBitmap* stored = term->kind == QueryNode::Kind::Condition ? lookup(term->condition) : nullptr;
+        if (!stored) {
+            owned.push_back(evaluate(*term));
+            stored = &owned.back();
+        }
+        result.push_back(stored);
+    }
+
+    // Intersecting the smallest sets first keeps every intermediate small.
+    std::sort(result.begin(), result.end(), [](const RoaringBitmap* a, const RoaringBitmap* b) {
+        return a->cardinality() < b->cardinality();
+    });
+    return result;
+}
+
+RoaringBitmap BitmapIndex::evaluate(const std::vector<const QueryNode*>& terms) const {
+    std::vector<RoaringBitmap> owned;
+    std::vector<const RoaringBitmap*> sets = operands(terms, owned);
+    if (sets.empty())
+        return RoaringBitmap::complement(RoaringBitmap(), rows.size());
+
+    RoaringBitmap out = *sets[0];
+    for (std::size_t i = 1; i < sets.size() && !out.empty(); i++)
+        out = RoaringBitmap::intersect(out, *sets[i]);
+    return out;
+}
+
+std::size_t BitmapIndex::count(const std::vector<const QueryNode*>& terms) const {
+    std::vector<RoaringBitmap> owned;
+    std::vector<const RoaringBitmap*> sets = operands(terms, owned);
+    if (sets.empty())
+        return rows.size();
+    if (sets.size() == 1)
+        return sets[0]->cardinality();
+    if (sets.size() == 2)
+        return RoaringBitmap::intersectCount(*sets[0], *sets[1]);
+
+    RoaringBitmap partial = RoaringBitmap::intersect(*sets[0], *sets[1]);
+    for (std::size_t i = 2; i + 1 < sets.size() && !partial.empty(); i++)
+        partial = RoaringBitmap::intersect(partial, *sets[i]);
+    return RoaringBitmap::intersectCount(partial, *sets.back());
+}
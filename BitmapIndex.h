@@ -0,0 +1,91 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "Product.h"
+#include "ProductQuery.h"
+#include "RoaringBitmap.h"
+#include "StringInterner.h"
+
+// Row sets for the low-cardinality attributes: type, brand, category,
+// ramGB, storageGB, gpu, has5G, and whether the product is in stock. Row i
+// is products[i], as in ProductColumns, and the index is kept in step the
+// same way, so a filter on these fields is answered from the bitmaps
+// without touching a product. Each row's indexed values are kept too: the
+// index can clear a row's old bits after the product itself has changed.
+class BitmapIndex {
+public:
+    void push(const Product& product);
+    // Swap-and-pop, matching Inventory's removal.
+    void removeAt(std::size_t row);
+    void replaceAt(std::size_t row, const Product& product);
+    void setQuantity(std::size_t row, int quantity);
+
+    void clear();
+    void reserve(std::size_t count);
+    std::size_t size() const;
+    std::size_t bytes() const;
+
+    // True when every condition under `node` can be answered here: equality
+    // and comparisons on the indexed fields, and quantity tests that only
+    // ask whether the product is in stock (quantity > 0, quantity = 0, ...).
+    static bool covers(const QueryNode& node);
+
+    // Rows matching the node, or all of the terms; each must be covered.
+    RoaringBitmap evaluate(const QueryNode& node) const;
+    RoaringBitmap evaluate(const std::vector<const QueryNode*>& terms) const;
+    // Rows matching all of the terms, counted without building the last
+    // intersection.
+    std::size_t count(const std::vector<const QueryNode*>& terms) const;
+
+private:
+    static constexpr int kNone = INT_MIN;
+
+    enum TypeKey { TypeLaptop, TypePhone, TypeDesktop, TypeOther, TypeCount };
+
+    struct Keys {
+        TypeKey type = TypeOther;
+        InternedString brand;
+        int categoryId = 0;
+        int ramGB = kNone;
+        int storageGB = kNone;
+        bool hasGpu = false;
+        InternedString gpu;
+        int has5G = kNone;
+        bool inStock = false;
+    };
+
+    // A numeric field: the rows of each value, and of any value, so a test
+    // most values pass can subtract the few that fail.
+    struct NumericField {
+        std::map<int, RoaringBitmap> values;
+        RoaringBitmap any;
+    };
+
+    std::vector<Keys> rows;
+    RoaringBitmap types[TypeCount];
+    std::unordered_map<InternedString, RoaringBitmap> brands;
+    std::unordered_map<InternedString, RoaringBitmap> gpus;
+    NumericField categories;
+    NumericField ramGB;
+    NumericField storageGB;
+    NumericField has5G;
+    RoaringBitmap inStock;
+
+    static Keys keysOf(const Product& product);
+    static void toggleValue(NumericField& field, int value, std::uint32_t row, bool on);
+    void mark(std::uint32_t row, const Keys& keys, bool on);
+
+    // The stored bitmap when the condition names exactly one; null otherwise.
+    const RoaringBitmap* lookup(const QueryCondition& c) const;
+    RoaringBitmap evaluateCondition(const QueryCondition& c) const;
+    static RoaringBitmap compareValues(const NumericField& field, QueryOp op, double operand);
+    // Looked-up or evaluated bitmaps for the terms, smallest first; `owned`
+    // keeps the evaluated ones alive.
+    std::vector<const RoaringBitmap*> operands(const std::vector<const QueryNode*>& terms, std::vector<RoaringBitmap>& owned) const;
+};
@@ -0,0 +1,70 @@
+#include "Checkpointer.h"
+
+#include "Inventory.h"
+#include "Journal.h"
+
+Checkpointer::Checkpointer(Inventory& inventory, Journal& journal, const std::string& snapshotFile,
+    const CheckpointOptions& options)
+    : inventory(inventory), journal(journal), snapshotFile(snapshotFile), options(options),
+      stopping(false), completed(0), failed(0) {
+}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::start() {
+    if (worker.joinable())
+        return;
+
+    stopping = false;
+    worker = std::thread(&Checkpointer::run, this);
+}
+
+void Checkpointer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+std::size_t Checkpointer::getCompleted() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return completed;
+}
+
+std::size_t Checkpointer::getFailed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+// A failed journal refuses every change until a checkpoint clears it.
+bool Checkpointer::isDue() const {
+    if (journal.hasFailed() || journal.activeBytes() >= options.maxJournalBytes)
+        return true;
+
+    auto age = journal.activeAge();
+    return age > std::chrono::steady_clock::duration::zero() && age >= options.maxAge;
+}
+
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        wake.wait_for(lock, options.pollInterval);
+        if (stopping || !isDue())
+            continue;
+
+        lock.unlock();
+        bool ok = inventory.checkpoint(snapshotFile);
+        lock.lock();
+
+        if (ok)
+            ++completed;
+        else
+            ++failed;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Inventory;
+class Journal;
+
+struct CheckpointOptions {
+    // A checkpoint starts once the active journal segment reaches either limit.
+    std::uint64_t maxJournalBytes = 16ull * 1024 * 1024;
+    std::chrono::seconds maxAge{ 300 };
+    std::chrono::milliseconds pollInterval{ 1000 };
+};
+
+// Background thread that snapshots the inventory and drops the journal
+// segments the snapshot covers, so replay on startup stays short.
+class Checkpointer {
+public:
+    Checkpointer(Inventory& inventory, Journal& journal, const std::string& snapshotFile,
+        const CheckpointOptions& options);
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    void start();
+    void stop();
+
+    std::size_t getCompleted() const;
+    std::size_t getFailed() const;
+
+private:
+    Inventory& inventory;
+    Journal& journal;
+    std::string snapshotFile;
+    CheckpointOptions options;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool stopping;
+    std::size_t completed;
+    std::size_t failed;
+
+    bool isDue() const;
+    void run();
+};
@@ -0,0 +1,442 @@
+#include "ColumnKernels.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TW_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TW_AVX2_TARGET
+#else
+#define TW_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+    constexpr std::size_t kLanes = 4;
+
+    // Shared by both paths so the floating-point result does not depend on which ran.
+    double combineLanes(const double lanes[kLanes]) {
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    // ===================== SCALAR =====================
+
+    std::int64_t sumScalar(const std::int32_t* values, std::size_t n) {
+        std::int64_t total = 0;
+        for (std::size_t i = 0; i < n; i++)
+            total += values[i];
+        return total;
+    }
+
+    double dotScalar(const double* a, const std::int32_t* b, std::size_t n) {
+        double lanes[kLanes] = { 0.0, 0.0, 0.0, 0.0 };
+        std::size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            for (std::size_t j = 0; j < kLanes; j++)
+                lanes[j] += a[i + j] * static_cast<double>(b[i + j]);
+        }
+
+        double total = combineLanes(lanes);
+        for (; i < n; i++)
+            total += a[i] * static_cast<double>(b[i]);
+        return total;
+    }
+
+    std::size_t countLessScalar(const std::int32_t* values, std::size_t n, std::int32_t limit) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++)
+            count += values[i] < limit;
+        return count;
+    }
+
+    void minMaxScalar(const double* values, std::size_t n, double& min, double& max) {
+        for (std::size_t i = 0; i < n; i++) {
+            min = values[i] < min ? values[i] : min;
+            max = values[i] > max ? values[i] : max;
+        }
+    }
+
+    std::int64_t sumWhereScalar(const std::int32_t* values, const std::int32_t* keys, std::size_t n, std::int32_t key) {
+        std::int64_t total = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (keys[i] == key)
+                total += values[i];
+        }
+        return total;
+    }
+
+    double dotWhereScalar(const double* a, const std::int32_t* b, const std::int32_t* keys, std::size_t n, std::int32_t key) {
+        double lanes[kLanes] = { 0.0, 0.0, 0.0, 0.0 };
+        std::size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            for (std::size_t j = 0; j < kLanes; j++)
+                lanes[j] += keys[i + j] == key ? a[i + j] * static_cast<double>(b[i + j]) : 0.0;
+        }
+
+        double total = combineLanes(lanes);
+        for (; i < n; i++) {
+            if (keys[i] == key)
+                total += a[i] * static_cast<double>(b[i]);
+        }
+        return total;
+    }
+
+    std::size_t countLessWhereScalar(const std::int32_t* values, const std::int32_t* keys, std::size_t n,
+        std::int32_t limit, std::int32_t key) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++)
+            count += keys[i] == key && values[i] < limit;
+        return count;
+    }
+
+    std::size_t popcountWord(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_popcountll(x));
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return static_cast<std::size_t>((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    std::size_t popcountScalar(const std::uint64_t* words, std::size_t n) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++)
+            count += popcountWord(words[i]);
+        return count;
+    }
+
+    std::size_t popcountAndScalar(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++)
+            count += popcountWord(a[i] & b[i]);
+        return count;
+    }
+
+    std::uint64_t combineWord(ColumnKernels::BitOp op, std::uint64_t a, std::uint64_t b) {
+        return op == ColumnKernels::BitOp::And ? a & b : op == ColumnKernels::BitOp::Or ? a | b : a & ~b;
+    }
+
+    std::size_t combineScalar(ColumnKernels::BitOp op, const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out, std::size_t n) {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = combineWord(op, a[i], b[i]);
+            count += popcountWord(out[i]);
+        }
+        return count;
+    }
+
+    // ===================== AVX2 =====================
+
+#ifdef TW_X86
+    // 32-bit lane counters are flushed before they could overflow.
+    constexpr std::size_t kCountBlock = std::size_t(1) << 24;
+
+    TW_AVX2_TARGET std::int64_t horizontalSum(__m256i v) {
+        alignas(32) std::int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    TW_AVX2_TARGET std::size_t horizontalCount(__m256i v) {
+        alignas(32) std::uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+        std::size_t count = 0;
+        for (std::uint32_t lane : lanes)
+            count += lane;
+        return count;
+    }
+
+    TW_AVX2_TARGET std::int64_t sumAvx2(const std::int32_t* values, std::size_t n) {
+        __m256i acc = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        return horizontalSum(acc) + sumScalar(values + i, n - i);
+    }
+
+    TW_AVX2_TARGET double dotAvx2(const double* a, const std::int32_t* b, std::size_t n) {
+        __m256d acc = _mm256_setzero_pd();
+        std::size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            __m256d y = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+            acc = _mm256_add_pd(acc, _mm256_mul_pd(x, y));
+        }
+
+        alignas(32) double lanes[kLanes];
+        _mm256_store_pd(lanes, acc);
+        double total = combineLanes(lanes);
+        for (; i < n; i++)
+            total += a[i] * static_cast<double>(b[i]);
+        return total;
+    }
+
+    TW_AVX2_TARGET std::size_t countLessAvx2(const std::int32_t* values, std::size_t n, std::int32_t limit) {
+        const __m256i bound = _mm256_set1_epi32(limit);
+        std::size_t count = 0;
+        std::size_t i = 0;
+
+        while (i + 8 <= n) {
+            const std::size_t end = i + std::min((n - i) / 8, kCountBlock) * 8;
+            __m256i acc = _mm256_setzero_si256();
+            for (; i < end; i += 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                acc = _mm256_sub_epi32(acc, _mm256_cmpgt_epi32(bound, v));
+            }
+            count += horizontalCount(acc);
+        }
+        return count + countLessScalar(values + i, n - i, limit);
+    }
+
+    TW_AVX2_TARGET void minMaxAvx2(const double* values, std::size_t n, double& min, double& max) {
+        __m256d lo = _mm256_set1_pd(min);
+        __m256d hi = _mm256_set1_pd(max);
+        std::size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            __m256d v = _mm256_loadu_pd(values + i);
+            lo = _mm256_min_pd(v, lo);
+            hi = _mm256_max_pd(v, hi);
+        }
+
+        alignas(32) double los[kLanes], his[kLanes];
+        _mm256_store_pd(los, lo);
+        _mm256_store_pd(his, hi);
+        minMaxScalar(los, kLanes, min, max);
+        minMaxScalar(his, kLanes, min, max);
+        minMaxScalar(values + i, n - i, min, max);
+    }
+
+    TW_AVX2_TARGET std::int64_t sumWhereAvx2(const std::int32_t* values, const std::int32_t* keys, std::size_t n, std::int32_t key) {
+        const __m256i match = _mm256_set1_epi32(key);
+        __m256i acc = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            v = _mm256_and_si256(v, _mm256_cmpeq_epi32(k, match));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+            acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        return horizontalSum(acc) + sumWhereScalar(values + i, keys + i, n - i, key);
+    }
+
+    TW_AVX2_TARGET double dotWhereAvx2(const double* a, const std::int32_t* b, const std::int32_t* keys, std::size_t n, std::int32_t key) {
+        const __m128i match = _mm_set1_epi32(key);
+        __m256d acc = _mm256_setzero_pd();
+        std::size_t i = 0;
+        for (; i + kLanes <= n; i += kLanes) {
+            __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(k, match)));
+            __m256d x = _mm256_loadu_pd(a + i);
+            __m256d y = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+            acc = _mm256_add_pd(acc, _mm256_and_pd(_mm256_mul_pd(x, y), mask));
+        }
+
+        alignas(32) double lanes[kLanes];
+        _mm256_store_pd(lanes, acc);
+        double total = combineLanes(lanes);
+        for (; i < n; i++) {
+            if (keys[i] == key)
+                total += a[i] * static_cast<double>(b[i]);
+        }
+        return total;
+    }
+
+    TW_AVX2_TARGET std::size_t countLessWhereAvx2(const std::int32_t* values, const std::int32_t* keys, std::size_t n,
+        std::int32_t limit, std::int32_t key) {
+        const __m256i bound = _mm256_set1_epi32(limit);
+        const __m256i match = _mm256_set1_epi32(key);
+        std::size_t count = 0;
+        std::size_t i = 0;
+
+        while (i + 8 <= n) {
+            const std::size_t end = i + std::min((n - i) / 8, kCountBlock) * 8;
+            __m256i acc = _mm256_setzero_si256();
+            for (; i < end; i += 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+                acc = _mm256_sub_epi32(acc, _mm256_and_si256(_mm256_cmpgt_epi32(bound, v), _mm256_cmpeq_epi32(k, match)));
+            }
+            count += horizontalCount(acc);
+        }
+        return count + countLessWhereScalar(values + i, keys + i, n - i, limit, key);
+    }
+
+    // Bit counts of each byte: two nibble lookups through a 16-entry table.
+    TW_AVX2_TARGET __m256i popcountBytes(__m256i v) {
+        const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble));
+        __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        return _mm256_add_epi8(low, high);
+    }
+
+    TW_AVX2_TARGET std::size_t popcountAvx2(const std::uint64_t* words, std::size_t n) {
+        __m256i acc = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(popcountBytes(v), _mm256_setzero_si256()));
+        }
+        return static_cast<std::size_t>(horizontalSum(acc)) + popcountScalar(words + i, n - i);
+    }
+
+    TW_AVX2_TARGET std::size_t popcountAndAvx2(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) {
+        __m256i acc = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(popcountBytes(v), _mm256_setzero_si256()));
+        }
+        return static_cast<std::size_t>(horizontalSum(acc)) + popcountAndScalar(a + i, b + i, n - i);
+    }
+
+    template <ColumnKernels::BitOp Op>
+    TW_AVX2_TARGET std::size_t combineAvx2(const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out, std::size_t n) {
+        __m256i acc = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            __m256i v = Op == ColumnKernels::BitOp::And ? _mm256_and_si256(x, y)
+                : Op == ColumnKernels::BitOp::Or ? _mm256_or_si256(x, y)
+                : _mm256_andnot_si256(y, x);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(popcountBytes(v), _mm256_setzero_si256()));
+        }
+        return static_cast<std::size_t>(horizontalSum(acc)) + combineScalar(Op, a + i, b + i, out + i, n - i);
+    }
+
+    bool detectAvx2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+}
+
+bool ColumnKernels::hasAvx2() {
+#ifdef TW_X86
+    static const bool supported = detectAvx2();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+std::int64_t ColumnKernels::sum(const std::int32_t* values, std::size_t n) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return sumAvx2(values, n);
+#endif
+    return sumScalar(values, n);
+}
+
+double ColumnKernels::dot(const double* a, const std::int32_t* b, std::size_t n) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return dotAvx2(a, b, n);
+#endif
+    return dotScalar(a, b, n);
+}
+
+std::size_t ColumnKernels::countLess(const std::int32_t* values, std::size_t n, std::int32_t limit) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return countLessAvx2(values, n, limit);
+#endif
+    return countLessScalar(values, n, limit);
+}
+
+bool ColumnKernels::minMax(const double* values, std::size_t n, double& min, double& max) {
+    if (n == 0)
+        return false;
+
+    min = values[0];
+    max = values[0];
+#ifdef TW_X86
+    if (hasAvx2()) {
+        minMaxAvx2(values, n, min, max);
+        return true;
+    }
+#endif
+    minMaxScalar(values, n, min, max);
+    return true;
+}
+
+std::int64_t ColumnKernels::sumWhere(const std::int32_t* values, const std::int32_t* keys, std::size_t n, std::int32_t key) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return sumWhereAvx2(values, keys, n, key);
+#endif
+    return sumWhereScalar(values, keys, n, key);
+}
+
+double ColumnKernels::dotWhere(const double* a, const std::int32_t* b, const std::int32_t* keys, std::size_t n, std::int32_t key) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return dotWhereAvx2(a, b, keys, n, key);
+#endif
+    return dotWhereScalar(a, b, keys, n, key);
+}
+
+std::size_t ColumnKernels::countLessWhere(const std::int32_t* values, const std::int32_t* keys, std::size_t n,
+    std::int32_t limit, std::int32_t key) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return countLessWhereAvx2(values, keys, n, limit, key);
+#endif
+    return countLessWhereScalar(values, keys, n, limit, key);
+}
+
+std::size_t ColumnKernels::popcount(const std::uint64_t* words, std::size_t n) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return popcountAvx2(words, n);
+#endif
+    return popcountScalar(words, n);
+}
+
+std::size_t ColumnKernels::popcountAnd(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) {
+#ifdef TW_X86
+    if (hasAvx2())
+        return popcountAndAvx2(a, b, n);
+#endif
+    return popcountAndScalar(a, b, n);
+}
+
+std::size_t ColumnKernels::combine(BitOp op, const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out, std::size_t n) {
+#ifdef TW_X86
+    if (hasAvx2()) {
+        switch (op) {
+        case BitOp::And: return combineAvx2<BitOp::And>(a, b, out, n);
+        case BitOp::Or: return combineAvx2<BitOp::Or>(a, b, out, n);
+        case BitOp::AndNot: return combineAvx2<BitOp::AndNot>(a, b, out, n);
+        }
+    }
+#endif
+    return combineScalar(op, a, b, out, n);
+}
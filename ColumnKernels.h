@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Aggregation kernels over dense columns. On x86 CPUs with AVX2 the
+// vectorized versions are picked at run time; everywhere else a scalar
+// loop runs. Both accumulate in the same four lanes and combine them in
+// the same order, so results are identical whichever path runs.
+class ColumnKernels {
+public:
+    static bool hasAvx2();
+
+    static std::int64_t sum(const std::int32_t* values, std::size_t n);
+    static double dot(const double* a, const std::int32_t* b, std::size_t n);
+    static std::size_t countLess(const std::int32_t* values, std::size_t n, std::int32_t limit);
+    // False when n is 0.
+    static bool minMax(const double* values, std::size_t n, double& min, double& max);
+
+    // Same, restricted to rows whose key equals `key`.
+    static std::int64_t sumWhere(const std::int32_t* values, const std::int32_t* keys, std::size_t n, std::int32_t key);
+    static double dotWhere(const double* a, const std::int32_t* b, const std::int32_t* keys, std::size_t n, std::int32_t key);
+    static std::size_t countLessWhere(const std::int32_t* values, const std::int32_t* keys, std::size_t n,
+        std::int32_t limit, std::int32_t key);
+
+    // Set bits in n 64-bit words, and in the words of a AND b.
+    static std::size_t popcount(const std::uint64_t* words, std::size_t n);
+    static std::size_t popcountAnd(const std::uint64_t* a, const std::uint64_t* b, std::size_t n);
+
+    // out = a AND b, a OR b or a AND NOT b, word by word, returning the set
+    // bits of out; one pass instead of combining and then counting. `out`
+    // may be a or b.
+    enum class BitOp { And, Or, AndNot };
+    static std::size_t combine(BitOp op, const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out, std::size_t n);
+};
@@ -0,0 +1,36 @@
+#include "ConcurrentSerialSet.h"
+
+#include <functional>
+
+bool ConcurrentSerialSet::claim(std::string_view serial, std::size_t position) {
+    if (serial.empty())
+        return false;
+
+    Shard& shard = shards[shardOf(serial)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::size_t held = shard.index.find(serial);
+    if (held == SerialIndex::npos)
+        return shard.index.insert(serial, position);
+    if (position < held)
+        shard.index.setPosition(serial, position);
+    return true;
+}
+
+std::size_t ConcurrentSerialSet::owner(std::string_view serial) const {
+    if (serial.empty())
+        return SerialIndex::npos;
+    return shards[shardOf(serial)].index.find(serial);
+}
+
+void ConcurrentSerialSet::reserve(std::size_t count) {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.reserve(count / kShardCount + 1);
+    }
+}
+
+std::size_t ConcurrentSerialSet::shardOf(std::string_view serial) {
+    // The high bits: SerialIndex probes with the low ones of its own hash.
+    return (std::hash<std::string_view>()(serial) >> 20) % kShardCount;
+}
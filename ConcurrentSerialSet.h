@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+
+#include "SerialIndex.h"
+
+// Serial numbers claimed from several threads at once, each kept with the
+// lowest position that claimed it, so the winner does not depend on which
+// thread got there first. Striped like StringInterner: a serial hashes to
+// one of a fixed set of shards, each a SerialIndex behind its own mutex.
+// Keys are views, so the claimed strings must outlive the set.
+class ConcurrentSerialSet {
+public:
+    // Records `position` for the serial unless a lower one holds it.
+    // False for an empty serial, which is never recorded.
+    bool claim(std::string_view serial, std::size_t position);
+
+    // Lowest position that claimed the serial, or SerialIndex::npos. Takes no
+    // lock: call it once the claiming threads have been joined.
+    std::size_t owner(std::string_view serial) const;
+
+    void reserve(std::size_t count);
+
+private:
+    static constexpr std::size_t kShardCount = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        SerialIndex index;
+    };
+
+    std::array<Shard, kShardCount> shards;
+
+    static std::size_t shardOf(std::string_view serial);
+};
@@ -1,11 +1,17 @@
 #include "ConsoleMenu.h"
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 
 #include "Laptop.h"
 #include "Phone.h"
 #include "DesktopComputer.h"
+#include "ProductStore.h"
+#include "InventoryReport.h"
+#include "MemoryAccounting.h"
+#include "Metrics.h"
 
 #ifdef _WIN32
 #define NOMINMAX
@@ -94,34 +100,114 @@ static void printInfo(const std::string& text)
 
 // ===================== PRODUCT PRINT =====================
 
-static void printProductDetailed(const Inventory& inv, const std::shared_ptr<Product>& p)
+static void printProductDetailed(const Inventory& inv, const Product& p)
 {
-    if (!p) return;
+    ProductRenderer renderer(std::cout, inv.getCategories(), ProductRenderer::Layout::Detailed);
+    renderer.render(p);
+}
 
-    const Category* cat = inv.getCategoryById(p->getCategoryId());
-    std::string catName = cat ? cat->getName() : "Unknown";
+// Asked after each full page; false once the user stops the listing.
+static bool nextPage(std::size_t shown, std::size_t total)
+{
+    std::cout << "-- " << shown << " of " << total << " -- Enter for more, q to stop: ";
+    std::string answer;
+    std::getline(std::cin, answer);
+    return answer.empty() || (answer[0] != 'q' && answer[0] != 'Q');
+}
 
-#ifdef _WIN32
-    setColor(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY);
-#endif
-    std::cout << "----------------------------------------\n";
-#ifdef _WIN32
-    resetColor();
-#endif
+// Search and query results go through one renderer, a page at a time when
+// a page size is set. The table layout measures the whole list first so the
+// columns stay put from page to page.
+static void printProducts(const Inventory& inv, const DisplayOptions& display, const std::vector<std::shared_ptr<Product>>& products)
+{
+    ProductRenderer renderer(std::cout, inv.getCategories(), display.layout);
 
-    std::cout << " Serial   : " << p->getSerialNumber() << "\n";
-    std::cout << " Type     : " << p->getType() << "\n";
-    std::cout << " Name     : " << p->getName() << "\n";
-    std::cout << " Brand    : " << p->getBrand() << "\n";
-    std::cout << " Price    : " << p->getPrice() << "\n";
-    std::cout << " Quantity : " << p->getQuantity() << "\n";
-    std::cout << " Category : " << catName << " (ID=" << p->getCategoryId() << ")\n";
+    std::size_t total = 0;
+    for (const auto& p : products)
+    {
+        renderer.measure(*p);
+        total++;
+    }
 
-#ifdef _WIN32
-    setColor(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY);
-#endif
-    std::cout << "----------------------------------------\n";
-    resetColor();
+    renderer.header();
+    std::size_t shown = 0;
+    for (const auto& p : products)
+    {
+        renderer.render(*p);
+        shown++;
+
+        if (display.pageSize != 0 && shown % display.pageSize == 0 && shown < total)
+        {
+            renderer.flush();
+            if (!nextPage(shown, total))
+                return;
+            renderer.header();
+        }
+    }
+}
+
+// Lists the inventory's products for which keep(const Product&) is true,
+// read in place through ProductViews. Every kViewRun products (fewer at the
+// end of a page) are rendered under their own short-lived view and written
+// out once it is gone, so the inventory is never locked while the terminal
+// or the user is slow. Products added or removed meanwhile may be missed or
+// listed twice. False, with nothing printed, when no product matches.
+template <typename Keep>
+static bool printInventory(const Inventory& inv, const DisplayOptions& display, const std::string& title, Keep keep)
+{
+    constexpr std::size_t kViewRun = 256;
+    ProductRenderer renderer(std::cout, inv.getCategories(), display.layout);
+
+    std::size_t total = 0;
+    {
+        ProductView view = inv.viewProducts();
+        for (const Product& p : view.where(keep))
+        {
+            renderer.measure(p);
+            total++;
+        }
+    }
+    if (total == 0)
+        return false;
+
+    printTitle(title);
+    renderer.header();
+    std::size_t shown = 0;
+    std::size_t onPage = 0;
+    std::size_t next = 0;   // position in the product list to resume from
+    for (;;)
+    {
+        std::size_t run = kViewRun;
+        if (display.pageSize != 0)
+            run = std::min(run, display.pageSize - onPage);
+
+        bool more;
+        {
+            ProductView view = inv.viewProducts();
+            std::size_t listed = 0;
+            for (; next < view.size() && listed < run; next++)
+            {
+                if (!keep(view[next]))
+                    continue;
+                renderer.render(view[next]);
+                listed++;
+            }
+            shown += listed;
+            onPage += listed;
+            more = listed == run && next < view.size() && shown < total;
+        }
+        renderer.flush();
+        if (!more)
+            return true;
+
+        if (display.pageSize != 0 && onPage == display.pageSize)
+        {
+            if (!nextPage(shown, total))
+                return true;
+            renderer.header();
+            onPage = 0;
+        }
+    }
 }
 
 // ===================== CATEGORY CHOOSER =====================
@@ -163,8 +249,8 @@ static int chooseCategoryId(const Inventory& inv)
 
 // ===================== CTOR =====================
 
-ConsoleMenu::ConsoleMenu(Inventory& inventory)
-    : inventory(inventory)
+ConsoleMenu::ConsoleMenu(Inventory& inventory, const DisplayOptions& display)
+    : inventory(inventory), display(display)
 {
 #ifdef _WIN32
     initConsoleColors();
@@ -188,6 +274,13 @@ void ConsoleMenu::showMenu() const
     std::cout << "9.  Stock OUT\n";
     std::cout << "10. List categories\n";
     std::cout << "11. Save data\n";
+    std::cout << "12. Export data to JSON\n";
+    std::cout << "13. Stock report\n";
+    std::cout << "14. Query products\n";
+    std::cout << "15. Count products\n";
+    std::cout << "16. Display settings\n";
+    std::cout << "17. Operation metrics\n";
+    std::cout << "18. Memory report\n";
     std::cout << "0.  Exit\n";
 
 #ifdef _WIN32
@@ -228,12 +321,50 @@ void ConsoleMenu::run()
         case 9: stockOut(); break;
         case 10: listCategories(); break;
         case 11: saveData(); break;
+        case 12: exportData(); break;
+        case 13: showReport(); break;
+        case 14: queryProducts(); break;
+        case 15: countProducts(); break;
+        case 16: displaySettings(); break;
+        case 17: showMetrics(); break;
+        case 18: showMemory(); break;
         case 0: printOk("Exiting..."); break;
         default: printError("Unknown option."); break;
         }
     }
 }
 
+void ConsoleMenu::displaySettings()
+{
+    printTitle("DISPLAY SETTINGS");
+
+    int layout;
+    std::cout << "Layout (1 = detailed, 2 = table): ";
+    std::cin >> layout;
+    if (std::cin.fail() || layout < 1 || layout > 2)
+    {
+        clearInput();
+        printError("Invalid layout.");
+        return;
+    }
+    clearInput();
+
+    long long pageSize;
+    std::cout << "Page size (0 = no paging): ";
+    std::cin >> pageSize;
+    if (std::cin.fail() || pageSize < 0)
+    {
+        clearInput();
+        printError("Invalid page size.");
+        return;
+    }
+    clearInput();
+
+    display.layout = layout == 2 ? ProductRenderer::Layout::Table : ProductRenderer::Layout::Detailed;
+    display.pageSize = static_cast<std::size_t>(pageSize);
+    printOk("Display settings updated.");
+}
+
 // ===================== CATEGORIES =====================
 
 void ConsoleMenu::listCategories()
@@ -254,16 +385,8 @@ void ConsoleMenu::listCategories()
 
 void ConsoleMenu::listProducts()
 {
-    const auto& products = inventory.getAllProducts();
-    if (products.empty())
-    {
+    if (!printInventory(inventory, display, "ALL PRODUCTS", [](const Product&) { return true; }))
         printInfo("No products.");
-        return;
-    }
-
-    printTitle("ALL PRODUCTS");
-    for (const auto& p : products)
-        printProductDetailed(inventory, p);
 }
 
 void ConsoleMenu::addProduct()
@@ -353,7 +476,7 @@ void ConsoleMenu::addProduct()
         }
         clearInput();
 
-        product = std::make_shared<Laptop>(serial, name, brand, price, quantity, categoryId, cpu, ram, storage);
+        product = ProductStore::make<Laptop>(serial, name, brand, price, quantity, categoryId, cpu, ram, storage);
     }
     else if (categoryId == 2 || catName == "Phone")
     {
@@ -379,7 +502,7 @@ void ConsoleMenu::addProduct()
         }
         clearInput();
 
-        product = std::make_shared<Phone>(serial, name, brand, price, quantity, categoryId, cpu, storage, has5g == 1);
+        product = ProductStore::make<Phone>(serial, name, brand, price, quantity, categoryId, cpu, storage, has5g == 1);
     }
     else if (categoryId == 3 || catName == "Desktop")
     {
@@ -404,7 +527,7 @@ void ConsoleMenu::addProduct()
         }
         clearInput();
 
-        product = std::make_shared<DesktopComputer>(serial, name, brand, price, quantity, categoryId, cpu, gpu, ram);
+        product = ProductStore::make<DesktopComputer>(serial, name, brand, price, quantity, categoryId, cpu, gpu, ram);
     }
     else
     {
@@ -412,7 +535,11 @@ void ConsoleMenu::addProduct()
         return;
     }
 
-    inventory.addProduct(product);
+    if (!inventory.addProduct(product))
+    {
+        printError(inventory.journalFailed() ? "Journal write failed; the product was not added." : "Serial already exists.");
+        return;
+    }
     printOk("Product added successfully.");
 }
 
@@ -431,8 +558,58 @@ void ConsoleMenu::searchByName()
         return;
     }
 
-    for (const auto& p : results)
-        printProductDetailed(inventory, p);
+    printProducts(inventory, display, results);
+}
+
+void ConsoleMenu::queryProducts()
+{
+    std::string text;
+    printTitle("QUERY PRODUCTS");
+
+    std::cout << "e.g. type=Laptop AND ramGB>=16 AND price<2000 ORDER BY price LIMIT 10\n";
+    std::cout << "Query: ";
+    std::getline(std::cin, text);
+
+    ProductQuery query;
+    std::string error;
+    if (!ProductQuery::parse(text, query, error))
+    {
+        printError("Invalid query: " + error + ".");
+        return;
+    }
+
+    QueryResult result = inventory.query(query);
+    printInfo("Plan: " + result.plan);
+    if (result.products.empty())
+    {
+        printInfo("No matches.");
+        return;
+    }
+
+    printProducts(inventory, display, result.products);
+    printOk(std::to_string(result.products.size()) + " product(s).");
+}
+
+void ConsoleMenu::countProducts()
+{
+    std::string text;
+    printTitle("COUNT PRODUCTS");
+
+    std::cout << "e.g. has5G=1 AND brand=Samsung AND storageGB>=256 AND quantity>0\n";
+    std::cout << "Query: ";
+    std::getline(std::cin, text);
+
+    ProductQuery query;
+    std::string error;
+    if (!ProductQuery::parse(text, query, error))
+    {
+        printError("Invalid query: " + error + ".");
+        return;
+    }
+
+    QueryCount result = inventory.countMatching(query);
+    printInfo("Plan: " + result.plan);
+    printOk(std::to_string(result.count) + " product(s).");
 }
 
 void ConsoleMenu::searchBySerial()
@@ -450,7 +627,7 @@ void ConsoleMenu::searchBySerial()
         return;
     }
 
-    printProductDetailed(inventory, p);
+    printProductDetailed(inventory, *p);
 }
 
 void ConsoleMenu::editProduct()
@@ -473,7 +650,7 @@ void ConsoleMenu::editProduct()
     while (true)
     {
         printInfo("Current product:");
-        printProductDetailed(inventory, p);
+        printProductDetailed(inventory, *p);
 
         std::cout << "\nEdit menu:\n";
         std::cout << "1. Serial number\n";
@@ -587,7 +764,7 @@ void ConsoleMenu::editProduct()
 
     if (!inventory.updateProductFromJson(serial, j))
     {
-        printError("Edit failed (duplicate serial or invalid data).");
+        printError(inventory.journalFailed() ? "Journal write failed; the product was not changed." : "Edit failed (duplicate serial or invalid data).");
         return;
     }
 
@@ -607,7 +784,7 @@ void ConsoleMenu::removeProduct()
     std::getline(std::cin, serial);
 
     if (!inventory.removeProductBySerial(serial))
-        printError("Not found.");
+        printError(inventory.journalFailed() ? "Journal write failed; the product was not removed." : "Not found.");
     else
         printOk("Removed.");
 }
@@ -617,16 +794,9 @@ void ConsoleMenu::listByCategory()
     int categoryId = chooseCategoryId(inventory);
     if (categoryId == -1) return;
 
-    auto products = inventory.listByCategory(categoryId);
-    if (products.empty())
-    {
+    auto inCategory = [categoryId](const Product& p) { return p.getCategoryId() == categoryId; };
+    if (!printInventory(inventory, display, "PRODUCTS BY CATEGORY", inCategory))
         printInfo("No products in this category.");
-        return;
-    }
-
-    printTitle("PRODUCTS BY CATEGORY");
-    for (const auto& p : products)
-        printProductDetailed(inventory, p);
 }
 
 // ===================== STOCK =====================
@@ -664,7 +834,11 @@ void ConsoleMenu::stockIn()
         return;
     }
 
-    inventory.stockIn(serial, amount);
+    if (!inventory.stockIn(serial, amount))
+    {
+        printError(inventory.journalFailed() ? "Journal write failed; stock was not changed." : "Stock IN failed: quantity would overflow.");
+        return;
+    }
     printOk("Stock updated.");
     printInfo("New quantity: " + std::to_string(p->getQuantity()));
 }
@@ -709,7 +883,11 @@ void ConsoleMenu::stockOut()
         return;
     }
 
-    inventory.stockOut(serial, amount);
+    if (!inventory.stockOut(serial, amount))
+    {
+        printError(inventory.journalFailed() ? "Journal write failed; stock was not changed." : "Not enough quantity.");
+        return;
+    }
     printOk("Stock updated.");
     printInfo("New quantity: " + std::to_string(p->getQuantity()));
 }
@@ -718,8 +896,169 @@ void ConsoleMenu::stockOut()
 
 void ConsoleMenu::saveData()
 {
-    if (inventory.saveToFile("warehouse.json"))
+    if (inventory.checkpoint("warehouse.snap"))
         printOk("Data saved.");
     else
         printError("Save failed.");
 }
+
+void ConsoleMenu::exportData()
+{
+    if (inventory.saveToFile("warehouse.json"))
+        printOk("Data exported to warehouse.json.");
+    else
+        printError("Export failed.");
+}
+
+// ===================== REPORTS =====================
+
+void ConsoleMenu::showReport()
+{
+    printTitle("GROUP REPORT BY");
+    std::cout << "1. Category\n";
+    std::cout << "2. Brand\n";
+    std::cout << "3. CPU\n";
+    std::cout << "4. Type\n";
+    std::cout << "Choice (1-4): ";
+
+    int choice;
+    std::cin >> choice;
+    if (std::cin.fail())
+    {
+        clearInput();
+        printError("Invalid input.");
+        return;
+    }
+    clearInput();
+
+    ReportGroup groupBy;
+    switch (choice)
+    {
+    case 1: groupBy = ReportGroup::Category; break;
+    case 2: groupBy = ReportGroup::Brand; break;
+    case 3: groupBy = ReportGroup::Cpu; break;
+    case 4: groupBy = ReportGroup::Type; break;
+    default: printError("Invalid report choice."); return;
+    }
+
+    Report report = InventoryReport::build(inventory, groupBy);
+    if (report.rows.empty())
+    {
+        printInfo("No products.");
+        return;
+    }
+
+    printTitle(std::string("STOCK REPORT BY ") + InventoryReport::groupName(groupBy));
+
+    auto printRow = [](const ReportRow& row)
+    {
+        std::cout << std::left << std::setw(20) << row.group << std::right
+            << std::setw(10) << row.products
+            << std::setw(12) << row.units
+            << std::setw(16) << row.value
+            << std::setw(12) << row.minPrice
+            << std::setw(12) << row.maxPrice << "\n";
+    };
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(20) << "Group" << std::right
+        << std::setw(10) << "Products"
+        << std::setw(12) << "Units"
+        << std::setw(16) << "Value"
+        << std::setw(12) << "Min price"
+        << std::setw(12) << "Max price" << "\n";
+    for (const auto& row : report.rows)
+        printRow(row);
+    std::cout << "----------------------------------------\n";
+    printRow(report.total);
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+void ConsoleMenu::showMetrics()
+{
+    if (!Metrics::enabled())
+    {
+        printInfo("Metrics are compiled out of this build.");
+        return;
+    }
+
+    nlohmann::json metrics = Metrics::toJson();
+    if (metrics["operations"].empty())
+    {
+        printInfo("No operations recorded yet.");
+        return;
+    }
+
+    printTitle("OPERATION METRICS");
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(24) << "Operation" << std::right
+        << std::setw(12) << "Calls"
+        << std::setw(12) << "p50 us"
+        << std::setw(12) << "p99 us"
+        << std::setw(14) << "Max us" << "\n";
+    for (const auto& row : metrics["operations"])
+    {
+        std::cout << std::left << std::setw(24) << row["operation"].get<std::string>() << std::right
+            << std::setw(12) << row["calls"].get<std::uint64_t>()
+            << std::setw(12) << row["p50Us"].get<double>()
+            << std::setw(12) << row["p99Us"].get<double>()
+            << std::setw(14) << row["maxUs"].get<double>() << "\n";
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+void ConsoleMenu::showMemory()
+{
+    nlohmann::json memory = MemoryAccounting::toJson(inventory.memoryUsage());
+    const double products = memory["products"].get<double>();
+
+    printTitle("MEMORY REPORT");
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(1);
+
+    std::cout << "Products: " << memory["products"].get<std::size_t>() << "\n\n";
+    std::cout << std::left << std::setw(20) << "Part" << std::right
+        << std::setw(16) << "Bytes"
+        << std::setw(14) << "Per product" << "\n";
+    for (const auto& part : memory["inventory"].items())
+    {
+        const double bytes = part.value().get<double>();
+        std::cout << std::left << std::setw(20) << part.key() << std::right
+            << std::setw(16) << part.value().get<std::uint64_t>()
+            << std::setw(14) << (products > 0 ? bytes / products : 0.0) << "\n";
+    }
+
+    std::cout << "\nResident: " << memory["process"]["rssBytes"].get<std::uint64_t>() / (1024 * 1024) << " MB"
+        << ", peak " << memory["process"]["peakRssBytes"].get<std::uint64_t>() / (1024 * 1024) << " MB\n";
+
+    if (!memory.contains("allocations"))
+    {
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+        printInfo("Allocation tallies need a build with TW_TRACK_ALLOCATIONS=1.");
+        return;
+    }
+
+    std::cout << "\n" << std::left << std::setw(20) << "Subsystem" << std::right
+        << std::setw(14) << "Allocations"
+        << std::setw(16) << "Live bytes"
+        << std::setw(16) << "Peak bytes" << "\n";
+    for (const auto& row : memory["allocations"])
+    {
+        std::cout << std::left << std::setw(20) << row["subsystem"].get<std::string>() << std::right
+            << std::setw(14) << row["allocations"].get<std::uint64_t>()
+            << std::setw(16) << row["liveBytes"].get<std::uint64_t>()
+            << std::setw(16) << row["peakBytes"].get<std::uint64_t>() << "\n";
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
@@ -1,19 +1,31 @@
 #pragma once
 
+#include <cstddef>
+
 #include "Inventory.h"
+#include "ProductRenderer.h"
+
+struct DisplayOptions {
+    ProductRenderer::Layout layout = ProductRenderer::Layout::Detailed;
+    std::size_t pageSize = 0;   // products per page; 0 lists everything at once
+};
 
 class ConsoleMenu {
 private:
     Inventory& inventory;
+    DisplayOptions display;
 
     // ---------- Core ----------
     void showMenu() const;
+    void displaySettings();
 
     // ---------- Products ----------
     void addProduct();
     void listProducts();
     void searchByName();
     void searchBySerial();
+    void queryProducts();
+    void countProducts();
     void editProduct();
     void removeProduct();
 
@@ -25,10 +37,16 @@ private:
     void stockIn();
     void stockOut();
 
+    // ---------- Reports ----------
+    void showReport();
+    void showMetrics();
+    void showMemory();
+
     // ---------- Persistence ----------
     void saveData();
+    void exportData();
 
 public:
-    explicit ConsoleMenu(Inventory& inventory);
+    explicit ConsoleMenu(Inventory& inventory, const DisplayOptions& display = DisplayOptions());
     void run();
 };
@@ -0,0 +1,10 @@
+#pragma once
+
+// Fault injection for tests/crash_recovery.sh. When the environment
+// variable TW_CRASH_POINT names `point`, hit() kills the process on the
+// spot (SIGKILL; TerminateProcess on Windows), leaving files exactly as a
+// crash there would. Otherwise it costs one comparison.
+class CrashPoint {
+public:
+    static void hit(const char* point);
+};
@@ -0,0 +1,47 @@
+#include "Crc32.h"
+
+namespace {
+    struct Crc32Tables {
+        std::uint32_t t[8][256];
+
+        Crc32Tables() {
+            for (std::uint32_t i = 0; i < 256; i++) {
+                std::uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                t[0][i] = c;
+            }
+
+            for (std::uint32_t i = 0; i < 256; i++) {
+                for (int s = 1; s < 8; s++)
+                    t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            }
+        }
+    };
+
+    const Crc32Tables& tables() {
+        static const Crc32Tables instance;
+        return instance;
+    }
+}
+
+std::uint32_t crc32(const void* data, std::size_t size, std::uint32_t crc) {
+    const auto& t = tables().t;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+
+    crc = ~crc;
+
+    while (size >= 8) {
+        std::uint32_t lo = crc ^ (static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+            (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24));
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        p += 8;
+        size -= 8;
+    }
+
+    while (size--)
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+
+    return ~crc;
+}
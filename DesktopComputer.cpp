@@ -17,6 +17,26 @@ DesktopComputer::DesktopComputer(
     ramGB(ramGB) {
 }
 
+const std::string& DesktopComputer::getCpu() const {
+    return cpu.str();
+}
+
+const InternedString& DesktopComputer::getInternedCpu() const {
+    return cpu;
+}
+
+const std::string& DesktopComputer::getGpu() const {
+    return gpu.str();
+}
+
+const InternedString& DesktopComputer::getInternedGpu() const {
+    return gpu;
+}
+
+int DesktopComputer::getRamGB() const {
+    return ramGB;
+}
+
 std::string DesktopComputer::getType() const {
     return "DesktopComputer";
 }
@@ -26,12 +46,12 @@ nlohmann::json DesktopComputer::toJson() const {
         {"type", getType()},
         {"serialNumber", serialNumber},
         {"name", name},
-        {"brand", brand},
+        {"brand", brand.str()},
         {"price", price},
-        {"quantity", quantity},
+        {"quantity", getQuantity()},
         {"categoryId", categoryId},
-        {"cpu", cpu},
-        {"gpu", gpu},
+        {"cpu", cpu.str()},
+        {"gpu", gpu.str()},
         {"ramGB", ramGB}
     };
 }
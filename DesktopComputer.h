@@ -1,10 +1,12 @@
+#pragma once
+
 #include "Product.h"
 #include <string>
 
 class DesktopComputer : public Product {
 private:
-    std::string cpu;
-    std::string gpu;
+    InternedString cpu;
+    InternedString gpu;
     int ramGB;
 
 public:
@@ -20,6 +22,12 @@ public:
         int ramGB
     );
 
+    const std::string& getCpu() const;
+    const InternedString& getInternedCpu() const;
+    const std::string& getGpu() const;
+    const InternedString& getInternedGpu() const;
+    int getRamGB() const;
+
     std::string getType() const override;
     nlohmann::json toJson() const override;
 
@@ -0,0 +1,137 @@
+#include "DurableFile.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+DurableFile::DurableFile()
+    : fd(-1) {
+}
+
+DurableFile::~DurableFile() {
+    close();
+}
+
+DurableFile::DurableFile(DurableFile&& other) noexcept
+    : fd(other.fd) {
+    other.fd = -1;
+}
+
+DurableFile& DurableFile::operator=(DurableFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        other.fd = -1;
+    }
+    return *this;
+}
+
+bool DurableFile::open(const std::string& path, Mode mode) {
+    close();
+
+#ifdef _WIN32
+    int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (mode == Mode::Append ? _O_APPEND : _O_TRUNC);
+    _sopen_s(&fd, path.c_str(), flags, _SH_DENYWR, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (mode == Mode::Append ? O_APPEND : O_TRUNC);
+    fd = ::open(path.c_str(), flags, 0644);
+#endif
+    return fd >= 0;
+}
+
+void DurableFile::close() {
+    if (fd < 0)
+        return;
+
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    fd = -1;
+}
+
+bool DurableFile::isOpen() const {
+    return fd >= 0;
+}
+
+bool DurableFile::write(const void* data, std::size_t size) {
+    const char* p = static_cast<const char*>(data);
+
+    while (size > 0) {
+#ifdef _WIN32
+        unsigned chunk = size > 0x40000000u ? 0x40000000u : static_cast<unsigned>(size);
+        int n = _write(fd, p, chunk);
+#else
+        ssize_t n = ::write(fd, p, size);
+#endif
+        if (n <= 0)
+            return false;
+
+        p += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool DurableFile::writeAt(std::uint64_t offset, const void* data, std::size_t size) {
+#ifdef _WIN32
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0)
+        return false;
+    bool ok = write(data, size);
+    return _lseeki64(fd, 0, SEEK_END) >= 0 && ok;
+#else
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (n <= 0)
+            return false;
+
+        p += n;
+        offset += static_cast<std::uint64_t>(n);
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+#endif
+}
+
+bool DurableFile::sync() {
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#elif defined(__linux__)
+    return fdatasync(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+bool DurableFile::truncate(std::uint64_t size) {
+#ifdef _WIN32
+    return _chsize_s(fd, static_cast<__int64>(size)) == 0;
+#else
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+void DurableFile::syncParentDirectory(const std::string& path) {
+#ifndef _WIN32
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    if (dir.empty())
+        dir = ".";
+
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (dfd >= 0) {
+        fsync(dfd);
+        ::close(dfd);
+    }
+#else
+    (void)path;
+#endif
+}
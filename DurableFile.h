@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Thin unbuffered file handle with explicit flush-to-disk, used where the
+// stream library cannot promise durability (snapshots, the journal).
+class DurableFile {
+private:
+    int fd;
+
+public:
+    enum class Mode { Append, Truncate };
+
+    DurableFile();
+    ~DurableFile();
+
+    DurableFile(const DurableFile&) = delete;
+    DurableFile& operator=(const DurableFile&) = delete;
+    DurableFile(DurableFile&& other) noexcept;
+    DurableFile& operator=(DurableFile&& other) noexcept;
+
+    bool open(const std::string& path, Mode mode);
+    void close();
+    bool isOpen() const;
+
+    bool write(const void* data, std::size_t size);
+    // Overwrites bytes already in the file; not for Append mode.
+    bool writeAt(std::uint64_t offset, const void* data, std::size_t size);
+    bool sync();
+    bool truncate(std::uint64_t size);
+
+    // Makes a completed rename inside `path`'s directory durable (no-op on Windows).
+    static void syncParentDirectory(const std::string& path);
+};
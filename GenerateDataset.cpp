@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "DesktopComputer.h"
+#include "Laptop.h"
+#include "Phone.h"
+#include "ProductCodec.h"
+#include "ProductGenerator.h"
+#include "Snapshot.h"
+#include "ThreadPool.h"
+
+// Writes large synthetic warehouse files for sizing: JSON in the format
+// the loaders read, or a binary snapshot when the output ends in ".snap".
+// Records are generated in parallel, chunk by chunk, and written in order,
+// so memory use does not grow with the record count.
+
+struct GenerateOptions {
+    std::uint64_t count = 1000000;
+    std::uint64_t seed = 42;
+    std::string outFile;
+    double skew = 0.0;
+    double malformedRate = 0.0;
+    double duplicateRate = 0.0;
+    std::string brands;
+    std::string cpus;
+    std::string gpus;
+    std::string models;
+    std::string types;
+};
+
+struct GenerateStats {
+    std::uint64_t records = 0;
+    std::uint64_t malformed = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t bytes = 0;
+};
+
+// Records per chunk, and chunks in flight per worker.
+static const std::uint64_t kChunkRecords = 16 * 1024;
+static const std::size_t kChunksPerThread = 2;
+
+// Streams for ProductGenerator::random, one per kind of decision.
+enum RandomStream : std::uint64_t {
+    KindStream = 1,
+    DefectStream = 2,
+    DuplicateStream = 3
+};
+
+enum class RecordKind { Normal, Malformed, Duplicate };
+
+static bool isSnapshotPath(const std::string& path) {
+    const std::string ext = ".snap";
+    return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+static RecordKind kindOf(const ProductGenerator& generator, const GenerateOptions& options, std::uint64_t index) {
+    const double r = static_cast<double>(generator.random(index, KindStream) >> 11) * (1.0 / 9007199254740992.0);
+    if (r < options.malformedRate)
+        return RecordKind::Malformed;
+    if (index > 0 && r < options.malformedRate + options.duplicateRate)
+        return RecordKind::Duplicate;
+    return RecordKind::Normal;
+}
+
+// A duplicate reuses the serial of a recent record; the loaders keep the
+// first one they see.
+static std::string duplicateSerial(const ProductGenerator& generator, std::uint64_t index) {
+    const std::uint64_t back = 1 + generator.random(index, DuplicateStream) % (index < 1000 ? index : 1000);
+    return ProductGenerator::serialFor(index - back);
+}
+
+// ===================== JSON =====================
+
+static void appendString(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+static void appendField(std::string& out, const char* key, const std::string& value) {
+    out += '"';
+    out += key;
+    out += "\":";
+    appendString(out, value);
+    out += ',';
+}
+
+static void appendField(std::string& out, const char* key, long long value) {
+    out += '"';
+    out += key;
+    out += "\":";
+    out += std::to_string(value);
+    out += ',';
+}
+
+static void appendPrice(std::string& out, double price) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "\"price\":%.2f,", price);
+    out += buffer;
+}
+
+// Same fields and names as the types' toJson.
+static void appendJson(std::string& out, const Product& p) {
+    out += '{';
+    appendField(out, "type", p.getType());
+    appendField(out, "serialNumber", p.getSerialNumber());
+    appendField(out, "name", p.getName());
+    appendField(out, "brand", p.getBrand());
+    appendPrice(out, p.getPrice());
+    appendField(out, "quantity", p.getQuantity());
+    appendField(out, "categoryId", p.getCategoryId());
+
+    if (const auto* laptop = dynamic_cast<const Laptop*>(&p)) {
+        appendField(out, "cpu", laptop->getCpu());
+        appendField(out, "ramGB", laptop->getRamGB());
+        appendField(out, "storageGB", laptop->getStorageGB());
+    }
+    else if (const auto* phone = dynamic_cast<const Phone*>(&p)) {
+        appendField(out, "cpu", phone->getCpu());
+        appendField(out, "storageGB", phone->getStorageGB());
+        out += "\"has5G\":";
+        out += phone->supports5G() ? "true," : "false,";
+    }
+    else if (const auto* desktop = dynamic_cast<const DesktopComputer*>(&p)) {
+        appendField(out, "cpu", desktop->getCpu());
+        appendField(out, "gpu", desktop->getGpu());
+        appendField(out, "ramGB", desktop->getRamGB());
+    }
+
+    out.back() = '}';
+}
+
+// Still valid JSON, so the document parses, but each is rejected by fromJson.
+static void appendMalformed(std::string& out, const Product& p, std::uint64_t r) {
+    std::string record;
+    appendJson(record, p);
+
+    switch (r % 4) {
+    case 0: {
+        // required field missing
+        std::size_t at = record.find("\"price\":");
+        std::size_t end = record.find(',', at);
+        record.erase(at, end - at + 1);
+        break;
+    }
+    case 1: {
+        // wrong type
+        std::size_t at = record.find("\"quantity\":") + 11;
+        record.insert(at, "\"");
+        record.insert(record.find(',', at), "\"");
+        break;
+    }
+    case 2: {
+        // unknown product type
+        std::size_t at = record.find("\"type\":\"") + 8;
+        record.insert(at, "Unknown");
+        break;
+    }
+    default:
+        // not an object at all
+        record = "\"" + p.getSerialNumber() + "\"";
+        break;
+    }
+    out += record;
+}
+
+// ===================== CHUNKS =====================
+
+static void generateChunk(const ProductGenerator& generator, const GenerateOptions& options, bool binary,
+    std::uint64_t first, std::uint64_t last, std::string& out, GenerateStats& stats) {
+    out.clear();
+    BinaryWriter writer(out);
+
+    for (std::uint64_t i = first; i < last; i++) {
+        const RecordKind kind = kindOf(generator, options, i);
+        std::shared_ptr<Product> product = kind == RecordKind::Duplicate
+            ? generator.make(i, duplicateSerial(generator, i))
+            : generator.make(i);
+
+        if (kind == RecordKind::Malformed) {
+            stats.malformed++;
+            // A snapshot has no way to carry a bad record.
+            if (binary)
+                continue;
+        }
+        if (kind == RecordKind::Duplicate)
+            stats.duplicates++;
+
+        if (binary) {
+            ProductCodec::encode(*product, writer);
+        }
+        else {
+            if (i > 0)
+                out += ",\n";
+            if (kind == RecordKind::Malformed)
+                appendMalformed(out, *product, generator.random(i, DefectStream));
+            else
+                appendJson(out, *product);
+        }
+        stats.records++;
+    }
+}
+
+static bool generate(const GenerateOptions& options, const ProductMix& mix, GenerateStats& total) {
+    const bool binary = isSnapshotPath(options.outFile);
+    ProductGenerator generator(options.seed, mix);
+    ThreadPool& pool = ThreadPool::shared();
+
+    std::ofstream json;
+    SnapshotWriter snapshot;
+    if (binary) {
+        if (!snapshot.open(options.outFile))
+            return false;
+    }
+    else {
+        json.open(options.outFile, std::ios::binary);
+        if (!json.is_open())
+            return false;
+        json << "{\"products\":[\n";
+    }
+
+    const std::uint64_t chunks = (options.count + kChunkRecords - 1) / kChunkRecords;
+    const std::size_t wave = pool.size() * kChunksPerThread;
+    std::vector<std::string> buffers(wave);
+    std::vector<GenerateStats> stats(wave);
+
+    for (std::uint64_t start = 0; start < chunks; start += wave) {
+        const std::size_t inWave = static_cast<std::size_t>(std::min<std::uint64_t>(wave, chunks - start));
+
+        pool.parallelFor(inWave, [&](std::size_t k) {
+            const std::uint64_t first = (start + k) * kChunkRecords;
+            const std::uint64_t last = std::min(options.count, first + kChunkRecords);
+            stats[k] = GenerateStats();
+            generateChunk(generator, options, binary, first, last, buffers[k], stats[k]);
+        });
+
+        for (std::size_t k = 0; k < inWave; k++) {
+            if (binary) {
+                if (!snapshot.append(buffers[k], stats[k].records))
+                    return false;
+            }
+            else if (!json.write(buffers[k].data(), static_cast<std::streamsize>(buffers[k].size()))) {
+                return false;
+            }
+            total.records += stats[k].records;
+            total.malformed += stats[k].malformed;
+            total.duplicates += stats[k].duplicates;
+            total.bytes += buffers[k].size();
+        }
+
+        std::cerr << "\r" << std::min(options.count, (start + inWave) * kChunkRecords) << " / " << options.count << std::flush;
+    }
+    std::cerr << "\n";
+
+    if (binary)
+        return snapshot.finish();
+
+    json << "\n]}\n";
+    json.flush();
+    return static_cast<bool>(json);
+}
+
+// ===================== MAIN =====================
+
+// "Dell:5,HP:3,Apple" -> weights 5, 3 and 1. The skew applies only to
+// lists without explicit weights.
+static bool parseWeighted(const std::string& text, double skew, WeightedValues& out) {
+    std::stringstream in(text);
+    std::string item;
+    bool weighted = false;
+
+    try {
+        while (std::getline(in, item, ',')) {
+            if (item.empty())
+                return false;
+            std::size_t colon = item.rfind(':');
+            if (colon == std::string::npos) {
+                out.add(item);
+                continue;
+            }
+            std::size_t used = 0;
+            std::string weight = item.substr(colon + 1);
+            double w = std::stod(weight, &used);
+            if (used != weight.size() || w <= 0.0)
+                return false;
+            out.add(item.substr(0, colon), w);
+            weighted = true;
+        }
+    }
+    catch (...) {
+        return false;
+    }
+
+    if (out.empty())
+        return false;
+    if (!weighted)
+        out.applySkew(skew);
+    return true;
+}
+
+// "laptop:2,phone:5,desktop:1"
+static bool parseTypes(const std::string& text, ProductMix& mix) {
+    std::stringstream in(text);
+    std::string item;
+    mix.laptopWeight = mix.phoneWeight = mix.desktopWeight = 0.0;
+
+    try {
+        while (std::getline(in, item, ',')) {
+            std::size_t colon = item.find(':');
+            std::string name = item.substr(0, colon);
+            double w = colon == std::string::npos ? 1.0 : std::stod(item.substr(colon + 1));
+            if (w < 0.0)
+                return false;
+            if (name == "laptop")
+                mix.laptopWeight = w;
+            else if (name == "phone")
+                mix.phoneWeight = w;
+            else if (name == "desktop")
+                mix.desktopWeight = w;
+            else
+                return false;
+        }
+    }
+    catch (...) {
+        return false;
+    }
+    return mix.laptopWeight + mix.phoneWeight + mix.desktopWeight > 0.0;
+}
+
+// An empty option keeps the built-in list.
+static bool replaceList(const std::string& text, double skew, WeightedValues& list) {
+    if (text.empty())
+        return true;
+    list = WeightedValues();
+    return parseWeighted(text, skew, list);
+}
+
+static bool buildMix(const GenerateOptions& options, ProductMix& mix) {
+    mix = ProductMix::defaults(options.skew);
+
+    return replaceList(options.brands, options.skew, mix.brands) &&
+        replaceList(options.cpus, options.skew, mix.cpus) &&
+        replaceList(options.gpus, options.skew, mix.gpus) &&
+        replaceList(options.models, options.skew, mix.models) &&
+        (options.types.empty() || parseTypes(options.types, mix));
+}
+
+static void printUsage() {
+    std::cerr << "Usage: TechWarehouseGen --out <file.json|file.snap> [--count <n>] [--seed <n>]\n"
+        << "                        [--brands A:w,B:w,...] [--cpus ...] [--gpus ...] [--models ...]\n"
+        << "                        [--types laptop:w,phone:w,desktop:w] [--skew <zipf exponent>]\n"
+        << "                        [--malformed <fraction>] [--duplicates <fraction>]\n"
+        << "Malformed records are left out of snapshots.\n";
+}
+
+int main(int argc, char* argv[]) {
+    GenerateOptions options;
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[i + 1];
+
+        try {
+            if (option == "--out")
+                options.outFile = value;
+            else if (option == "--count")
+                options.count = std::stoull(value);
+            else if (option == "--seed")
+                options.seed = std::stoull(value);
+            else if (option == "--skew")
+                options.skew = std::stod(value);
+            else if (option == "--malformed")
+                options.malformedRate = std::stod(value);
+            else if (option == "--duplicates")
+                options.duplicateRate = std::stod(value);
+            else if (option == "--brands")
+                options.brands = value;
+            else if (option == "--cpus")
+                options.cpus = value;
+            else if (option == "--gpus")
+                options.gpus = value;
+            else if (option == "--models")
+                options.models = value;
+            else if (option == "--types")
+                options.types = value;
+            else {
+                printUsage();
+                return 1;
+            }
+        }
+        catch (...) {
+            printUsage();
+            return 1;
+        }
+    }
+
+    ProductMix mix;
+    if (options.outFile.empty() || options.malformedRate < 0.0 || options.duplicateRate < 0.0 ||
+        options.malformedRate + options.duplicateRate > 1.0 || !buildMix(options, mix)) {
+        printUsage();
+        return 1;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    GenerateStats stats;
+    if (!generate(options, mix, stats)) {
+        std::cerr << "Failed to write " << options.outFile << ".\n";
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << "Wrote " << stats.records << " records (" << stats.malformed << " malformed, "
+        << stats.duplicates << " duplicate serials) to " << options.outFile << ": "
+        << stats.bytes / (1024.0 * 1024.0) << " MB in " << seconds << " s\n";
+    return 0;
+}
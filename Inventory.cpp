@@ -2,11 +2,25 @@
 
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <climits>
+#include <filesystem>
+#include <unordered_map>
+#include <type_traits>
 #include <nlohmann/json.hpp>
 
 #include "Laptop.h"
 #include "Phone.h"
 #include "DesktopComputer.h"
+#include "ProductStore.h"
+#include "CrashPoint.h"
+#include "DurableFile.h"
+#include "Journal.h"
+#include "MappedFile.h"
+#include "MemoryAccounting.h"
+#include "ProductSaxLoader.h"
+#include "Snapshot.h"
+#include "Trace.h"
 
 using json = nlohmann::json;
 
@@ -28,6 +42,11 @@ Inventory::Inventory() {
     categories.emplace_back(3, "Desktop", "Desktop computers");
 }
 
+Inventory::~Inventory() {
+    for (const auto& p : products)
+        p->setAttached(false);
+}
+
 // ===================== CATEGORIES =====================
 
 const std::vector<Category>& Inventory::getCategories() const {
@@ -44,62 +63,241 @@ const Category* Inventory::getCategoryById(int id) const {
 
 // ===================== PRODUCTS =====================
 
-void Inventory::addProduct(const std::shared_ptr<Product>& product) {
-    if (!product)
+bool Inventory::attachProduct(const std::shared_ptr<Product>& product, bool ordered) {
+    MemoryAccounting::Scope memory(MemorySubsystem::Indexes);
+    if (!serialIndex.insert(product->getSerialNumber(), products.size()))
+        return false;
+
+    products.push_back(product);
+    columns.push(*product);
+    bitmaps.push(*product);
+    nameIndex.add(product.get());
+    if (ordered) {
+        priceIndex.insert(product->getPrice(), product.get());
+        quantityIndex.insert(product->getQuantity(), product.get());
+    }
+    product->setAttached(true);
+    return true;
+}
+
+// Swap-and-pop: the last product takes the freed slot, so removal is O(1).
+// Queued quantity changes name rows by position, so they go in first.
+void Inventory::detachProductAt(std::size_t position) {
+    foldPendingQuantities();
+    products[position]->setAttached(false);
+    nameIndex.remove(products[position].get());
+    priceIndex.erase(columns.prices()[position], products[position].get());
+    quantityIndex.erase(columns.quantities()[position], products[position].get());
+    serialIndex.erase(products[position]->getSerialNumber());
+
+    std::size_t last = products.size() - 1;
+    if (position != last) {
+        products[position] = std::move(products[last]);
+        serialIndex.setPosition(products[position]->getSerialNumber(), position);
+    }
+    products.pop_back();
+    columns.removeAt(position);
+    bitmaps.removeAt(position);
+}
+
+void Inventory::replaceProductAt(std::size_t position, const std::shared_ptr<Product>& product) {
+    MemoryAccounting::Scope memory(MemorySubsystem::Indexes);
+    foldPendingQuantities();
+    products[position]->setAttached(false);
+    nameIndex.remove(products[position].get());
+    priceIndex.erase(columns.prices()[position], products[position].get());
+    quantityIndex.erase(columns.quantities()[position], products[position].get());
+    serialIndex.erase(products[position]->getSerialNumber());
+
+    products[position] = product;
+    columns.replaceAt(position, *product);
+    bitmaps.replaceAt(position, *product);
+    serialIndex.insert(product->getSerialNumber(), position);
+    nameIndex.add(product.get());
+    priceIndex.insert(product->getPrice(), product.get());
+    quantityIndex.insert(product->getQuantity(), product.get());
+    product->setAttached(true);
+}
+
+void Inventory::quantityChanged(std::size_t position, std::size_t shard) {
+    const int before = columns.quantities()[position];
+    const int now = products[position]->getQuantity();
+    if (before == now)
         return;
 
-    if (serialExists(product->getSerialNumber()))
+    columns.setQuantity(position, now);
+
+    MemoryAccounting::Scope memory(MemorySubsystem::Indexes);
+    std::vector<QuantityChange>& pending = pendingQuantities[shard].changes;
+    pending.push_back({ position, before, now });
+    pendingQuantityCount.fetch_add(1, std::memory_order_relaxed);
+    if (pending.size() >= kMaxPendingQuantities) {
+        std::lock_guard<std::mutex> lock(foldMutex);
+        foldQuantities(pending);
+    }
+}
+
+// Readers hold every shard shared, so no stock movement can queue more
+// meanwhile; the first reader folds and the rest find nothing to do.
+void Inventory::foldPendingQuantities() const {
+    if (pendingQuantityCount.load(std::memory_order_acquire) == 0)
         return;
 
-    products.push_back(product);
+    std::lock_guard<std::mutex> lock(foldMutex);
+    for (auto& shard : pendingQuantities)
+        foldQuantities(shard.changes);
 }
 
-bool Inventory::serialExists(const std::string& serial) const {
-    if (serial.empty())
+// Changes to one product all queue on its shard, in order. A product that
+// moved several times is moved in the indexes once, from its first old
+// value to its last new one, and not at all when those are equal. The
+// moves then run in key order, so consecutive tree walks share their path.
+void Inventory::foldQuantities(std::vector<QuantityChange>& changes) const {
+    if (changes.empty())
+        return;
+
+    MemoryAccounting::Scope memory(MemorySubsystem::Indexes);
+    const std::size_t queued = changes.size();
+    std::stable_sort(changes.begin(), changes.end(), [](const QuantityChange& a, const QuantityChange& b) {
+        return a.position < b.position;
+    });
+
+    std::size_t moves = 0;
+    for (std::size_t i = 0; i < changes.size();) {
+        QuantityChange net = changes[i];
+        while (i + 1 < changes.size() && changes[i + 1].position == net.position)
+            i++;
+        net.after = changes[i++].after;
+        if (net.before != net.after)
+            changes[moves++] = net;
+    }
+    changes.resize(moves);
+
+    std::sort(changes.begin(), changes.end(), [](const QuantityChange& a, const QuantityChange& b) {
+        return a.before < b.before;
+    });
+    for (const QuantityChange& change : changes)
+        quantityIndex.erase(change.before, products[change.position].get());
+
+    std::sort(changes.begin(), changes.end(), [](const QuantityChange& a, const QuantityChange& b) {
+        return a.after < b.after;
+    });
+    for (const QuantityChange& change : changes) {
+        quantityIndex.insert(change.after, products[change.position].get());
+        bitmaps.setQuantity(change.position, change.after);
+    }
+
+    pendingQuantityCount.fetch_sub(queued, std::memory_order_release);
+    changes.clear();
+}
+
+void Inventory::rebuildOrderedIndexes() {
+    Trace::Span span("rebuildOrderedIndexes", "index");
+    MemoryAccounting::Scope memory(MemorySubsystem::Indexes);
+    std::vector<OrderedIndex::Entry> prices;
+    std::vector<OrderedIndex::Entry> quantities;
+    prices.reserve(products.size());
+    quantities.reserve(products.size());
+    for (std::size_t i = 0; i < products.size(); i++) {
+        prices.push_back({ columns.prices()[i], products[i].get() });
+        quantities.push_back({ static_cast<double>(columns.quantities()[i]), products[i].get() });
+    }
+    priceIndex.assign(std::move(prices));
+    quantityIndex.assign(std::move(quantities));
+}
+
+bool Inventory::addProduct(const std::shared_ptr<Product>& product) {
+    Metrics::Scope metric(InventoryOp::AddProduct);
+    if (!product || product->getSerialNumber().empty() || product->getQuantity() < 0)
         return false;
 
-    for (const auto& p : products) {
-        if (p->getSerialNumber() == serial)
-            return true;
+    JournalTicket ticket;
+    {
+        std::lock_guard<ShardedMutex> lock(locks);
+        if (serialIndex.find(product->getSerialNumber()) != SerialIndex::npos)
+            return false;
+
+        if (journal && !(ticket = journal->logAdd(*product)))
+            return false;
+        attachProduct(product);
     }
-    return false;
+    return commitJournal(ticket);
+}
+
+bool Inventory::serialExists(std::string_view serial) const {
+    Metrics::Scope metric(InventoryOp::SerialExists);
+    if (serial.empty())
+        return false;
+
+    ShardLock lock(locks, locks.shardOf(serial), ShardLock::Shared);
+    return serialIndex.find(serial) != SerialIndex::npos;
+}
+
+std::shared_ptr<Product> Inventory::findBySerial(std::string_view serial) const {
+    Metrics::Scope metric(InventoryOp::FindBySerial);
+    return findProduct(serial);
 }
 
-std::shared_ptr<Product> Inventory::findBySerial(const std::string& serial) const {
+std::shared_ptr<Product> Inventory::findProduct(std::string_view serial) const {
     if (serial.empty())
         return nullptr;
 
-    for (const auto& p : products) {
-        if (p->getSerialNumber() == serial)
-            return p;
-    }
-    return nullptr;
+    ShardLock lock(locks, locks.shardOf(serial), ShardLock::Shared);
+    std::size_t position = serialIndex.find(serial);
+    if (position == SerialIndex::npos)
+        return nullptr;
+
+    return products[position];
 }
 
 std::vector<std::shared_ptr<Product>> Inventory::getAllProducts() const {
+    Metrics::Scope metric(InventoryOp::GetAllProducts);
+    ShardLock lock(locks, locks.shardOfThisThread(), ShardLock::Shared);
     return products;
 }
 
+ProductView Inventory::viewProducts() const {
+    return ProductView(products, locks);
+}
+
 std::vector<std::shared_ptr<Product>> Inventory::searchByName(const std::string& term) const {
+    Metrics::Scope metric(InventoryOp::SearchByName);
     std::vector<std::shared_ptr<Product>> result;
 
     if (term.empty())
         return result;
 
-    for (const auto& p : products) {
-        if (p->getName().find(term) != std::string::npos) {
-            result.push_back(p);
+    ShardLock lock(locks, locks.shardOfThisThread(), ShardLock::Shared);
+
+    if (term.size() < TrigramIndex::kGramSize) {
+        for (const auto& p : products) {
+            if (p->getName().find(term) != std::string::npos) {
+                result.push_back(p);
+            }
         }
+        return result;
     }
+
+    // Report matches in inventory order, same as a full scan would.
+    std::vector<std::size_t> positions;
+    for (const Product* p : nameIndex.search(term))
+        positions.push_back(serialIndex.find(p->getSerialNumber()));
+    std::sort(positions.begin(), positions.end());
+
+    result.reserve(positions.size());
+    for (std::size_t position : positions)
+        result.push_back(products[position]);
     return result;
 }
 
 std::vector<std::shared_ptr<Product>> Inventory::listByCategory(int categoryId) const {
+    Metrics::Scope metric(InventoryOp::ListByCategory);
     std::vector<std::shared_ptr<Product>> result;
 
     if (!getCategoryById(categoryId))
         return result;
 
+    ShardLock lock(locks, locks.shardOfThisThread(), ShardLock::Shared);
     for (const auto& p : products) {
         if (p->getCategoryId() == categoryId) {
             result.push_back(p);
@@ -109,99 +307,138 @@ std::vector<std::shared_ptr<Product>> Inventory::listByCategory(int categoryId)
 }
 
 bool Inventory::removeProductBySerial(const std::string& serial) {
+    Metrics::Scope metric(InventoryOp::RemoveProduct);
     if (serial.empty())
         return false;
 
-    auto it = std::remove_if(
-        products.begin(),
-        products.end(),
-        [&](const std::shared_ptr<Product>& p) {
-            return p->getSerialNumber() == serial;
-        }
-    );
-
-    if (it == products.end())
-        return false;
+    JournalTicket ticket;
+    {
+        std::lock_guard<ShardedMutex> lock(locks);
+        std::size_t position = serialIndex.find(serial);
+        if (position == SerialIndex::npos)
+            return false;
 
-    products.erase(it, products.end());
-    return true;
+        if (journal && !(ticket = journal->logRemove(serial)))
+            return false;
+        detachProductAt(position);
+    }
+    return commitJournal(ticket);
 }
 
 bool Inventory::updateProductFromJson(const std::string& currentSerial, const json& updatedJson)
 {
-    auto existing = findBySerial(currentSerial);
-    if (!existing)
+    Metrics::Scope metric(InventoryOp::UpdateProductFromJson);
+    if (currentSerial.empty())
         return false;
 
-    std::string newSerial = getStringAny(updatedJson, { "serialNumber", "serial", "SerialNumber", "Serial" });
-    if (newSerial.empty())
-        newSerial = existing->getSerialNumber();
+    std::string type;
+    if (getStringAny(updatedJson, { "type", "Type" }).empty()) {
+        auto current = findProduct(currentSerial);
+        if (!current)
+            return false;
+        type = current->getType();
+    }
 
-    if (newSerial != currentSerial && serialExists(newSerial))
+    std::shared_ptr<Product> newP = productFromJson(updatedJson, type);
+    if (!newP)
         return false;
 
-    std::string type = getStringAny(updatedJson, { "type", "Type" });
-    if (type.empty())
-        type = existing->getType();
+    return replaceProductBySerial(currentSerial, newP);
+}
 
-    std::shared_ptr<Product> newP;
+std::shared_ptr<Product> Inventory::productFromJson(const json& j, const std::string& fallbackType)
+{
+    MemoryAccounting::Scope memory(MemorySubsystem::Products);
+    std::string type = getStringAny(j, { "type", "Type" });
+    if (type.empty())
+        type = fallbackType;
 
+    std::shared_ptr<Product> product;
     try
     {
         if (type == "Laptop")
-            newP = std::make_shared<Laptop>(Laptop::fromJson(updatedJson));
+            product = ProductStore::make<Laptop>(Laptop::fromJson(j));
         else if (type == "Phone")
-            newP = std::make_shared<Phone>(Phone::fromJson(updatedJson));
+            product = ProductStore::make<Phone>(Phone::fromJson(j));
         else if (type == "DesktopComputer")
-            newP = std::make_shared<DesktopComputer>(DesktopComputer::fromJson(updatedJson));
-        else
-            return false;
+            product = ProductStore::make<DesktopComputer>(DesktopComputer::fromJson(j));
     }
     catch (...)
     {
-        return false;
     }
 
-    for (auto& p : products)
+    if (product && product->getQuantity() < 0)
+        return nullptr;
+    return product;
+}
+
+bool Inventory::replaceProduct(const std::string& currentSerial, const std::shared_ptr<Product>& product)
+{
+    Metrics::Scope metric(InventoryOp::ReplaceProduct);
+    return replaceProductBySerial(currentSerial, product);
+}
+
+bool Inventory::replaceProductBySerial(const std::string& currentSerial, const std::shared_ptr<Product>& product)
+{
+    if (currentSerial.empty() || !product || product->getQuantity() < 0)
+        return false;
+
+    const std::string& newSerial = product->getSerialNumber();
+    if (newSerial.empty())
+        return false;
+
+    JournalTicket ticket;
     {
-        if (p && p->getSerialNumber() == currentSerial)
-        {
-            p = newP;
-            return true;
-        }
-    }
+        std::lock_guard<ShardedMutex> lock(locks);
+        std::size_t position = serialIndex.find(currentSerial);
+        if (position == SerialIndex::npos)
+            return false;
+
+        if (newSerial != currentSerial && serialIndex.find(newSerial) != SerialIndex::npos)
+            return false;
 
-    return false;
+        if (journal && !(ticket = journal->logUpdate(currentSerial, *product)))
+            return false;
+        replaceProductAt(position, product);
+    }
+    return commitJournal(ticket);
 }
 
 // ===================== VALIDATIONS =====================
 
 bool Inventory::canStockIn(const std::string& serial, int amount) const {
+    Metrics::Scope metric(InventoryOp::CanStockIn);
     if (serial.empty())
         return false;
 
     if (amount <= 0)
         return false;
 
-    auto product = findBySerial(serial);
-    if (!product)
+    ShardLock lock(locks, locks.shardOf(serial), ShardLock::Shared);
+    std::size_t position = serialIndex.find(serial);
+    if (position == SerialIndex::npos)
+        return false;
+
+    if (products[position]->getQuantity() > INT_MAX - amount)
         return false;
 
     return true;
 }
 
 bool Inventory::canStockOut(const std::string& serial, int amount) const {
+    Metrics::Scope metric(InventoryOp::CanStockOut);
     if (serial.empty())
         return false;
 
     if (amount <= 0)
         return false;
 
-    auto product = findBySerial(serial);
-    if (!product)
+    ShardLock lock(locks, locks.shardOf(serial), ShardLock::Shared);
+    std::size_t position = serialIndex.find(serial);
+    if (position == SerialIndex::npos)
         return false;
 
-    if (amount > product->getQuantity())
+    if (amount > products[position]->getQuantity())
         return false;
 
     return true;
@@ -210,79 +447,546 @@ bool Inventory::canStockOut(const std::string& serial, int amount) const {
 // ===================== STOCK (DEFENSIVE) =====================
 
 bool Inventory::stockIn(const std::string& serial, int amount) {
-    if (!canStockIn(serial, amount))
+    Metrics::Scope metric(InventoryOp::StockIn);
+    if (serial.empty() || amount <= 0)
         return false;
 
-    auto product = findBySerial(serial);
-    product->increaseQuantity(amount);
-    return true;
+    JournalTicket ticket;
+    {
+        const std::size_t shard = locks.shardOf(serial);
+        ShardLock lock(locks, shard, ShardLock::Exclusive);
+        std::size_t position = serialIndex.find(serial);
+        if (position == SerialIndex::npos)
+            return false;
+
+        if (products[position]->getQuantity() > INT_MAX - amount)
+            return false;
+
+        // The shard is held, so the check above still holds when applying.
+        if (journal && !(ticket = journal->logStockIn(serial, amount)))
+            return false;
+        products[position]->increaseQuantity(amount);
+        quantityChanged(position, shard);
+    }
+    return commitJournal(ticket);
 }
 
 bool Inventory::stockOut(const std::string& serial, int amount) {
-    if (!canStockOut(serial, amount))
+    Metrics::Scope metric(InventoryOp::StockOut);
+    if (serial.empty() || amount <= 0)
         return false;
 
-    auto product = findBySerial(serial);
-    return product->decreaseQuantity(amount);
+    JournalTicket ticket;
+    {
+        const std::size_t shard = locks.shardOf(serial);
+        ShardLock lock(locks, shard, ShardLock::Exclusive);
+        std::size_t position = serialIndex.find(serial);
+        if (position == SerialIndex::npos)
+            return false;
+
+        if (amount > products[position]->getQuantity())
+            return false;
+
+        // Every writer of the quantity holds this shard, so the check above
+        // still holds and decreaseQuantity cannot fail.
+        if (journal && !(ticket = journal->logStockOut(serial, amount)))
+            return false;
+        products[position]->decreaseQuantity(amount);
+        quantityChanged(position, shard);
+    }
+    return commitJournal(ticket);
+}
+
+// Called with no Inventory lock held: waiting for the record's fsync (and,
+// during a checkpoint, for the sealed segment's) stalls only this caller.
+// A change whose record was lost stays applied; the journal then refuses
+// changes, and the checkpoint that follows writes it with the snapshot.
+bool Inventory::commitJournal(const JournalTicket& ticket) {
+    return !ticket || !journal || journal->commit(ticket);
+}
+
+// ===================== BATCHES =====================
+
+BatchResult Inventory::applyBatch(const std::vector<StockOperation>& operations) {
+    Metrics::Scope metric(InventoryOp::ApplyBatch);
+    Trace::Span span("applyBatch", "batch");
+    span.arg("operations", operations.size());
+
+    JournalTicket ticket;
+    BatchResult result = applyBatchInMemory(operations, ticket);
+    if (result.applied && !commitJournal(ticket))
+        result.journalFailed = true;
+    return result;
+}
+
+// Checks, journals and applies the batch under its shards; the journal
+// ticket is committed once they are released.
+BatchResult Inventory::applyBatchInMemory(const std::vector<StockOperation>& operations, JournalTicket& ticket) {
+    BatchResult result;
+    result.lines.assign(operations.size(), StockLineStatus::Ok);
+    if (operations.empty()) {
+        result.applied = true;
+        return result;
+    }
+
+    ShardedMutex::ShardSet shards;
+    for (const auto& op : operations)
+        shards.set(locks.shardOf(op.serial));
+    ShardSetLock lock(locks, shards);
+
+    // Quantity each touched product would have after the lines so far.
+    std::unordered_map<std::size_t, int> running;
+    running.reserve(operations.size());
+    bool valid = true;
+
+    for (std::size_t i = 0; i < operations.size(); i++) {
+        const StockOperation& op = operations[i];
+        StockLineStatus& status = result.lines[i];
+
+        std::size_t position = op.serial.empty() ? SerialIndex::npos : serialIndex.find(op.serial);
+        if (position == SerialIndex::npos)
+            status = StockLineStatus::NotFound;
+        else if (op.amount <= 0)
+            status = StockLineStatus::InvalidAmount;
+        else {
+            int& quantity = running.try_emplace(position, products[position]->getQuantity()).first->second;
+            if (op.kind == StockOperation::In) {
+                if (quantity > INT_MAX - op.amount)
+                    status = StockLineStatus::InvalidAmount;
+                else
+                    quantity += op.amount;
+            }
+            else {
+                if (op.amount > quantity)
+                    status = StockLineStatus::InsufficientStock;
+                else
+                    quantity -= op.amount;
+            }
+        }
+
+        if (status != StockLineStatus::Ok)
+            valid = false;
+    }
+
+    if (!valid)
+        return result;
+
+    if (journal && !(ticket = journal->logBatch(operations))) {
+        result.journalFailed = true;
+        return result;
+    }
+    CrashPoint::hit("batch.logged");
+
+    // Every writer of these quantities holds its shard, so nothing moves
+    // them in between; the change is applied as a movement.
+    for (const auto& [position, quantity] : running) {
+        Product& product = *products[position];
+        int delta = quantity - product.getQuantity();
+        if (delta > 0)
+            product.increaseQuantity(delta);
+        else if (delta < 0)
+            product.decreaseQuantity(-delta);
+        quantityChanged(position, locks.shardOf(product.getSerialNumber()));
+    }
+
+    result.applied = true;
+    return result;
+}
+
+// ===================== AGGREGATES =====================
+
+// Each aggregate holds every shard shared: stock movements wait, so the
+// columns are read as one consistent state, but readers never block each other.
+double Inventory::getStockValue() const {
+    Metrics::Scope metric(InventoryOp::GetStockValue);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.stockValue();
+}
+
+double Inventory::getStockValue(int categoryId) const {
+    Metrics::Scope metric(InventoryOp::GetStockValue);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.stockValue(categoryId);
+}
+
+long long Inventory::getTotalUnits() const {
+    Metrics::Scope metric(InventoryOp::GetTotalUnits);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.totalUnits();
+}
+
+long long Inventory::getTotalUnits(int categoryId) const {
+    Metrics::Scope metric(InventoryOp::GetTotalUnits);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.totalUnits(categoryId);
+}
+
+std::size_t Inventory::countLowStock(int below) const {
+    Metrics::Scope metric(InventoryOp::CountLowStock);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.countBelow(below);
+}
+
+std::size_t Inventory::countLowStock(int below, int categoryId) const {
+    Metrics::Scope metric(InventoryOp::CountLowStock);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.countBelow(below, categoryId);
+}
+
+bool Inventory::getPriceRange(double& minPrice, double& maxPrice) const {
+    Metrics::Scope metric(InventoryOp::GetPriceRange);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return columns.priceRange(minPrice, maxPrice);
+}
+
+// ===================== RANGES =====================
+
+// Caller holds every shard shared.
+std::vector<std::shared_ptr<Product>> Inventory::collect(const OrderedIndex& index, double low, double high, bool descending, std::size_t limit) const {
+    std::vector<std::shared_ptr<Product>> result;
+    if (limit == 0)
+        return result;
+
+    index.scan(low, high, descending, [&](const OrderedIndex::Entry& entry) {
+        result.push_back(products[serialIndex.find(entry.product->getSerialNumber())]);
+        return result.size() < limit;
+    });
+    return result;
+}
+
+std::vector<std::shared_ptr<Product>> Inventory::findByPriceRange(double minPrice, double maxPrice, std::size_t limit) const {
+    Metrics::Scope metric(InventoryOp::FindByPriceRange);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return collect(priceIndex, minPrice, maxPrice, false, limit);
+}
+
+std::size_t Inventory::countByPriceRange(double minPrice, double maxPrice) const {
+    Metrics::Scope metric(InventoryOp::CountByPriceRange);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return priceIndex.count(minPrice, maxPrice);
+}
+
+std::vector<std::shared_ptr<Product>> Inventory::findByQuantityRange(int minQuantity, int maxQuantity, std::size_t limit) const {
+    Metrics::Scope metric(InventoryOp::FindByQuantityRange);
+    std::shared_lock<ShardedMutex> lock(locks);
+    foldPendingQuantities();
+    return collect(quantityIndex, minQuantity, maxQuantity, false, limit);
+}
+
+std::size_t Inventory::countByQuantityRange(int minQuantity, int maxQuantity) const {
+    Metrics::Scope metric(InventoryOp::CountByQuantityRange);
+    std::shared_lock<ShardedMutex> lock(locks);
+    foldPendingQuantities();
+    return quantityIndex.count(minQuantity, maxQuantity);
+}
+
+std::vector<std::shared_ptr<Product>> Inventory::lowestStock(std::size_t k) const {
+    Metrics::Scope metric(InventoryOp::LowestStock);
+    std::shared_lock<ShardedMutex> lock(locks);
+    foldPendingQuantities();
+    return collect(quantityIndex, -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), false, k);
+}
+
+std::vector<std::shared_ptr<Product>> Inventory::topByPrice(std::size_t k, bool highest) const {
+    Metrics::Scope metric(InventoryOp::TopByPrice);
+    std::shared_lock<ShardedMutex> lock(locks);
+    return collect(priceIndex, -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), highest, k);
+}
+
+// ===================== QUERIES =====================
+
+// Every shard shared, like the aggregates: column filters read quantities
+// that stock movements write under their own shard only.
+QueryResult Inventory::query(const ProductQuery& request) const {
+    Metrics::Scope metric(InventoryOp::Query);
+    Trace::Span span("query", "query");
+    std::shared_lock<ShardedMutex> lock(locks);
+    foldPendingQuantities();
+    QueryResult result = QueryPlanner::run(request, QuerySources{ products, columns, serialIndex, nameIndex, priceIndex, quantityIndex, bitmaps });
+    span.arg("matches", result.products.size());
+    return result;
+}
+
+QueryCount Inventory::countMatching(const ProductQuery& request) const {
+    Metrics::Scope metric(InventoryOp::CountMatching);
+    Trace::Span span("countMatching", "query");
+    std::shared_lock<ShardedMutex> lock(locks);
+    foldPendingQuantities();
+    QueryCount result = QueryPlanner::count(request, QuerySources{ products, columns, serialIndex, nameIndex, priceIndex, quantityIndex, bitmaps });
+    span.arg("matches", result.count);
+    return result;
 }
 
 // ===================== JSON =====================
 
-bool Inventory::loadFromFile(const std::string& file) {
-    std::ifstream in(file);
+// Files this large are mapped and parsed on the shared pool, when it has more
+// than one thread; below it the threads cost more than they save.
+static const std::uint64_t kParallelLoadBytes = 4 * 1024 * 1024;
+
+static bool readJsonFile(const std::string& file, std::vector<std::shared_ptr<Product>>& loaded, LoadStats& stats) {
+    Trace::Span span("readJsonFile", "load");
+    {
+        MappedFile map;
+        if (ThreadPool::shared().size() > 1 && map.open(file) && map.size() >= kParallelLoadBytes) {
+            stats.bytes = map.size();
+            return ProductSaxLoader::loadParallel(map.data(), map.size(), loaded, stats);
+        }
+    }
+
+    std::ifstream in(file, std::ios::binary);
     if (!in.is_open())
         return false;
 
-    json j;
-    try {
-        in >> j;
+    in.seekg(0, std::ios::end);
+    stats.bytes = static_cast<std::uint64_t>(in.tellg());
+    in.seekg(0, std::ios::beg);
+
+    return ProductSaxLoader::load(in, loaded, stats);
+}
+
+bool Inventory::loadFromFile(const std::string& file) {
+    Metrics::Scope metric(InventoryOp::LoadFromFile);
+    Trace::Span span("loadFromFile", "load");
+    auto started = std::chrono::steady_clock::now();
+
+    LoadStats stats;
+    std::vector<std::shared_ptr<Product>> loaded;
+    if (!readJsonFile(file, loaded, stats))
+        return false;
+
+    {
+        std::lock_guard<ShardedMutex> lock(locks);
+        replaceAllProducts(loaded);
+        stats.loaded = products.size();
     }
-    catch (...) {
+
+    stats.skipped = stats.records - stats.loaded;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    lastLoadStats = stats;
+    span.arg("records", stats.records);
+    span.arg("loaded", stats.loaded);
+    return true;
+}
+
+bool Inventory::loadSnapshot(const std::string& file) {
+    Metrics::Scope metric(InventoryOp::LoadSnapshot);
+    Trace::Span span("loadSnapshot", "load");
+    auto started = std::chrono::steady_clock::now();
+
+    LoadStats stats;
+    std::vector<std::shared_ptr<Product>> loaded;
+    if (!Snapshot::read(file, loaded, stats))
         return false;
+
+    {
+        std::lock_guard<ShardedMutex> lock(locks);
+        replaceAllProducts(loaded);
+        stats.loaded = products.size();
     }
 
-    products.clear();
+    stats.skipped = stats.records - stats.loaded;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    lastLoadStats = stats;
+    span.arg("records", stats.records);
+    span.arg("loaded", stats.loaded);
+    return true;
+}
 
-    if (!j.contains("products") || !j["products"].is_array())
-        return true;
+bool Inventory::saveSnapshot(const std::string& file) const {
+    Metrics::Scope metric(InventoryOp::SaveSnapshot);
+    Trace::Span span("saveSnapshot", "save");
+    Snapshot::Image image;
+    {
+        Trace::Span capture("captureImage", "save");
+        std::lock_guard<ShardedMutex> lock(locks);
+        captureImage(image);
+        image.journalSequence = journal ? journal->lastSequence() : 0;
+    }
+    return Snapshot::write(file, image);
+}
 
-    for (const auto& item : j["products"]) {
-        if (!item.contains("type"))
-            continue;
+// Caller holds every shard.
+void Inventory::captureImage(Snapshot::Image& image) const {
+    image.products = products;
+    image.quantities.reserve(products.size());
+    for (const auto& p : products)
+        image.quantities.push_back(p->getQuantity());
+}
 
-        try {
-            std::string type = item["type"].get<std::string>();
+// ===================== JOURNAL =====================
 
-            if (type == "Laptop") {
-                products.push_back(std::make_shared<Laptop>(Laptop::fromJson(item)));
-            }
-            else if (type == "Phone") {
-                products.push_back(std::make_shared<Phone>(Phone::fromJson(item)));
-            }
-            else if (type == "DesktopComputer") {
-                products.push_back(std::make_shared<DesktopComputer>(DesktopComputer::fromJson(item)));
-            }
-        }
-        catch (...) {
-            continue;
-        }
+void Inventory::setJournal(Journal* target) {
+    journal = target;
+}
+
+bool Inventory::journalFailed() const {
+    return journal && journal->hasFailed();
+}
+
+// Only the capture holds the shards: copying the product pointers and
+// quantities and switching the journal segment. Encoding and disk I/O run
+// while stock movements continue.
+bool Inventory::checkpoint(const std::string& snapshotFile) {
+    Metrics::Scope metric(InventoryOp::Checkpoint);
+    Trace::Span span("checkpoint", "save");
+    std::lock_guard<std::mutex> serialize(checkpointMutex);
+
+    if (journal && !journal->prepareRotation())
+        return false;
+
+    Snapshot::Image image;
+    {
+        Trace::Span capture("captureImage", "save");
+        std::lock_guard<ShardedMutex> lock(locks);
+        captureImage(image);
+        image.journalSequence = journal ? journal->rotate() : 0;
     }
 
+    if (journal && !journal->sealRotated())
+        return false;
+    CrashPoint::hit("checkpoint.sealed");
+
+    if (!Snapshot::write(snapshotFile, image))
+        return false;
+    CrashPoint::hit("checkpoint.written");
+
+    if (journal)
+        journal->removeSealedSegments();
     return true;
 }
 
+// Records with an empty or already loaded serial are skipped like any other
+// bad record: the first occurrence wins.
+void Inventory::replaceAllProducts(const std::vector<std::shared_ptr<Product>>& loaded) {
+    MemoryAccounting::Scope memory(MemorySubsystem::Indexes);
+    for (const auto& p : products)
+        p->setAttached(false);
+    for (auto& shard : pendingQuantities)
+        shard.changes.clear();
+    pendingQuantityCount.store(0, std::memory_order_relaxed);
+    products.clear();
+    columns.clear();
+    bitmaps.clear();
+    serialIndex.clear();
+    nameIndex.clear();
+    priceIndex.clear();
+    quantityIndex.clear();
+
+    products.reserve(loaded.size());
+    columns.reserve(loaded.size());
+    bitmaps.reserve(loaded.size());
+    serialIndex.reserve(loaded.size());
+    nameIndex.reserve(loaded.size());
+
+    {
+        // Serial, name and bitmap indexes; duplicate serials are dropped here.
+        Trace::Span span("attachProducts", "index");
+        for (const auto& p : loaded)
+            attachProduct(p, false);
+        span.arg("products", products.size());
+        span.arg("skipped", loaded.size() - products.size());
+    }
+    rebuildOrderedIndexes();
+}
+
+const LoadStats& Inventory::getLastLoadStats() const {
+    return lastLoadStats;
+}
+
+// ===================== MEMORY =====================
+
+// Interned brands, CPUs and GPUs are shared by every product, so they are
+// counted once, as the whole pool, rather than per product.
+InventoryMemory Inventory::memoryUsage() const {
+    Metrics::Scope metric(InventoryOp::MemoryUsage);
+    const std::size_t smallString = std::string().capacity();
+    const std::size_t controlBlock = sizeof(void*) + 2 * sizeof(std::int32_t);
+    auto heapBytes = [smallString](const std::string& s) {
+        return s.capacity() > smallString ? s.capacity() + 1 : 0;
+    };
+
+    InventoryMemory usage;
+    std::shared_lock<ShardedMutex> lock(locks);
+    // Other readers fold queued quantity changes into the quantity index and
+    // bitmaps under shared locks too; folding first leaves them nothing to
+    // change while those are measured below.
+    foldPendingQuantities();
+    usage.products = products.size();
+
+    for (const auto& p : products) {
+        usage.objectBytes += ProductStore::visit(*p, [](auto product) -> std::size_t {
+            if constexpr (std::is_same_v<decltype(product), std::monostate>)
+                return sizeof(Product);
+            else
+                return sizeof(*product);
+        });
+
+        usage.stringHeapBytes += heapBytes(p->getSerialNumber()) + heapBytes(p->getName());
+        usage.controlBlockBytes += controlBlock;
+    }
+
+    usage.productListBytes = products.capacity() * sizeof(std::shared_ptr<Product>);
+    usage.internedBytes = StringInterner::bytes();
+    usage.columnBytes = columns.bytes();
+    usage.serialIndexBytes = serialIndex.bytes();
+    usage.nameIndexBytes = nameIndex.bytes();
+    usage.orderedIndexBytes = priceIndex.bytes() + quantityIndex.bytes();
+    usage.bitmapIndexBytes = bitmaps.bytes();
+    for (const auto& shard : pendingQuantities)
+        usage.orderedIndexBytes += shard.changes.capacity() * sizeof(QuantityChange);
+    return usage;
+}
+
 bool Inventory::saveToFile(const std::string& file) {
+    Metrics::Scope metric(InventoryOp::SaveToFile);
+    Trace::Span span("saveToFile", "save");
+    MemoryAccounting::Scope memory(MemorySubsystem::JsonDom);
+
+    // Held products are never changed in place (quantities move atomically),
+    // so the list is copied under the lock and serialized without it.
+    std::vector<std::shared_ptr<Product>> saved;
+    {
+        ShardLock lock(locks, locks.shardOfThisThread(), ShardLock::Shared);
+        saved = products;
+    }
+
     json j;
     j["products"] = json::array();
+    {
+        Trace::Span build("buildJson", "save");
+        for (const auto& p : saved) {
+            j["products"].push_back(p->toJson());
+        }
+        build.arg("products", saved.size());
+    }
 
-    for (const auto& p : products) {
-        j["products"].push_back(p->toJson());
+    std::string text;
+    {
+        Trace::Span dump("dumpJson", "save");
+        text = j.dump(4);
+        dump.arg("bytes", text.size());
     }
 
-    std::ofstream out(file);
-    if (!out.is_open())
+    // Written next to the target and renamed over it, so a failed or
+    // interrupted save leaves the previous file whole.
+    Trace::Span write("writeFile", "save");
+    const std::string temporary = file + ".tmp";
+    DurableFile out;
+    if (!out.open(temporary, DurableFile::Mode::Truncate) ||
+        !out.write(text.data(), text.size()) || !out.sync()) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(temporary, ec);
         return false;
+    }
+    out.close();
 
-    out << j.dump(4);
+    std::error_code ec;
+    std::filesystem::rename(temporary, file, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    DurableFile::syncParentDirectory(file);
     return true;
 }
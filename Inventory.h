@@ -1,38 +1,174 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <atomic>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <nlohmann/json.hpp>
 
+#include "BitmapIndex.h"
 #include "Category.h"
+#include "LoadStats.h"
+#include "MemoryAccounting.h"
+#include "Metrics.h"
+#include "OrderedIndex.h"
 #include "Product.h"
+#include "ProductColumns.h"
+#include "ProductView.h"
+#include "QueryPlanner.h"
+#include "SerialIndex.h"
+#include "ShardedMutex.h"
+#include "Snapshot.h"
+#include "StockOperation.h"
+#include "TrigramIndex.h"
+
+class Journal;
+struct JournalTicket;
 
 class Inventory {
 private:
     std::vector<Category> categories;
     std::vector<std::shared_ptr<Product>> products;
+    ProductColumns columns; // row i mirrors products[i]
+    SerialIndex serialIndex;
+    TrigramIndex nameIndex;
+    // Keyed by (value, serial). The price column still holds a product's
+    // old price when it changes, which is the key to move; quantity moves
+    // carry their old value in QuantityChange.
+    OrderedIndex priceIndex;
+    mutable OrderedIndex quantityIndex;
+    mutable BitmapIndex bitmaps;    // row i is products[i], like the columns
+    LoadStats lastLoadStats;
+    Journal* journal = nullptr;
+
+    // Lookups hold their serial's shard shared. Stock movements hold it
+    // exclusively, so a product's quantity changes reach the journal in the
+    // order they happened. Structural changes and the checkpoint capture
+    // hold every shard.
+    mutable ShardedMutex locks;
+    std::mutex checkpointMutex;
+
+    // Stock movements do not touch quantityIndex or the in-stock bitmap:
+    // each queues the change on its shard, under the shard lock it already
+    // holds. Whoever next needs those indexes while holding every shard
+    // folds all queues in; a queue that reaches kMaxPendingQuantities is
+    // folded by its own writer. foldMutex orders the folds.
+    struct QuantityChange {
+        std::size_t position;
+        int before;
+        int after;
+    };
+    struct alignas(64) PendingQuantities {
+        std::vector<QuantityChange> changes;
+    };
+    static constexpr std::size_t kMaxPendingQuantities = 64;
+    mutable std::array<PendingQuantities, ShardedMutex::kShardCount> pendingQuantities;
+    mutable std::atomic<std::size_t> pendingQuantityCount{ 0 };
+    mutable std::mutex foldMutex;
+
+    bool commitJournal(const JournalTicket& ticket);
+    BatchResult applyBatchInMemory(const std::vector<StockOperation>& operations, JournalTicket& ticket);
+
+    // Bodies of findBySerial and replaceProduct without their metric, for
+    // public calls built on them: each call is counted once, as itself.
+    std::shared_ptr<Product> findProduct(std::string_view serial) const;
+    bool replaceProductBySerial(const std::string& currentSerial, const std::shared_ptr<Product>& product);
+
+    // Every structural change goes through these so the indexes stay in sync.
+    // Loads skip the ordered indexes and rebuild them once at the end.
+    bool attachProduct(const std::shared_ptr<Product>& product, bool ordered = true);
+    void detachProductAt(std::size_t position);
+    void replaceProductAt(std::size_t position, const std::shared_ptr<Product>& product);
+
+    // Caller holds `shard` (the product's) exclusively, or every shard.
+    void quantityChanged(std::size_t position, std::size_t shard);
+    // Caller holds every shard, shared or exclusively.
+    void foldPendingQuantities() const;
+    void foldQuantities(std::vector<QuantityChange>& changes) const;
+    void rebuildOrderedIndexes();
+    std::vector<std::shared_ptr<Product>> collect(const OrderedIndex& index, double low, double high, bool descending, std::size_t limit) const;
+
+    void replaceAllProducts(const std::vector<std::shared_ptr<Product>>& loaded);
+    void captureImage(Snapshot::Image& image) const;
 
 public:
     Inventory();
+    ~Inventory();
+
+    // Products are marked as held by one inventory, so it cannot be copied.
+    Inventory(const Inventory&) = delete;
+    Inventory& operator=(const Inventory&) = delete;
 
     // ---------- Categories ----------
     const std::vector<Category>& getCategories() const;
     const Category* getCategoryById(int id) const;
 
     // ---------- Products ----------
-    void addProduct(const std::shared_ptr<Product>& product);
+    // False for a null product or a serial that is empty or already taken.
+    bool addProduct(const std::shared_ptr<Product>& product);
 
-    bool serialExists(const std::string& serial) const;
-    std::shared_ptr<Product> findBySerial(const std::string& serial) const;
+    bool serialExists(std::string_view serial) const;
+    std::shared_ptr<Product> findBySerial(std::string_view serial) const;
 
     std::vector<std::shared_ptr<Product>> getAllProducts() const;
+    // Calls f(products) with every shard held shared: the list cannot change
+    // meanwhile, and f must not call back into the inventory's mutators.
+    template <typename F>
+    decltype(auto) readProducts(F&& f) const {
+        Metrics::Scope metric(InventoryOp::ReadProducts);
+        std::shared_lock<ShardedMutex> lock(locks);
+        return f(static_cast<const std::vector<std::shared_ptr<Product>>&>(products));
+    }
     std::vector<std::shared_ptr<Product>> searchByName(const std::string& term) const;
     std::vector<std::shared_ptr<Product>> listByCategory(int categoryId) const;
 
+    // ---------- Views ----------
+    // These read in place: no result vector and no shared_ptr copies. They
+    // hold one shard of the inventory's lock while f runs (a view, while it
+    // is open), and every writer waits for it. So f must not call back into
+    // the Inventory at all: a change needs that shard exclusively, and even
+    // a lookup can queue behind a waiting writer; either deadlocks. Keep f
+    // short and do anything slow, such as waiting on I/O, outside.
+    ProductView viewProducts() const;
+
+    // Calls f(const Product&) for every product, in inventory order.
+    template <typename F>
+    void forEachProduct(F&& f) const {
+        Metrics::Scope metric(InventoryOp::ForEachProduct);
+        ShardLock lock(locks, locks.shardOfThisThread(), ShardLock::Shared);
+        for (const auto& p : products)
+            f(static_cast<const Product&>(*p));
+    }
+
+    template <typename F>
+    void forEachInCategory(int categoryId, F&& f) const {
+        Metrics::Scope metric(InventoryOp::ForEachInCategory);
+        ShardLock lock(locks, locks.shardOfThisThread(), ShardLock::Shared);
+        for (const auto& p : products) {
+            if (p->getCategoryId() == categoryId)
+                f(static_cast<const Product&>(*p));
+        }
+    }
+
+    // ---------- Queries ----------
+    // Runs a parsed filter expression; see ProductQuery for the language.
+    QueryResult query(const ProductQuery& request) const;
+    // How many products query() would return; terms on the bitmap-indexed
+    // fields alone are counted without reading a product.
+    QueryCount countMatching(const ProductQuery& request) const;
+
     bool removeProductBySerial(const std::string& serial);
 
     bool updateProductFromJson(const std::string& currentSerial, const nlohmann::json& updatedJson);
+    // Builds the product type named by "type" (or `fallbackType` when the
+    // field is absent); null if the type is unknown or fromJson rejects it.
+    static std::shared_ptr<Product> productFromJson(const nlohmann::json& j, const std::string& fallbackType = "");
+    bool replaceProduct(const std::string& currentSerial, const std::shared_ptr<Product>& product);
 
     // ---------- Validations / Stock ----------
     bool canStockIn(const std::string& serial, int amount) const;
@@ -41,7 +177,60 @@ public:
     bool stockIn(const std::string& serial, int amount);
     bool stockOut(const std::string& serial, int amount);
 
+    // All lines or none, under one lock acquisition and one journal record.
+    BatchResult applyBatch(const std::vector<StockOperation>& operations);
+
+    // ---------- Aggregates ----------
+    double getStockValue() const;
+    double getStockValue(int categoryId) const;
+    long long getTotalUnits() const;
+    long long getTotalUnits(int categoryId) const;
+    // Products with fewer than `below` units in stock.
+    std::size_t countLowStock(int below) const;
+    std::size_t countLowStock(int below, int categoryId) const;
+    // False when the inventory is empty.
+    bool getPriceRange(double& minPrice, double& maxPrice) const;
+
+    // ---------- Ranges ----------
+    // Ordered by value, ties by serial; k results cost O(log n + k) and the
+    // counts O(log n). Bounds are inclusive.
+    static constexpr std::size_t kNoLimit = std::numeric_limits<std::size_t>::max();
+
+    std::vector<std::shared_ptr<Product>> findByPriceRange(double minPrice, double maxPrice, std::size_t limit = kNoLimit) const;
+    std::size_t countByPriceRange(double minPrice, double maxPrice) const;
+    std::vector<std::shared_ptr<Product>> findByQuantityRange(int minQuantity, int maxQuantity, std::size_t limit = kNoLimit) const;
+    std::size_t countByQuantityRange(int minQuantity, int maxQuantity) const;
+    // The k products with the fewest units, fewest first.
+    std::vector<std::shared_ptr<Product>> lowestStock(std::size_t k) const;
+    // The k cheapest products, or the k dearest (dearest first) when `highest`.
+    std::vector<std::shared_ptr<Product>> topByPrice(std::size_t k, bool highest) const;
+
     // ---------- Persistence ----------
     bool loadFromFile(const std::string& file);
     bool saveToFile(const std::string& file);
+
+    bool loadSnapshot(const std::string& file);
+    bool saveSnapshot(const std::string& file) const;
+
+    // Mutations are appended to the attached journal (may be null) before
+    // they are applied; one the journal refuses fails and changes nothing.
+    // A mutation that returns true is durable only under
+    // JournalSync::EveryOperation: with GroupCommit or Periodic a crash can
+    // lose the last interval of acknowledged changes (see JournalSync).
+    // Waiting for the fsync happens after the mutation has released its
+    // locks, so readers and other writers never wait on the disk, not even
+    // on a checkpoint's segment sync. If that fsync fails the mutation
+    // returns false but stays applied, and the next checkpoint keeps it.
+    void setJournal(Journal* target);
+    // True while the attached journal refuses changes; see Journal::hasFailed.
+    bool journalFailed() const;
+    // Writes a snapshot that includes every journaled record, then drops the
+    // journal segments it covers. Safe to call from a background thread.
+    bool checkpoint(const std::string& snapshotFile);
+
+    const LoadStats& getLastLoadStats() const;
+
+    // ---------- Memory ----------
+    // Estimated from the containers, products and indexes hold; see InventoryMemory.
+    InventoryMemory memoryUsage() const;
 };
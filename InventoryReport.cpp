@@ -0,0 +1,147 @@
+#include "InventoryReport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+#include <unordered_map>
+
+#include "DesktopComputer.h"
+#include "Laptop.h"
+#include "Phone.h"
+
+namespace {
+    // Fixed so the chunking, and with it the order in which value sums are
+    // added, does not depend on the pool size.
+    constexpr std::size_t kChunkSize = 32 * 1024;
+
+    // Keys are views into the products and categories, which stay put
+    // while the inventory is held shared.
+    using GroupMap = std::unordered_map<std::string_view, ReportRow>;
+
+    std::string_view cpuOf(const Product& p) {
+        if (const auto* laptop = dynamic_cast<const Laptop*>(&p))
+            return laptop->getCpu();
+        if (const auto* phone = dynamic_cast<const Phone*>(&p))
+            return phone->getCpu();
+        if (const auto* desktop = dynamic_cast<const DesktopComputer*>(&p))
+            return desktop->getCpu();
+        return "Unknown";
+    }
+
+    // getType() builds a string; these literals outlive the report.
+    std::string_view typeOf(const Product& p) {
+        if (dynamic_cast<const Laptop*>(&p))
+            return "Laptop";
+        if (dynamic_cast<const Phone*>(&p))
+            return "Phone";
+        if (dynamic_cast<const DesktopComputer*>(&p))
+            return "DesktopComputer";
+        return "Unknown";
+    }
+
+    void accumulate(ReportRow& row, double price, int quantity) {
+        if (row.products == 0) {
+            row.minPrice = price;
+            row.maxPrice = price;
+        }
+        else {
+            row.minPrice = std::min(row.minPrice, price);
+            row.maxPrice = std::max(row.maxPrice, price);
+        }
+        row.products++;
+        row.units += quantity;
+        row.value += price * quantity;
+    }
+
+    void merge(ReportRow& into, const ReportRow& from) {
+        if (from.products == 0)
+            return;
+        if (into.products == 0) {
+            into.minPrice = from.minPrice;
+            into.maxPrice = from.maxPrice;
+        }
+        else {
+            into.minPrice = std::min(into.minPrice, from.minPrice);
+            into.maxPrice = std::max(into.maxPrice, from.maxPrice);
+        }
+        into.products += from.products;
+        into.units += from.units;
+        into.value += from.value;
+    }
+}
+
+const char* InventoryReport::groupName(ReportGroup groupBy) {
+    switch (groupBy) {
+    case ReportGroup::Category: return "Category";
+    case ReportGroup::Brand: return "Brand";
+    case ReportGroup::Cpu: return "CPU";
+    case ReportGroup::Type: return "Type";
+    }
+    return "";
+}
+
+// ===================== BUILD =====================
+
+Report InventoryReport::build(const Inventory& inventory, ReportGroup groupBy, ThreadPool& pool) {
+    auto started = std::chrono::steady_clock::now();
+
+    Report report;
+    report.groupBy = groupBy;
+
+    const auto& categories = inventory.getCategories();
+    auto categoryOf = [&categories](int id) -> std::string_view {
+        for (const auto& c : categories) {
+            if (c.getId() == id)
+                return c.getName();
+        }
+        return "Unknown";
+    };
+
+    auto keyOf = [&](const Product& p) -> std::string_view {
+        switch (groupBy) {
+        case ReportGroup::Category: return categoryOf(p.getCategoryId());
+        case ReportGroup::Brand: return p.getBrand();
+        case ReportGroup::Cpu: return cpuOf(p);
+        case ReportGroup::Type: return typeOf(p);
+        }
+        return "Unknown";
+    };
+
+    inventory.readProducts([&](const std::vector<std::shared_ptr<Product>>& products) {
+        const std::size_t n = products.size();
+        const std::size_t chunks = (n + kChunkSize - 1) / kChunkSize;
+
+        std::vector<GroupMap> partial(chunks);
+        pool.parallelFor(chunks, [&](std::size_t chunk) {
+            GroupMap& groups = partial[chunk];
+            const std::size_t begin = chunk * kChunkSize;
+            const std::size_t end = std::min(n, begin + kChunkSize);
+            for (std::size_t i = begin; i < end; i++) {
+                const Product& p = *products[i];
+                accumulate(groups[keyOf(p)], p.getPrice(), p.getQuantity());
+            }
+        });
+
+        GroupMap merged;
+        for (const auto& groups : partial) {
+            for (const auto& [key, row] : groups)
+                merge(merged[key], row);
+        }
+
+        report.rows.reserve(merged.size());
+        for (auto& [key, row] : merged) {
+            row.group = std::string(key);
+            report.rows.push_back(std::move(row));
+        }
+    });
+
+    std::sort(report.rows.begin(), report.rows.end(),
+        [](const ReportRow& a, const ReportRow& b) { return a.group < b.group; });
+
+    report.total.group = "Total";
+    for (const auto& row : report.rows)
+        merge(report.total, row);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return report;
+}
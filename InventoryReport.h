@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Inventory.h"
+#include "ThreadPool.h"
+
+enum class ReportGroup {
+    Category,
+    Brand,
+    Cpu,
+    Type
+};
+
+struct ReportRow {
+    std::string group;
+    std::size_t products = 0;
+    long long units = 0;
+    double value = 0.0;     // sum of price * quantity
+    double minPrice = 0.0;
+    double maxPrice = 0.0;
+};
+
+struct Report {
+    ReportGroup groupBy = ReportGroup::Category;
+    std::vector<ReportRow> rows;    // sorted by group
+    ReportRow total;
+    double seconds = 0.0;
+};
+
+// Group-by valuation reports. The product list is cut into fixed-size chunks
+// that the pool aggregates into per-chunk hash maps; the maps are then merged
+// in chunk order, so the same inventory gives the same report on any machine.
+class InventoryReport {
+public:
+    static Report build(const Inventory& inventory, ReportGroup groupBy, ThreadPool& pool = ThreadPool::shared());
+
+    static const char* groupName(ReportGroup groupBy);
+};
@@ -0,0 +1,390 @@
+#include "InventoryServer.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "Trace.h"
+
+namespace {
+    // epoll tags below kFirstConnection; connections count up from it.
+    constexpr std::uint64_t kListener = 0;
+    constexpr std::uint64_t kWake = 1;
+    constexpr std::uint64_t kStop = 2;
+    constexpr std::uint64_t kFirstConnection = 3;
+
+    constexpr std::size_t kReadChunk = 64 * 1024;
+}
+
+struct InventoryServer::Connection {
+    std::uint64_t id = 0;
+    int fd = -1;
+    std::uint32_t interest = 0;
+
+    std::string input;                  // bytes after the last complete line
+    std::vector<std::string> queued;    // complete lines not yet handed to a worker
+    std::size_t nextLine = 1;
+    bool busy = false;                  // a worker holds this connection's job
+
+    std::string output;
+    std::size_t written = 0;            // prefix of output already sent
+
+    bool peerClosed = false;
+    bool broken = false;
+};
+
+InventoryServer::InventoryServer(Inventory& inventory, const std::string& snapshotFile, const ServerOptions& options)
+    : runner(inventory, snapshotFile), options(options) {
+}
+
+InventoryServer::~InventoryServer() {
+#ifdef __linux__
+    for (int fd : { epollFd, wakeFd, stopFd })
+        if (fd >= 0)
+            ::close(fd);
+#endif
+}
+
+ServerStats InventoryServer::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
+
+#ifndef __linux__
+
+bool InventoryServer::run(const SocketAddress&) {
+    return false;
+}
+
+void InventoryServer::requestStop() {
+    stopRequested.store(true);
+}
+
+void InventoryServer::accept(int) {}
+void InventoryServer::readFrom(Connection&) {}
+void InventoryServer::dispatch(Connection&) {}
+void InventoryServer::collectCompleted() {}
+void InventoryServer::writeTo(Connection&) {}
+void InventoryServer::updateInterest(Connection&) {}
+bool InventoryServer::finished(const Connection&) const { return true; }
+void InventoryServer::close(std::uint64_t) {}
+
+#else
+
+// ===================== EVENT LOOP =====================
+
+bool InventoryServer::run(const SocketAddress& address) {
+    const int listenFd = address.listen();
+    if (listenFd < 0)
+        return false;
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stopFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0 || stopFd < 0) {
+        ::close(listenFd);
+        return false;
+    }
+
+    for (auto [fd, tag] : { std::pair<int, std::uint64_t>{ listenFd, kListener }, { wakeFd, kWake }, { stopFd, kStop } }) {
+        epoll_event e{};
+        e.events = EPOLLIN;
+        e.data.u64 = tag;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &e);
+    }
+
+    workers = std::make_unique<ThreadPool>(options.workers);
+    nextId = kFirstConnection;
+
+    epoll_event events[256];
+    while (!stopRequested.load()) {
+        const int ready = ::epoll_wait(epollFd, events, 256, -1);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            const std::uint64_t tag = events[i].data.u64;
+            const std::uint32_t what = events[i].events;
+
+            if (tag == kListener) {
+                accept(listenFd);
+                continue;
+            }
+            if (tag == kWake) {
+                std::uint64_t count;
+                while (::read(wakeFd, &count, sizeof(count)) > 0) {
+                }
+                collectCompleted();
+                continue;
+            }
+            if (tag == kStop) {
+                stopRequested.store(true);
+                continue;
+            }
+
+            auto it = connections.find(tag);
+            if (it == connections.end())
+                continue;
+            Connection& c = *it->second;
+
+            if (what & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                readFrom(c);
+            if ((what & EPOLLOUT) && !c.broken)
+                writeTo(c);
+
+            if (finished(c))
+                close(tag);
+            else
+                updateInterest(c);
+        }
+    }
+
+    // Let the running commands finish and send what they produced.
+    ::close(listenFd);
+    address.unlink();
+    workers.reset();
+    collectCompleted();
+
+    std::vector<std::uint64_t> open;
+    for (const auto& entry : connections)
+        open.push_back(entry.first);
+    for (std::uint64_t id : open)
+        close(id);
+    return true;
+}
+
+void InventoryServer::requestStop() {
+    stopRequested.store(true);
+    if (stopFd >= 0) {
+        const std::uint64_t one = 1;
+        ssize_t written = ::write(stopFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void InventoryServer::accept(int listenFd) {
+    for (;;) {
+        const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        const int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        auto c = std::make_unique<Connection>();
+        c->id = nextId++;
+        c->fd = fd;
+        c->interest = EPOLLIN | EPOLLRDHUP;
+
+        epoll_event e{};
+        e.events = c->interest;
+        e.data.u64 = c->id;
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &e) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections.emplace(c->id, std::move(c));
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.connections++;
+    }
+}
+
+// ===================== CONNECTIONS =====================
+
+void InventoryServer::readFrom(Connection& c) {
+    char chunk[kReadChunk];
+    for (;;) {
+        const ssize_t got = ::recv(c.fd, chunk, sizeof(chunk), 0);
+        if (got == 0) {
+            c.peerClosed = true;
+            break;
+        }
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                c.broken = true;
+            break;
+        }
+
+        std::size_t start = c.input.size();
+        c.input.append(chunk, static_cast<std::size_t>(got));
+
+        // Split off every complete line; blank and '#' lines are skipped
+        // like in a batch file.
+        std::size_t lineStart = 0;
+        for (std::size_t at = c.input.find('\n', start); at != std::string::npos; at = c.input.find('\n', lineStart)) {
+            std::size_t end = at;
+            if (end > lineStart && c.input[end - 1] == '\r')
+                end--;
+            std::size_t first = c.input.find_first_not_of(" \t", lineStart);
+            if (first < end && c.input[first] != '#')
+                c.queued.emplace_back(c.input, first, end - first);
+            lineStart = at + 1;
+        }
+        c.input.erase(0, lineStart);
+
+        if (c.input.size() > options.maxLineBytes) {
+            c.output += "{\"error\":\"line too long\",\"ok\":false}\n";
+            c.input.clear();
+            c.peerClosed = true;
+            break;
+        }
+        if (c.queued.size() >= options.maxQueuedCommands)
+            break;
+    }
+
+    dispatch(c);
+    writeTo(c);
+}
+
+void InventoryServer::dispatch(Connection& c) {
+    if (c.busy || c.queued.empty() || c.broken)
+        return;
+
+    auto lines = std::make_shared<std::vector<std::string>>(std::move(c.queued));
+    c.queued.clear();
+    const std::size_t firstLine = c.nextLine;
+    c.nextLine += lines->size();
+    c.busy = true;
+
+    workers->post([this, id = c.id, lines, firstLine] {
+        Trace::Span span("serveCommands", "server");
+        span.arg("commands", lines->size());
+
+        // Posted jobs must not throw: a command that still does fails its
+        // own line and the rest of the connection's lines go on.
+        Completion done{ id, std::string(), lines->size(), 0 };
+        std::string result;
+        for (std::size_t i = 0; i < lines->size(); i++) {
+            try {
+                if (!runner.execute((*lines)[i], firstLine + i, result))
+                    done.failed++;
+            }
+            catch (...) {
+                result = "{\"error\":\"internal error\",\"line\":" + std::to_string(firstLine + i) + ",\"ok\":false}";
+                done.failed++;
+            }
+            done.output += result;
+            done.output += '\n';
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            completed.push_back(std::move(done));
+        }
+        const std::uint64_t one = 1;
+        ssize_t written = ::write(wakeFd, &one, sizeof(one));
+        (void)written;
+    });
+}
+
+void InventoryServer::collectCompleted() {
+    std::vector<Completion> done;
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        done.swap(completed);
+    }
+
+    for (auto& job : done) {
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            stats.requests += job.requests;
+            stats.failed += job.failed;
+        }
+
+        auto it = connections.find(job.id);
+        if (it == connections.end())
+            continue;
+        Connection& c = *it->second;
+
+        c.busy = false;
+        if (c.written == c.output.size()) {
+            c.output.swap(job.output);
+            c.written = 0;
+        }
+        else {
+            c.output += job.output;
+        }
+
+        dispatch(c);
+        writeTo(c);
+        if (finished(c))
+            close(job.id);
+        else
+            updateInterest(c);
+    }
+}
+
+void InventoryServer::writeTo(Connection& c) {
+    while (c.written < c.output.size()) {
+        const ssize_t sent = ::send(c.fd, c.output.data() + c.written, c.output.size() - c.written, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                c.broken = true;
+            return;
+        }
+        c.written += static_cast<std::size_t>(sent);
+    }
+    c.output.clear();
+    c.written = 0;
+}
+
+// Reads only while the connection is within its output and queue limits,
+// and asks for writability only while output is waiting. A socket whose
+// client hung up leaves the epoll set while nothing is owed to it, since
+// EPOLLHUP cannot be masked; the job it waits for brings it back.
+void InventoryServer::updateInterest(Connection& c) {
+    std::uint32_t interest = 0;
+    const bool backlogged = c.output.size() - c.written > options.maxPendingOutput ||
+        c.queued.size() >= options.maxQueuedCommands;
+    if (!c.peerClosed) {
+        interest |= EPOLLRDHUP;
+        if (!backlogged)
+            interest |= EPOLLIN;
+    }
+    if (c.written < c.output.size())
+        interest |= EPOLLOUT;
+
+    if (interest == c.interest)
+        return;
+
+    epoll_event e{};
+    e.events = interest;
+    e.data.u64 = c.id;
+    const int op = c.interest == 0 ? EPOLL_CTL_ADD : interest == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    ::epoll_ctl(epollFd, op, c.fd, &e);
+    c.interest = interest;
+}
+
+// A broken connection goes at once; one the client closed stays until
+// every answer it is owed has been sent.
+bool InventoryServer::finished(const Connection& c) const {
+    if (c.broken)
+        return true;
+    return c.peerClosed && !c.busy && c.queued.empty() && c.written == c.output.size();
+}
+
+void InventoryServer::close(std::uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end())
+        return;
+
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second->fd, nullptr);
+    ::close(it->second->fd);
+    connections.erase(it);
+}
+
+#endif
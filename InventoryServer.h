@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "BatchRunner.h"
+#include "Inventory.h"
+#include "SocketAddress.h"
+#include "ThreadPool.h"
+
+struct ServerOptions {
+    // Threads that run commands; 0 means one per hardware thread.
+    std::size_t workers = 0;
+    // A connection sending a longer line is answered with an error and closed.
+    std::size_t maxLineBytes = 1024 * 1024;
+    // Reading from a connection pauses while this much of its output is
+    // unsent, or this many of its commands are waiting.
+    std::size_t maxPendingOutput = 4 * 1024 * 1024;
+    std::size_t maxQueuedCommands = 4096;
+};
+
+struct ServerStats {
+    std::uint64_t connections = 0;
+    std::uint64_t requests = 0;
+    std::uint64_t failed = 0;
+};
+
+// Serves the batch protocol over a socket: each request is one line, text
+// or JSON exactly as in BatchRunner, and each gets one JSON result line, in
+// request order. Clients may pipeline: send many requests without waiting.
+//
+// One thread runs a non-blocking epoll loop that only accepts, reads, splits
+// lines and writes. Commands run on a worker pool. A connection hands its
+// waiting commands to a worker as one job and gets the next job only when
+// that one is done, so its commands run in order while different
+// connections run in parallel. Needs Linux; elsewhere run() fails.
+class InventoryServer {
+public:
+    InventoryServer(Inventory& inventory, const std::string& snapshotFile, const ServerOptions& options);
+    ~InventoryServer();
+
+    InventoryServer(const InventoryServer&) = delete;
+    InventoryServer& operator=(const InventoryServer&) = delete;
+
+    // Serves until requestStop(); false if the address cannot be bound.
+    bool run(const SocketAddress& address);
+    // Safe from a signal handler and from any thread.
+    void requestStop();
+
+    ServerStats getStats() const;
+
+private:
+    struct Connection;
+    struct Completion {
+        std::uint64_t id;
+        std::string output;
+        std::size_t requests;
+        std::size_t failed;
+    };
+
+    BatchRunner runner;
+    ServerOptions options;
+
+    int epollFd = -1;
+    int wakeFd = -1;    // workers signal finished jobs
+    int stopFd = -1;
+    std::atomic<bool> stopRequested{ false };
+
+    std::unique_ptr<ThreadPool> workers;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Connection>> connections;
+    std::uint64_t nextId = 0;
+
+    std::mutex completedMutex;
+    std::vector<Completion> completed;
+
+    mutable std::mutex statsMutex;
+    ServerStats stats;
+
+    void accept(int listenFd);
+    void readFrom(Connection& c);
+    void dispatch(Connection& c);
+    void collectCompleted();
+    void writeTo(Connection& c);
+    void updateInterest(Connection& c);
+    bool finished(const Connection& c) const;
+    void close(std::uint64_t id);
+};
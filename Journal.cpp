@@ -0,0 +1,647 @@
+#include "Journal.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+#include "Crc32.h"
+#include "CrashPoint.h"
+#include "Inventory.h"
+#include "MappedFile.h"
+#include "MemoryAccounting.h"
+#include "ProductCodec.h"
+#include "Trace.h"
+
+namespace {
+    constexpr std::size_t kFrameHeaderSize = 8;
+    constexpr std::size_t kMinBodySize = 9;
+
+    struct Segment {
+        std::uint64_t number;
+        std::string path;
+    };
+
+    struct ScanResult {
+        std::vector<Segment> segments;
+        std::uint64_t lastSequence = 0;
+        std::size_t damaged = 0;      // index of the first damaged segment, segments.size() if none
+        std::size_t intactBytes = 0;  // intact prefix of the damaged segment
+    };
+
+    std::string segmentPath(const std::string& base, std::uint64_t number) {
+        std::string digits = std::to_string(number);
+        if (digits.size() < 6)
+            digits.insert(0, 6 - digits.size(), '0');
+        return base + "." + digits;
+    }
+
+    std::vector<Segment> listSegments(const std::string& base) {
+        namespace fs = std::filesystem;
+
+        std::vector<Segment> segments;
+        fs::path basePath(base);
+        fs::path dir = basePath.parent_path();
+        if (dir.empty())
+            dir = ".";
+
+        const std::string prefix = basePath.filename().string() + ".";
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() <= prefix.size() || name.size() > prefix.size() + 19 ||
+                name.compare(0, prefix.size(), prefix) != 0)
+                continue;
+
+            std::string digits = name.substr(prefix.size());
+            if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                continue;
+
+            segments.push_back({ std::stoull(digits), entry.path().string() });
+        }
+
+        std::sort(segments.begin(), segments.end(),
+            [](const Segment& a, const Segment& b) { return a.number < b.number; });
+        return segments;
+    }
+
+    // Calls fn(sequence, operation, reader) for every intact record until it
+    // returns false, and returns the byte length of the records accepted.
+    template <typename Fn>
+    std::size_t forEachRecord(const char* data, std::size_t size, Fn&& fn) {
+        std::size_t offset = 0;
+
+        while (size - offset >= kFrameHeaderSize) {
+            BinaryReader frame(data + offset, kFrameHeaderSize);
+            std::uint32_t length, crc;
+            frame.u32(length);
+            frame.u32(crc);
+
+            if (length < kMinBodySize || size - offset - kFrameHeaderSize < length)
+                break;
+
+            const char* body = data + offset + kFrameHeaderSize;
+            if (crc32(body, length) != crc)
+                break;
+
+            BinaryReader reader(body, length);
+            std::uint64_t sequence;
+            std::uint8_t op;
+            reader.u64(sequence);
+            reader.u8(op);
+            if (!fn(sequence, op, reader))
+                break;
+
+            offset += kFrameHeaderSize + length;
+        }
+        return offset;
+    }
+
+    // Walks the segments in order and stops at the first record that is
+    // damaged or does not continue the sequence.
+    template <typename Fn>
+    ScanResult scanSegments(const std::string& base, Fn&& fn) {
+        ScanResult result;
+        result.segments = listSegments(base);
+        result.damaged = result.segments.size();
+
+        bool first = true;
+        for (std::size_t i = 0; i < result.segments.size(); i++) {
+            MappedFile map;
+            if (!map.open(result.segments[i].path)) {
+                result.damaged = i;
+                break;
+            }
+
+            std::size_t intact = forEachRecord(map.data(), map.size(),
+                [&](std::uint64_t seq, std::uint8_t op, BinaryReader& in) {
+                    if (!first && seq != result.lastSequence + 1)
+                        return false;
+                    if (!fn(seq, op, in))
+                        return false;
+                    first = false;
+                    result.lastSequence = seq;
+                    return true;
+                });
+
+            if (intact < map.size()) {
+                result.damaged = i;
+                result.intactBytes = intact;
+                break;
+            }
+        }
+        return result;
+    }
+}
+
+Journal::Journal()
+    : stopping(false), sealInFlight(false), activeSegment(0), sealedBelow(0), sealedSequence(0),
+      pendingRecords(0), writtenSequence(0), durableSequence(0), syncRequested(0), lostFrom(1), lostThrough(0),
+      failedSegment(0), failedCount(0), sequence(0), bytes(0) {
+}
+
+Journal::~Journal() {
+    close();
+}
+
+// ===================== LIFECYCLE =====================
+
+bool Journal::open(const std::string& journalBase, const JournalOptions& journalOptions, std::uint64_t startSequence) {
+    close();
+
+    base = journalBase;
+    options = journalOptions;
+
+    ScanResult scan = scanSegments(base, [](std::uint64_t, std::uint8_t, BinaryReader&) { return true; });
+    sequence = std::max(startSequence, scan.lastSequence);
+
+    // Cut the damaged tail so new records continue the intact sequence.
+    if (scan.damaged < scan.segments.size()) {
+        DurableFile damaged;
+        if (!damaged.open(scan.segments[scan.damaged].path, DurableFile::Mode::Append) ||
+            !damaged.truncate(scan.intactBytes) || !damaged.sync())
+            return false;
+
+        for (std::size_t i = scan.damaged + 1; i < scan.segments.size(); i++) {
+            std::error_code ec;
+            std::filesystem::remove(scan.segments[i].path, ec);
+        }
+    }
+
+    activeSegment = scan.segments.empty() ? 1 : scan.segments.back().number + 1;
+    sealedBelow = 0;
+    sealedSequence = sequence;
+
+    auto file = std::make_shared<DurableFile>();
+    if (!file->open(segmentPath(base, activeSegment), DurableFile::Mode::Truncate))
+        return false;
+    DurableFile::syncParentDirectory(base);
+    out = std::move(file);
+
+    stopping = false;
+    sealInFlight = false;
+    pending.clear();
+    pendingRecords = 0;
+    writtenSequence = sequence;
+    durableSequence = sequence;
+    syncRequested = sequence;
+    lostFrom = 1;
+    lostThrough = 0;
+    failedSegment = 0;
+    failedCount = 0;
+    bytes = 0;
+
+    flusher = std::thread(&Journal::flushLoop, this);
+    return true;
+}
+
+void Journal::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    sealDone.notify_all();
+
+    if (flusher.joinable())
+        flusher.join();
+
+    // The flush thread is gone, so the last fsyncs run here, in order.
+    std::unique_lock<std::mutex> lock(mutex);
+    if (out) {
+        if (!failedSegment) {
+            if (writeLocked() && (!sealing || sealing->sync()) && out->sync())
+                markDurable(writtenSequence);
+            else if (!failedSegment)
+                failLocked(activeSegment);
+        }
+        sealing.reset();
+        out.reset();
+    }
+    next.close();
+    durable.notify_all();
+}
+
+bool Journal::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return out != nullptr;
+}
+
+// ===================== RECORDS =====================
+
+JournalTicket Journal::logAdd(const Product& product) {
+    std::string payload;
+    BinaryWriter w(payload);
+    if (!ProductCodec::encode(product, w))
+        return JournalTicket();
+    return append(AddOp, payload);
+}
+
+JournalTicket Journal::logRemove(std::string_view serial) {
+    std::string payload;
+    BinaryWriter w(payload);
+    w.str(serial);
+    return append(RemoveOp, payload);
+}
+
+JournalTicket Journal::logUpdate(std::string_view currentSerial, const Product& product) {
+    std::string payload;
+    BinaryWriter w(payload);
+    w.str(currentSerial);
+    if (!ProductCodec::encode(product, w))
+        return JournalTicket();
+    return append(UpdateOp, payload);
+}
+
+JournalTicket Journal::logStockIn(std::string_view serial, int amount) {
+    std::string payload;
+    BinaryWriter w(payload);
+    w.str(serial);
+    w.i32(amount);
+    return append(StockInOp, payload);
+}
+
+JournalTicket Journal::logStockOut(std::string_view serial, int amount) {
+    std::string payload;
+    BinaryWriter w(payload);
+    w.str(serial);
+    w.i32(amount);
+    return append(StockOutOp, payload);
+}
+
+JournalTicket Journal::logBatch(const std::vector<StockOperation>& operations) {
+    std::string payload;
+    BinaryWriter w(payload);
+    w.u32(static_cast<std::uint32_t>(operations.size()));
+    for (const auto& op : operations) {
+        w.u8(op.kind == StockOperation::In ? StockInOp : StockOutOp);
+        w.str(op.serial);
+        w.i32(op.amount);
+    }
+    return append(BatchOp, payload);
+}
+
+JournalTicket Journal::append(Operation op, const std::string& payload) {
+    MemoryAccounting::Scope memory(MemorySubsystem::Journal);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!out)
+        return JournalTicket();
+    if (failedSegment) {
+        ++failedCount;
+        return JournalTicket();
+    }
+
+    std::string body;
+    body.reserve(kMinBodySize + payload.size());
+    BinaryWriter b(body);
+    b.u64(++sequence);
+    b.u8(op);
+    body += payload;
+
+    BinaryWriter frame(pending);
+    frame.u32(static_cast<std::uint32_t>(body.size()));
+    frame.u32(crc32(body.data(), body.size()));
+    pending += body;
+    ++pendingRecords;
+
+    if (bytes == 0)
+        firstRecordAt = std::chrono::steady_clock::now();
+    bytes += kFrameHeaderSize + body.size();
+
+    JournalTicket ticket{ sequence, false };
+    switch (options.sync) {
+    case JournalSync::EveryOperation:
+        ticket.wait = true;
+        break;
+    case JournalSync::GroupCommit:
+        ticket.wait = pendingRecords >= options.groupCommitRecords;
+        break;
+    case JournalSync::Periodic:
+        break;
+    }
+
+    // The caller holds its Inventory lock here, so it only hands the record
+    // to the kernel; commit() waits for the fsync once that lock is gone.
+    if ((options.sync != JournalSync::GroupCommit || ticket.wait) && !writeLocked())
+        return JournalTicket();
+    return ticket;
+}
+
+bool Journal::commit(const JournalTicket& ticket) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ticket.wait) {
+        if (syncRequested < ticket.sequence) {
+            syncRequested = ticket.sequence;
+            wake.notify_all();
+        }
+        durable.wait(lock, [&] { return durableSequence >= ticket.sequence || lost(ticket.sequence) || !out; });
+        if (durableSequence < ticket.sequence)
+            return false;
+    }
+    return !lost(ticket.sequence);
+}
+
+// ===================== DURABILITY =====================
+
+// A failure drops the buffered records and fails the journal; see hasFailed().
+bool Journal::writeLocked() {
+    if (pending.empty())
+        return true;
+    if (!out->write(pending.data(), pending.size()))
+        return failLocked(activeSegment);
+    pending.clear();
+    pendingRecords = 0;
+    writtenSequence = sequence;
+    return true;
+}
+
+// Only the flush thread (and close(), once it has stopped) syncs the active
+// segment. The fsync runs without the mutex: appends keep writing to the
+// same file meanwhile, and a rotation may move it aside, which is why the
+// file is shared.
+bool Journal::syncWritten(std::unique_lock<std::mutex>& lock) {
+    // Never let the active segment become durable ahead of the one before
+    // it: a rotation leaves that one to sealRotated(), so wait for it.
+    sealDone.wait(lock, [this] { return stopping || (!sealInFlight && !sealing); });
+    if (stopping || failedSegment || !out)
+        return false;
+
+    const std::uint64_t target = writtenSequence;
+    if (target <= durableSequence)
+        return true;
+
+    std::shared_ptr<DurableFile> file = out;
+    const std::uint64_t segment = activeSegment;
+    lock.unlock();
+    bool ok = file->sync();
+    lock.lock();
+
+    if (!ok)
+        return failLocked(segment);
+    if (!failedSegment)
+        markDurable(target);
+    return true;
+}
+
+// Nothing after the last durable record can be promised any more: records
+// still buffered are dropped, and commit() reports the rest as lost.
+bool Journal::failLocked(std::uint64_t segment) {
+    failedCount += pendingRecords;
+    pending.clear();
+    pendingRecords = 0;
+    failedSegment = std::max(failedSegment, segment);
+    lostFrom = durableSequence + 1;
+    lostThrough = sequence;
+    durable.notify_all();
+    return false;
+}
+
+void Journal::markDurable(std::uint64_t through) {
+    if (through <= durableSequence)
+        return;
+    durableSequence = through;
+    durable.notify_all();
+}
+
+bool Journal::lost(std::uint64_t record) const {
+    return record >= lostFrom && record <= lostThrough;
+}
+
+// Syncs on request from commit(); on the timer, GroupCommit also writes
+// out its buffer, and both buffered policies sync what has been written.
+void Journal::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        bool requested = wake.wait_for(lock, options.interval, [this] {
+            return stopping || (syncRequested > durableSequence && !failedSegment);
+        });
+        if (stopping)
+            break;
+        if (!requested && options.sync == JournalSync::GroupCommit && !failedSegment)
+            writeLocked();
+        if (requested || options.sync != JournalSync::EveryOperation)
+            syncWritten(lock);
+    }
+}
+
+bool Journal::sync() {
+    JournalTicket ticket;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!out || failedSegment || !writeLocked())
+            return false;
+        ticket = JournalTicket{ writtenSequence, true };
+    }
+    return commit(ticket);
+}
+
+bool Journal::hasFailed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failedSegment != 0;
+}
+
+std::uint64_t Journal::failedRecords() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failedCount;
+}
+
+std::uint64_t Journal::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sequence;
+}
+
+std::uint64_t Journal::activeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+std::chrono::steady_clock::duration Journal::activeAge() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes == 0)
+        return std::chrono::steady_clock::duration::zero();
+    return std::chrono::steady_clock::now() - firstRecordAt;
+}
+
+// ===================== ROTATION =====================
+
+bool Journal::prepareRotation() {
+    std::uint64_t number;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!out)
+            return false;
+        if (next.isOpen())
+            return true;
+        number = activeSegment + 1;
+    }
+
+    DurableFile file;
+    if (!file.open(segmentPath(base, number), DurableFile::Mode::Truncate))
+        return false;
+    DurableFile::syncParentDirectory(base);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    next = std::move(file);
+    return true;
+}
+
+std::uint64_t Journal::rotate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!out || !next.isOpen())
+        return sequence;
+
+    // Hand the buffered tail to the kernel; the fsync is left to sealRotated().
+    // A failed write may have torn the segment, and replay stops at a torn
+    // segment, so writeLocked() fails the journal as any write failure does:
+    // appends are refused until a checkpoint gets past the old segment.
+    writeLocked();
+
+    if (writtenSequence > durableSequence && !sealing)
+        sealing = std::move(out);
+    out = std::make_shared<DurableFile>(std::move(next));
+    sealedBelow = ++activeSegment;
+    sealedSequence = sequence;
+    bytes = 0;
+    return sequence;
+}
+
+bool Journal::sealRotated() {
+    std::shared_ptr<DurableFile> file;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!sealing)
+            return true;
+        file = std::move(sealing);
+        sealInFlight = true;
+    }
+
+    bool ok = file->sync();
+    file.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sealInFlight = false;
+        // Records acknowledged from that segment may be lost: refuse new
+        // ones until a checkpoint gets past it, as after a write failure.
+        if (!ok)
+            failLocked(sealedBelow - 1);
+        else if (!failedSegment)
+            markDurable(sealedSequence);
+    }
+    sealDone.notify_all();
+    return ok;
+}
+
+void Journal::removeSealedSegments() {
+    std::uint64_t below;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        below = sealedBelow;
+    }
+
+    for (const Segment& segment : listSegments(base)) {
+        if (segment.number >= below)
+            break;
+        std::error_code ec;
+        std::filesystem::remove(segment.path, ec);
+        CrashPoint::hit("journal.removing");
+    }
+
+    // A failed journal refused every record since the failure, so when the
+    // failure was in a removed segment, the active one holds nothing and the
+    // snapshot holds the rest.
+    // The snapshot now holds every record the removed segments did.
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failedSegment && failedSegment < below)
+        failedSegment = 0;
+    if (!failedSegment)
+        markDurable(sealedSequence);
+}
+
+// ===================== REPLAY =====================
+
+JournalReplayStats Journal::replay(const std::string& base, Inventory& inventory, std::uint64_t afterSequence) {
+    Trace::Span span("replayJournal", "load");
+    JournalReplayStats stats;
+
+    ScanResult scan = scanSegments(base, [&](std::uint64_t seq, std::uint8_t op, BinaryReader& in) {
+        if (seq <= afterSequence) {
+            ++stats.skipped;
+            return true;
+        }
+
+        // Records between the snapshot and the journal are missing.
+        if (seq != afterSequence + stats.applied + stats.failed + 1)
+            return false;
+
+        bool ok = false;
+        std::string serial;
+        std::int32_t amount;
+
+        switch (op) {
+        case AddOp:
+            if (auto product = ProductCodec::decode(in))
+                ok = inventory.addProduct(product);
+            break;
+        case RemoveOp:
+            ok = in.str(serial) && inventory.removeProductBySerial(serial);
+            break;
+        case UpdateOp:
+            if (in.str(serial)) {
+                auto product = ProductCodec::decode(in);
+                ok = product && inventory.replaceProduct(serial, product);
+            }
+            break;
+        case StockInOp:
+            ok = in.str(serial) && in.i32(amount) && inventory.stockIn(serial, amount);
+            break;
+        case StockOutOp:
+            ok = in.str(serial) && in.i32(amount) && inventory.stockOut(serial, amount);
+            break;
+        case BatchOp:
+            ok = replayBatch(in, inventory);
+            break;
+        }
+
+        if (ok)
+            ++stats.applied;
+        else
+            ++stats.failed;
+        return true;
+    });
+
+    stats.lastSequence = std::max(afterSequence, scan.lastSequence);
+    stats.tornTail = scan.damaged < scan.segments.size();
+    span.arg("applied", stats.applied);
+    span.arg("failed", stats.failed);
+    return stats;
+}
+
+bool Journal::replayBatch(BinaryReader& in, Inventory& inventory) {
+    std::uint32_t count;
+    if (!in.u32(count))
+        return false;
+
+    std::vector<StockOperation> operations;
+    operations.reserve(std::min<std::size_t>(count, in.remaining()));
+    for (std::uint32_t i = 0; i < count; i++) {
+        std::uint8_t kind;
+        StockOperation op;
+        if (!in.u8(kind) || !in.str(op.serial) || !in.i32(op.amount))
+            return false;
+        op.kind = kind == StockOutOp ? StockOperation::Out : StockOperation::In;
+        operations.push_back(std::move(op));
+    }
+    return inventory.applyBatch(operations).applied;
+}
+
+std::filesystem::file_time_type Journal::lastWriteTime(const std::string& base) {
+    auto newest = std::filesystem::file_time_type::min();
+
+    for (const Segment& segment : listSegments(base)) {
+        std::error_code ec;
+        auto time = std::filesystem::last_write_time(segment.path, ec);
+        if (!ec && time > newest)
+            newest = time;
+    }
+    return newest;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "DurableFile.h"
+#include "StockOperation.h"
+
+class BinaryReader;
+class Inventory;
+class Product;
+
+// When appended records are forced to disk. Only EveryOperation makes a
+// change durable before the mutating call returns. The other two
+// acknowledge it first and can lose the last interval of acknowledged
+// changes: GroupCommit keeps up to groupCommitRecords of them in process
+// memory, so even a killed process loses them; Periodic has already
+// written them, so only an OS crash or power loss does.
+enum class JournalSync {
+    EveryOperation, // write + fsync before the mutating call returns
+    GroupCommit,    // buffer records; one write + fsync per group or interval
+    Periodic        // write immediately, fsync from a background timer
+};
+
+struct JournalOptions {
+    JournalSync sync = JournalSync::GroupCommit;
+    std::size_t groupCommitRecords = 64;
+    std::chrono::milliseconds interval{ 100 };
+};
+
+// What a log* call hands back: the record's sequence (0 when the journal
+// refused it) and whether commit() has to wait for it to reach the disk.
+struct JournalTicket {
+    std::uint64_t sequence = 0;
+    bool wait = false;
+
+    explicit operator bool() const { return sequence != 0; }
+};
+
+struct JournalReplayStats {
+    std::size_t applied = 0;
+    std::size_t skipped = 0;
+    std::size_t failed = 0;
+    std::uint64_t lastSequence = 0;
+    bool tornTail = false;
+};
+
+// Append-only write-ahead log of mutating Inventory operations, stored as
+// numbered segment files "<base>.000001", "<base>.000002", ... Each record
+// is framed as
+//
+//   u32 body length, u32 CRC-32 of body
+//   body: u64 sequence, u8 operation, operation payload (ProductCodec format)
+//
+// Sequence numbers are contiguous across segments. A snapshot stores the
+// last sequence it includes; on startup the journal is replayed on top of
+// it and records at or below that sequence are skipped. Replay stops at the
+// first torn, corrupt or out-of-sequence record, and reopening the journal
+// cuts everything from that point on.
+class Journal {
+public:
+    Journal();
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Opens a fresh segment for appending; new records are numbered after
+    // max(startSequence, last intact record in the existing segments).
+    bool open(const std::string& base, const JournalOptions& options, std::uint64_t startSequence = 0);
+    void close();
+    bool isOpen() const;
+
+    // Appending never waits for an fsync: the record is buffered, or handed
+    // to the kernel when the sync policy says so. A refused record (the
+    // write failed, or the journal has failed) gives an empty ticket.
+    JournalTicket logAdd(const Product& product);
+    JournalTicket logRemove(std::string_view serial);
+    JournalTicket logUpdate(std::string_view currentSerial, const Product& product);
+    JournalTicket logStockIn(std::string_view serial, int amount);
+    JournalTicket logStockOut(std::string_view serial, int amount);
+    JournalTicket logBatch(const std::vector<StockOperation>& operations);
+
+    // Waits until the ticket's record is durable when the sync policy
+    // promises that (every record under EveryOperation, the one that filled
+    // a group under GroupCommit); the fsync itself runs on the flush thread.
+    // Call it after the change is applied and the caller's locks are
+    // released. False when the record was lost to a failed write or fsync.
+    bool commit(const JournalTicket& ticket);
+
+    // Forces every record appended so far to disk.
+    bool sync();
+
+    // Once a write or fsync fails, appends are refused (the log* calls
+    // return false) until a checkpoint has moved past the damaged segment:
+    // nothing may land behind a torn record that replay would stop at.
+    bool hasFailed() const;
+    // Records refused or lost to a failed write since open().
+    std::uint64_t failedRecords() const;
+
+    std::uint64_t lastSequence() const;
+
+    // Size and age of the active segment, i.e. what the next checkpoint would cover.
+    std::uint64_t activeBytes() const;
+    std::chrono::steady_clock::duration activeAge() const;
+
+    // ---------- Checkpoint support ----------
+    // Creates the next segment file ahead of time so rotate() does no disk I/O.
+    bool prepareRotation();
+    // Switches appends to the prepared segment and returns the last sequence
+    // in the segments left behind. Call while mutations are held off.
+    std::uint64_t rotate();
+    // Makes the segments left behind by rotate() durable. The flush thread
+    // waits for it before syncing the active segment, so that one never
+    // gets ahead; commit() callers wait with it, holding no Inventory lock.
+    bool sealRotated();
+    // Deletes the segments left behind by rotate(); only once a snapshot covers them.
+    void removeSealedSegments();
+
+    static JournalReplayStats replay(const std::string& base, Inventory& inventory, std::uint64_t afterSequence);
+
+    // Newest modification time among the segments, or file_time_type::min() if there are none.
+    static std::filesystem::file_time_type lastWriteTime(const std::string& base);
+
+private:
+    enum Operation : std::uint8_t {
+        AddOp = 1,
+        RemoveOp = 2,
+        UpdateOp = 3,
+        StockInOp = 4,
+        StockOutOp = 5,
+        BatchOp = 6
+    };
+
+    std::string base;
+    JournalOptions options;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable sealDone;
+    std::condition_variable durable;
+    std::thread flusher;
+    bool stopping;
+
+    // Shared so the flush thread can fsync a segment without the mutex
+    // while rotate() moves it aside.
+    std::shared_ptr<DurableFile> out;
+    DurableFile next;
+    std::shared_ptr<DurableFile> sealing;
+    bool sealInFlight;
+    std::uint64_t activeSegment;
+    std::uint64_t sealedBelow;
+    std::uint64_t sealedSequence;   // last record in the segments below sealedBelow
+
+    std::string pending;
+    std::size_t pendingRecords;
+    std::uint64_t writtenSequence;  // last record handed to the kernel
+    std::uint64_t durableSequence;  // last record known to be on disk
+    std::uint64_t syncRequested;    // highest record a commit() waits for
+    std::uint64_t lostFrom;         // records lost to the last failure
+    std::uint64_t lostThrough;
+    std::uint64_t failedSegment;    // 0, or the segment a write failed in
+    std::uint64_t failedCount;
+    std::uint64_t sequence;
+    std::uint64_t bytes;
+    std::chrono::steady_clock::time_point firstRecordAt;
+
+    JournalTicket append(Operation op, const std::string& payload);
+    static bool replayBatch(BinaryReader& in, Inventory& inventory);
+    bool writeLocked();
+    bool syncWritten(std::unique_lock<std::mutex>& lock);
+    bool failLocked(std::uint64_t segment);
+    void markDurable(std::uint64_t through);
+    bool lost(std::uint64_t record) const;
+    void flushLoop();
+};
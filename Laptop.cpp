@@ -18,6 +18,10 @@ Laptop::Laptop(
 }
 
 const std::string& Laptop::getCpu() const {
+    return cpu.str();
+}
+
+const InternedString& Laptop::getInternedCpu() const {
     return cpu;
 }
 
@@ -38,11 +42,11 @@ nlohmann::json Laptop::toJson() const {
         {"type", getType()},
         {"serialNumber", serialNumber},
         {"name", name},
-        {"brand", brand},
+        {"brand", brand.str()},
         {"price", price},
-        {"quantity", quantity},
+        {"quantity", getQuantity()},
         {"categoryId", categoryId},
-        {"cpu", cpu},
+        {"cpu", cpu.str()},
         {"ramGB", ramGB},
         {"storageGB", storageGB}
     };
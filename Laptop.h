@@ -5,7 +5,7 @@
 
 class Laptop : public Product {
 private:
-    std::string cpu;
+    InternedString cpu;
     int ramGB;
     int storageGB;
 
@@ -23,6 +23,7 @@ public:
     );
 
     const std::string& getCpu() const;
+    const InternedString& getInternedCpu() const;
     int getRamGB() const;
     int getStorageGB() const;
 
@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "SocketAddress.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// Load generator for TechWarehouse --serve. Each connection runs on its own
+// thread and keeps --depth requests in flight, sending a new one for every
+// result it reads. Prints throughput and latency percentiles per operation
+// as one JSON document, like TechWarehouseBench.
+
+enum class LoadOp { Find, Stock, Query, Count };
+static const char* const kOpNames[] = { "find", "stock", "query", "count" };
+static constexpr std::size_t kLoadOps = 4;
+
+struct LoadOptions {
+    SocketAddress address;
+    std::size_t connections = 4;
+    std::size_t depth = 16;
+    double seconds = 10.0;
+    std::size_t keys = 10000;
+    std::uint64_t seed = 42;
+    std::vector<unsigned> mix = { 80, 15, 4, 1 };
+    std::string outFile;
+};
+
+// Catalog facts the requests are built from.
+struct Workload {
+    std::vector<std::string> serials;
+    double maxPrice = 0.0;
+};
+
+struct ConnectionResult {
+    std::vector<double> latencies[kLoadOps];
+    std::uint64_t failed[kLoadOps] = {};
+    bool connected = false;
+    bool dropped = false;
+};
+
+#ifndef _WIN32
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    std::size_t at = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(at, sorted.size() - 1)];
+}
+
+// ===================== CONNECTION =====================
+
+// Blocking line I/O over one socket.
+class LineSocket {
+public:
+    explicit LineSocket(int fd) : fd(fd) {}
+    ~LineSocket() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    LineSocket(const LineSocket&) = delete;
+    LineSocket& operator=(const LineSocket&) = delete;
+
+    bool send(const std::string& data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            sent += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    // Blocks for at least one more line, then returns every complete line
+    // received so far; false once the server has closed.
+    bool readLines(std::vector<std::string>& lines) {
+        lines.clear();
+        for (;;) {
+            std::size_t start = 0;
+            for (std::size_t at = buffer.find('\n'); at != std::string::npos; at = buffer.find('\n', start)) {
+                lines.emplace_back(buffer, start, at - start);
+                start = at + 1;
+            }
+            buffer.erase(0, start);
+            if (!lines.empty())
+                return true;
+
+            char chunk[64 * 1024];
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, static_cast<std::size_t>(n));
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+};
+
+static bool succeeded(const std::string& result) {
+    return result.find("\"ok\":true") != std::string::npos;
+}
+
+// ===================== WORKLOAD =====================
+
+// Serials come from price windows sized to hold about 50 products each, the
+// most a query result lists.
+static bool fetchWorkload(const LoadOptions& options, Workload& workload) {
+    LineSocket socket(options.address.connect());
+    std::vector<std::string> lines;
+
+    if (!socket.send("count price>=0\nquery price>=0 ORDER BY price DESC LIMIT 1\n"))
+        return false;
+
+    std::vector<std::string> answers;
+    while (answers.size() < 2) {
+        if (!socket.readLines(lines))
+            return false;
+        answers.insert(answers.end(), lines.begin(), lines.end());
+    }
+
+    json count = json::parse(answers[0], nullptr, false);
+    json top = json::parse(answers[1], nullptr, false);
+    if (!count.is_object() || !top.is_object() || !count.value("ok", false) || count.value("count", 0) == 0)
+        return false;
+
+    const std::size_t products = count["count"].get<std::size_t>();
+    const std::string last = top["serials"].at(0).get<std::string>();
+    if (!socket.send("find " + last + "\n") || !socket.readLines(lines))
+        return false;
+    json found = json::parse(lines[0], nullptr, false);
+    if (!found.is_object() || !found.value("ok", false))
+        return false;
+    workload.maxPrice = found["product"].value("price", 0.0);
+
+    const std::size_t windows = std::max<std::size_t>(1, std::min(products, options.keys) / 50);
+    const double width = std::max(0.01, workload.maxPrice / static_cast<double>(windows));
+
+    std::string requests;
+    for (std::size_t i = 0; i < windows; i++) {
+        const double low = static_cast<double>(i) * width;
+        requests += "query price>=" + std::to_string(low) + " AND price<" + std::to_string(low + width) + "\n";
+    }
+    if (!socket.send(requests))
+        return false;
+
+    for (std::size_t received = 0; received < windows;) {
+        if (!socket.readLines(lines))
+            return false;
+        for (const auto& line : lines) {
+            json j = json::parse(line, nullptr, false);
+            if (j.is_object() && j.contains("serials")) {
+                for (const auto& serial : j["serials"])
+                    workload.serials.push_back(serial.get<std::string>());
+            }
+        }
+        received += lines.size();
+    }
+
+    if (workload.serials.size() > options.keys)
+        workload.serials.resize(options.keys);
+    return !workload.serials.empty();
+}
+
+static LoadOp pickOp(std::mt19937_64& rng, const std::vector<unsigned>& mix, unsigned total) {
+    unsigned roll = static_cast<unsigned>(rng() % total);
+    for (std::size_t i = 0; i < kLoadOps; i++) {
+        if (roll < mix[i])
+            return static_cast<LoadOp>(i);
+        roll -= mix[i];
+    }
+    return LoadOp::Find;
+}
+
+// Stock moves alternate in and out by one, so levels hardly drift over a run.
+static std::string makeRequest(LoadOp op, std::mt19937_64& rng, const Workload& workload, std::uint64_t sequence) {
+    const std::string& serial = workload.serials[rng() % workload.serials.size()];
+    const double low = static_cast<double>(rng() % static_cast<std::uint64_t>(workload.maxPrice + 1.0));
+
+    switch (op) {
+    case LoadOp::Find:
+        return "find " + serial + "\n";
+    case LoadOp::Stock:
+        return (sequence % 2 == 0 ? "stock-in " : "stock-out ") + serial + " 1\n";
+    case LoadOp::Query:
+        return "query price>=" + std::to_string(low) + " AND price<" + std::to_string(low + 10.0) + " ORDER BY price LIMIT 10\n";
+    case LoadOp::Count:
+        return "count quantity>0 AND price>=" + std::to_string(low) + "\n";
+    }
+    return "find " + serial + "\n";
+}
+
+static void runConnection(const LoadOptions& options, const Workload& workload, std::size_t index,
+    Clock::time_point deadline, ConnectionResult& result) {
+    LineSocket socket(options.address.connect());
+    std::mt19937_64 rng(options.seed + index);
+    unsigned total = 0;
+    for (unsigned share : options.mix)
+        total += share;
+
+    struct Pending {
+        LoadOp op;
+        Clock::time_point sent;
+    };
+    std::deque<Pending> pending;
+    std::uint64_t sequence = 0;
+    std::string requests;
+
+    auto issue = [&](std::size_t count) {
+        requests.clear();
+        const Clock::time_point now = Clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            LoadOp op = pickOp(rng, options.mix, total);
+            requests += makeRequest(op, rng, workload, sequence++);
+            pending.push_back({ op, now });
+        }
+        return count == 0 || socket.send(requests);
+    };
+
+    if (!issue(options.depth))
+        return;
+    result.connected = true;
+
+    std::vector<std::string> lines;
+    while (!pending.empty()) {
+        if (!socket.readLines(lines)) {
+            result.dropped = true;
+            return;
+        }
+
+        const Clock::time_point now = Clock::now();
+        for (const auto& line : lines) {
+            if (pending.empty())
+                break;
+            const Pending done = pending.front();
+            pending.pop_front();
+
+            const std::size_t op = static_cast<std::size_t>(done.op);
+            result.latencies[op].push_back(std::chrono::duration<double, std::micro>(now - done.sent).count());
+            if (!succeeded(line))
+                result.failed[op]++;
+        }
+
+        if (now < deadline && !issue(lines.size())) {
+            result.dropped = true;
+            return;
+        }
+    }
+}
+
+// ===================== REPORT =====================
+
+static json opRow(const std::string& name, std::vector<double>& latencies, std::uint64_t failed, double seconds) {
+    std::sort(latencies.begin(), latencies.end());
+
+    json row;
+    row["operation"] = name;
+    row["requests"] = latencies.size();
+    row["failed"] = failed;
+    row["opsPerSec"] = seconds > 0.0 ? static_cast<double>(latencies.size()) / seconds : 0.0;
+    row["p50Us"] = percentile(latencies, 0.50);
+    row["p90Us"] = percentile(latencies, 0.90);
+    row["p99Us"] = percentile(latencies, 0.99);
+    row["p999Us"] = percentile(latencies, 0.999);
+    row["maxUs"] = latencies.empty() ? 0.0 : latencies.back();
+    return row;
+}
+
+static json runLoad(const LoadOptions& options, const Workload& workload) {
+    std::vector<ConnectionResult> results(options.connections);
+    std::vector<std::thread> threads;
+
+    const Clock::time_point started = Clock::now();
+    const Clock::time_point deadline = started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+    for (std::size_t i = 0; i < options.connections; i++)
+        threads.emplace_back(runConnection, std::cref(options), std::cref(workload), i, deadline, std::ref(results[i]));
+    for (auto& thread : threads)
+        thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+    std::vector<double> all;
+    std::vector<double> perOp[kLoadOps];
+    std::uint64_t failed[kLoadOps] = {};
+    std::size_t connected = 0;
+    std::size_t dropped = 0;
+    for (auto& r : results) {
+        connected += r.connected ? 1 : 0;
+        dropped += r.dropped ? 1 : 0;
+        for (std::size_t op = 0; op < kLoadOps; op++) {
+            perOp[op].insert(perOp[op].end(), r.latencies[op].begin(), r.latencies[op].end());
+            all.insert(all.end(), r.latencies[op].begin(), r.latencies[op].end());
+            failed[op] += r.failed[op];
+        }
+    }
+
+    json report;
+    report["loadGenerator"] = "TechWarehouse";
+    report["address"] = options.address.describe();
+    report["connections"] = options.connections;
+    report["connected"] = connected;
+    report["dropped"] = dropped;
+    report["depth"] = options.depth;
+    report["keys"] = workload.serials.size();
+    report["seconds"] = seconds;
+
+    std::uint64_t totalFailed = 0;
+    report["operations"] = json::array();
+    for (std::size_t op = 0; op < kLoadOps; op++) {
+        totalFailed += failed[op];
+        if (!perOp[op].empty())
+            report["operations"].push_back(opRow(kOpNames[op], perOp[op], failed[op], seconds));
+    }
+    report["total"] = opRow("total", all, totalFailed, seconds);
+    return report;
+}
+
+// ===================== MAIN =====================
+
+// "find:80,stock:15,query:4,count:1"; operations left out get no share.
+static bool parseMix(const std::string& text, std::vector<unsigned>& mix) {
+    mix.assign(kLoadOps, 0);
+    std::stringstream in(text);
+    std::string item;
+    unsigned total = 0;
+    try {
+        while (std::getline(in, item, ',')) {
+            std::size_t colon = item.find(':');
+            if (colon == std::string::npos)
+                return false;
+            const std::string name = item.substr(0, colon);
+            std::size_t op = 0;
+            while (op < kLoadOps && name != kOpNames[op])
+                op++;
+            if (op == kLoadOps)
+                return false;
+
+            std::size_t used = 0;
+            const std::string share = item.substr(colon + 1);
+            mix[op] = static_cast<unsigned>(std::stoul(share, &used));
+            if (used != share.size())
+                return false;
+            total += mix[op];
+        }
+    }
+    catch (...) {
+        return false;
+    }
+    return total > 0;
+}
+
+#endif
+
+static void printUsage() {
+    std::cerr << "Usage: TechWarehouseLoad --connect unix:<path>|tcp:<port> [--connections <n>] [--depth <in flight>]\n"
+        << "                         [--seconds <n>] [--keys <serials>] [--mix find:80,stock:15,query:4,count:1]\n"
+        << "                         [--seed <n>] [--out <file>]\n";
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    printUsage();
+    std::cerr << "The load generator needs POSIX sockets.\n";
+    return 1;
+#else
+    LoadOptions options;
+    bool haveAddress = false;
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[i + 1];
+
+        try {
+            if (option == "--connect" && SocketAddress::parse(value, options.address)) {
+                haveAddress = true;
+                continue;
+            }
+            if (option == "--connections" && std::stoul(value) > 0) {
+                options.connections = std::stoul(value);
+                continue;
+            }
+            if (option == "--depth" && std::stoul(value) > 0) {
+                options.depth = std::stoul(value);
+                continue;
+            }
+            if (option == "--seconds" && std::stod(value) > 0.0) {
+                options.seconds = std::stod(value);
+                continue;
+            }
+            if (option == "--keys" && std::stoul(value) > 0) {
+                options.keys = std::stoul(value);
+                continue;
+            }
+            if (option == "--mix" && parseMix(value, options.mix))
+                continue;
+            if (option == "--seed") {
+                options.seed = std::stoull(value);
+                continue;
+            }
+            if (option == "--out") {
+                options.outFile = value;
+                continue;
+            }
+        }
+        catch (...) {
+        }
+
+        printUsage();
+        return 1;
+    }
+
+    if (!haveAddress) {
+        printUsage();
+        return 1;
+    }
+
+    Workload workload;
+    if (!fetchWorkload(options, workload)) {
+        std::cerr << "Failed to read serials from " << options.address.describe() << ".\n";
+        return 1;
+    }
+    std::cerr << workload.serials.size() << " serials, " << options.connections << " connections x "
+        << options.depth << " in flight for " << options.seconds << " s\n";
+
+    json report = runLoad(options, workload);
+    std::cerr << report["total"]["opsPerSec"].get<double>() << " requests/s, p99 "
+        << report["total"]["p99Us"].get<double>() << " us\n";
+
+    if (options.outFile.empty()) {
+        std::cout << report.dump(2) << "\n";
+        return 0;
+    }
+
+    std::ofstream out(options.outFile);
+    if (!out.is_open()) {
+        std::cerr << "Failed to write " << options.outFile << ".\n";
+        return 1;
+    }
+    out << report.dump(2) << "\n";
+    return 0;
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Outcome and throughput of the last Inventory load.
+struct LoadStats {
+    std::size_t records = 0;
+    std::size_t loaded = 0;
+    std::size_t skipped = 0;
+    std::uint64_t bytes = 0;
+    double seconds = 0.0;
+
+    // Last journal record already reflected in the loaded image.
+    std::uint64_t sequence = 0;
+
+    double recordsPerSecond() const {
+        return seconds > 0.0 ? static_cast<double>(records) / seconds : 0.0;
+    }
+
+    double megabytesPerSecond() const {
+        return seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
@@ -0,0 +1,215 @@
+#include "MemoryAccounting.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "ProcessStats.h"
+
+namespace {
+    const char* const kNames[] = {
+        "other",
+        "products",
+        "indexes",
+        "jsonDom",
+        "snapshot",
+        "journal",
+    };
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == MemoryAccounting::kSubsystems, "one name per MemorySubsystem");
+
+    // Constant-initialised, so the allocator can use them before any static
+    // constructor has run.
+    struct alignas(64) Counters {
+        std::atomic<std::uint64_t> allocations{ 0 };
+        std::atomic<std::uint64_t> frees{ 0 };
+        std::atomic<std::uint64_t> liveBytes{ 0 };
+        std::atomic<std::uint64_t> peakBytes{ 0 };
+    };
+
+    Counters counters[MemoryAccounting::kSubsystems];
+    Counters totals;
+
+    MemoryAccounting::Tally read(const Counters& c) {
+        MemoryAccounting::Tally t;
+        t.allocations = c.allocations.load(std::memory_order_relaxed);
+        t.frees = c.frees.load(std::memory_order_relaxed);
+        t.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+        t.peakBytes = c.peakBytes.load(std::memory_order_relaxed);
+        return t;
+    }
+
+    double perProduct(std::size_t bytes, std::size_t products) {
+        return products ? static_cast<double>(bytes) / static_cast<double>(products) : 0.0;
+    }
+}
+
+// ===================== TALLIES =====================
+
+bool MemoryAccounting::tracking() {
+    return TW_TRACK_ALLOCATIONS != 0;
+}
+
+const char* MemoryAccounting::name(MemorySubsystem subsystem) {
+    return kNames[static_cast<std::size_t>(subsystem)];
+}
+
+MemoryAccounting::Tally MemoryAccounting::tally(MemorySubsystem subsystem) {
+    return read(counters[static_cast<std::size_t>(subsystem)]);
+}
+
+MemoryAccounting::Tally MemoryAccounting::total() {
+    return read(totals);
+}
+
+// ===================== REPORT =====================
+
+std::size_t InventoryMemory::perProductBytes() const {
+    return objectBytes + stringHeapBytes + controlBlockBytes;
+}
+
+std::size_t InventoryMemory::total() const {
+    return perProductBytes() + productListBytes + internedBytes +
+        columnBytes + serialIndexBytes + nameIndexBytes + orderedIndexBytes + bitmapIndexBytes;
+}
+
+nlohmann::json MemoryAccounting::toJson(const InventoryMemory& usage) {
+    nlohmann::json j;
+    j["tracking"] = tracking();
+    j["products"] = usage.products;
+
+    nlohmann::json& each = j["perProduct"];
+    each["objectBytes"] = perProduct(usage.objectBytes, usage.products);
+    each["stringHeapBytes"] = perProduct(usage.stringHeapBytes, usage.products);
+    each["controlBlockBytes"] = perProduct(usage.controlBlockBytes, usage.products);
+    each["totalBytes"] = perProduct(usage.total(), usage.products);
+
+    nlohmann::json& inventory = j["inventory"];
+    inventory["productObjects"] = usage.objectBytes;
+    inventory["stringHeap"] = usage.stringHeapBytes;
+    inventory["controlBlocks"] = usage.controlBlockBytes;
+    inventory["productList"] = usage.productListBytes;
+    inventory["internedStrings"] = usage.internedBytes;
+    inventory["columns"] = usage.columnBytes;
+    inventory["serialIndex"] = usage.serialIndexBytes;
+    inventory["nameIndex"] = usage.nameIndexBytes;
+    inventory["orderedIndexes"] = usage.orderedIndexBytes;
+    inventory["bitmapIndexes"] = usage.bitmapIndexBytes;
+    inventory["total"] = usage.total();
+
+    j["process"]["rssBytes"] = ProcessStats::currentRssBytes();
+    j["process"]["peakRssBytes"] = ProcessStats::peakRssBytes();
+
+    if (tracking()) {
+        j["allocations"] = nlohmann::json::array();
+        for (std::size_t i = 0; i < kSubsystems; i++) {
+            const Tally t = tally(static_cast<MemorySubsystem>(i));
+            j["allocations"].push_back({
+                { "subsystem", kNames[i] },
+                { "allocations", t.allocations },
+                { "frees", t.frees },
+                { "liveBytes", t.liveBytes },
+                { "peakBytes", t.peakBytes }
+            });
+        }
+
+        const Tally t = total();
+        j["allocations"].push_back({
+            { "subsystem", "total" },
+            { "allocations", t.allocations },
+            { "frees", t.frees },
+            { "liveBytes", t.liveBytes },
+            { "peakBytes", t.peakBytes }
+        });
+    }
+    return j;
+}
+
+// ===================== ALLOCATOR HOOK =====================
+
+#if TW_TRACK_ALLOCATIONS
+
+namespace {
+    // Sits just before every block handed out; `offset` leads back to what
+    // malloc returned, which differs from the header only for over-aligned
+    // blocks.
+    struct Header {
+        std::uint64_t size;
+        std::uint32_t subsystem;
+        std::uint32_t offset;
+    };
+    static_assert(sizeof(Header) == 16, "keeps default-aligned blocks aligned");
+
+    void charge(Counters& c, std::uint64_t size) {
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        const std::uint64_t live = c.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        std::uint64_t peak = c.peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    void credit(Counters& c, std::uint64_t size) {
+        c.frees.fetch_add(1, std::memory_order_relaxed);
+        c.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    void* allocate(std::size_t size, std::size_t alignment) {
+        if (alignment < alignof(std::max_align_t))
+            alignment = alignof(std::max_align_t);
+
+        // Room for the header plus whatever it takes to align past it.
+        char* raw = static_cast<char*>(std::malloc(size + sizeof(Header) + alignment));
+        if (!raw)
+            return nullptr;
+
+        std::uintptr_t user = reinterpret_cast<std::uintptr_t>(raw) + sizeof(Header);
+        user = (user + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+
+        const std::size_t subsystem = static_cast<std::size_t>(MemoryAccounting::current());
+        Header* header = reinterpret_cast<Header*>(user) - 1;
+        header->size = size;
+        header->subsystem = static_cast<std::uint32_t>(subsystem);
+        header->offset = static_cast<std::uint32_t>(user - reinterpret_cast<std::uintptr_t>(raw));
+
+        charge(counters[subsystem], size);
+        charge(totals, size);
+        return reinterpret_cast<void*>(user);
+    }
+
+    void release(void* block) {
+        if (!block)
+            return;
+
+        const Header* header = static_cast<const Header*>(block) - 1;
+        credit(counters[header->subsystem], header->size);
+        credit(totals, header->size);
+        std::free(static_cast<char*>(block) - header->offset);
+    }
+
+    void* allocateOrThrow(std::size_t size, std::size_t alignment) {
+        for (;;) {
+            if (void* block = allocate(size ? size : 1, alignment))
+                return block;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+// The nothrow forms of the standard library call these.
+void* operator new(std::size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateOrThrow(size, static_cast<std::size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateOrThrow(size, static_cast<std::size_t>(alignment)); }
+
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, std::size_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept { release(block); }
+
+#endif
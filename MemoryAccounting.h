@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+// Define TW_TRACK_ALLOCATIONS as 1 for an instrumented build: the global
+// operator new and delete are replaced by versions that tally every
+// allocation against the subsystem the allocating thread is working for.
+// Off by default, since each allocation then pays a header and four atomic
+// updates; the structural estimate in InventoryMemory works in every build.
+#ifndef TW_TRACK_ALLOCATIONS
+#define TW_TRACK_ALLOCATIONS 0
+#endif
+
+// Who an allocation is charged to. A block is credited back to the same
+// subsystem when it is freed, whichever thread frees it.
+enum class MemorySubsystem : std::uint8_t {
+    Other,
+    Products,       // product objects and their strings, while loading
+    Indexes,        // serial, name, ordered and bitmap indexes and columns
+    JsonDom,        // nlohmann::json documents built for saving and batch commands
+    Snapshot,       // snapshot encode buffers
+    Journal,        // journal record and write buffers
+    Count
+};
+
+// Where an inventory's memory goes, worked out from the containers it
+// holds rather than from the allocator, so it is the same in every build.
+// Allocator rounding and per-block overhead are not included.
+struct InventoryMemory {
+    std::size_t products = 0;
+
+    std::size_t objectBytes = 0;        // the Laptop/Phone/DesktopComputer objects
+    std::size_t stringHeapBytes = 0;    // serial and name buffers too long for the small-string buffer
+    std::size_t controlBlockBytes = 0;  // shared_ptr control blocks (make_shared: in the object's allocation)
+    std::size_t productListBytes = 0;   // the vector of shared_ptrs
+    std::size_t internedBytes = 0;      // the process-wide pool of brands, CPUs and GPUs
+
+    std::size_t columnBytes = 0;
+    std::size_t serialIndexBytes = 0;
+    std::size_t nameIndexBytes = 0;
+    std::size_t orderedIndexBytes = 0;  // price and quantity
+    std::size_t bitmapIndexBytes = 0;
+
+    std::size_t perProductBytes() const;
+    std::size_t total() const;
+};
+
+class MemoryAccounting {
+public:
+    static constexpr std::size_t kSubsystems = static_cast<std::size_t>(MemorySubsystem::Count);
+
+    struct Tally {
+        std::uint64_t allocations = 0;
+        std::uint64_t frees = 0;
+        std::uint64_t liveBytes = 0;
+        std::uint64_t peakBytes = 0;
+    };
+
+    static bool tracking();
+    static const char* name(MemorySubsystem subsystem);
+
+    // Zero unless tracking.
+    static Tally tally(MemorySubsystem subsystem);
+    static Tally total();
+
+    // {"tracking", "products", "perProduct": {...}, "inventory": {...},
+    // "process": {"rssBytes", "peakRssBytes"}, "allocations": [...]}; the
+    // allocation tallies are listed only when tracking.
+    static nlohmann::json toJson(const InventoryMemory& usage);
+
+    // Allocations by this thread are charged to `subsystem` until the scope
+    // ends; scopes nest.
+#if TW_TRACK_ALLOCATIONS
+    class Scope {
+    public:
+        explicit Scope(MemorySubsystem subsystem) : previous(current()) {
+            current() = subsystem;
+        }
+        ~Scope() {
+            current() = previous;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        MemorySubsystem previous;
+    };
+
+    static MemorySubsystem& current() {
+        thread_local MemorySubsystem subsystem = MemorySubsystem::Other;
+        return subsystem;
+    }
+#else
+    class Scope {
+    public:
+        explicit Scope(MemorySubsystem) {}
+    };
+#endif
+};
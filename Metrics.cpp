@@ -0,0 +1,261 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+    // Never destroyed, like the string pool: threads may still record while
+    // statics are torn down.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Metrics::Block>> blocks;
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry() {
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    // Forces the registry, and so the uptime clock, to start with the process.
+    const Registry& startedAtLoad = registry();
+
+    const char* const kNames[] = {
+        "addProduct",
+        "serialExists",
+        "findBySerial",
+        "getAllProducts",
+        "readProducts",
+        "searchByName",
+        "listByCategory",
+        "forEachProduct",
+        "forEachInCategory",
+        "query",
+        "countMatching",
+        "removeProductBySerial",
+        "updateProductFromJson",
+        "replaceProduct",
+        "canStockIn",
+        "canStockOut",
+        "stockIn",
+        "stockOut",
+        "applyBatch",
+        "getStockValue",
+        "getTotalUnits",
+        "countLowStock",
+        "getPriceRange",
+        "findByPriceRange",
+        "countByPriceRange",
+        "findByQuantityRange",
+        "countByQuantityRange",
+        "lowestStock",
+        "topByPrice",
+        "loadFromFile",
+        "saveToFile",
+        "loadSnapshot",
+        "saveSnapshot",
+        "checkpoint",
+        "memoryUsage",
+    };
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == Metrics::kOps, "one name per InventoryOp");
+
+    // One operation summed over every thread's block.
+    struct Totals {
+        std::uint64_t calls = 0;
+        std::uint64_t timed = 0;
+        std::uint64_t sumNanos = 0;
+        std::uint64_t maxNanos = 0;
+        std::vector<std::uint64_t> buckets = std::vector<std::uint64_t>(Metrics::kBuckets, 0);
+    };
+
+    std::vector<Totals> collect() {
+        std::vector<Totals> totals(Metrics::kOps);
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+
+        for (const auto& block : r.blocks) {
+            for (std::size_t op = 0; op < Metrics::kOps; op++) {
+                Totals& t = totals[op];
+                t.calls += block->calls[op].load(std::memory_order_relaxed);
+                t.timed += block->timed[op].load(std::memory_order_relaxed);
+                t.sumNanos += block->sumNanos[op].load(std::memory_order_relaxed);
+                t.maxNanos = std::max(t.maxNanos, block->maxNanos[op].load(std::memory_order_relaxed));
+                for (std::size_t b = 0; b < Metrics::kBuckets; b++)
+                    t.buckets[b] += block->buckets[op][b].load(std::memory_order_relaxed);
+            }
+        }
+        return totals;
+    }
+
+    // Midpoint of the bucket holding the p-th timed call, capped at the
+    // slowest one seen.
+    double percentileMicros(const Totals& t, double p) {
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < Metrics::kBuckets; b++) {
+            const std::uint64_t inBucket = t.buckets[b];
+            seen += inBucket;
+            if (inBucket != 0 && static_cast<double>(seen) >= p * static_cast<double>(t.timed)) {
+                const double mid = (static_cast<double>(Metrics::lowerBound(b)) + static_cast<double>(Metrics::lowerBound(b + 1))) / 2.0;
+                return std::min(mid, static_cast<double>(t.maxNanos)) / 1000.0;
+            }
+        }
+        return static_cast<double>(t.maxNanos) / 1000.0;
+    }
+
+    void bump(std::atomic<std::uint64_t>& counter, std::uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+}
+
+// ===================== RECORDING =====================
+
+bool Metrics::enabled() {
+    return TW_METRICS != 0;
+}
+
+const char* Metrics::name(InventoryOp op) {
+    return kNames[static_cast<std::size_t>(op)];
+}
+
+Metrics::Block* Metrics::attach() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    for (const auto& block : r.blocks) {
+        if (!block->inUse.load(std::memory_order_acquire)) {
+            block->inUse.store(true, std::memory_order_relaxed);
+            return block.get();
+        }
+    }
+
+    r.blocks.push_back(std::unique_ptr<Block>(new Block()));
+    r.blocks.back()->inUse.store(true, std::memory_order_relaxed);
+    return r.blocks.back().get();
+}
+
+void Metrics::record(Block& block, InventoryOp op, std::uint64_t nanos) {
+    const std::size_t i = static_cast<std::size_t>(op);
+    bump(block.timed[i], 1);
+    bump(block.sumNanos[i], nanos);
+    bump(block.buckets[i][bucketOf(nanos)], 1);
+    if (nanos > block.maxNanos[i].load(std::memory_order_relaxed))
+        block.maxNanos[i].store(nanos, std::memory_order_relaxed);
+
+    std::uint32_t period = 1;
+    while (period < kMaxSamplePeriod && static_cast<std::uint64_t>(period) * nanos < kTimingBudget)
+        period *= 2;
+    block.sampleMask[i] = period - 1;
+}
+
+// Below 16 ns a bucket per nanosecond; from there the top four bits of the
+// value pick the bucket, eight per power of two.
+std::size_t Metrics::bucketOf(std::uint64_t nanos) {
+    const std::uint64_t subBuckets = 1ull << kSubBucketBits;
+    if (nanos < 2 * subBuckets)
+        return static_cast<std::size_t>(nanos);
+
+    nanos = std::min<std::uint64_t>(nanos, (1ull << kMaxExponent) - 1);
+    unsigned exponent = 0;
+    while ((nanos >> (exponent + 1)) != 0)
+        exponent++;
+
+    const std::uint64_t sub = (nanos >> (exponent - kSubBucketBits)) & (subBuckets - 1);
+    return static_cast<std::size_t>(((exponent - kSubBucketBits + 1) << kSubBucketBits) + sub);
+}
+
+std::uint64_t Metrics::lowerBound(std::size_t bucket) {
+    const std::uint64_t subBuckets = 1ull << kSubBucketBits;
+    if (bucket < 2 * subBuckets)
+        return bucket;
+
+    const unsigned exponent = static_cast<unsigned>(bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    const std::uint64_t sub = bucket & (subBuckets - 1);
+    return (subBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+// ===================== REPORTS =====================
+
+json Metrics::toJson() {
+    json j;
+    j["enabled"] = enabled();
+    j["uptimeSeconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - registry().started).count();
+    j["operations"] = json::array();
+
+    const std::vector<Totals> totals = collect();
+    for (std::size_t op = 0; op < kOps; op++) {
+        const Totals& t = totals[op];
+        if (t.calls == 0)
+            continue;
+
+        json row;
+        row["operation"] = kNames[op];
+        row["calls"] = t.calls;
+        row["timed"] = t.timed;
+        row["meanUs"] = t.timed ? static_cast<double>(t.sumNanos) / static_cast<double>(t.timed) / 1000.0 : 0.0;
+        row["p50Us"] = percentileMicros(t, 0.50);
+        row["p90Us"] = percentileMicros(t, 0.90);
+        row["p99Us"] = percentileMicros(t, 0.99);
+        row["p999Us"] = percentileMicros(t, 0.999);
+        row["maxUs"] = static_cast<double>(t.maxNanos) / 1000.0;
+        j["operations"].push_back(std::move(row));
+    }
+    return j;
+}
+
+std::string Metrics::toPrometheus() {
+    const std::vector<Totals> totals = collect();
+    std::ostringstream out;
+
+    out << "# HELP techwarehouse_operations_total Inventory operations called.\n"
+        << "# TYPE techwarehouse_operations_total counter\n";
+    for (std::size_t op = 0; op < kOps; op++)
+        out << "techwarehouse_operations_total{operation=\"" << kNames[op] << "\"} " << totals[op].calls << "\n";
+
+    // Bucket bounds fall on bucket edges: 2^10 ns, 2^12 ns, ... 2^36 ns.
+    out << "# HELP techwarehouse_operation_duration_seconds Latency of the timed Inventory operations.\n"
+        << "# TYPE techwarehouse_operation_duration_seconds histogram\n";
+    for (std::size_t op = 0; op < kOps; op++) {
+        const Totals& t = totals[op];
+        std::uint64_t cumulative = 0;
+        std::size_t next = 0;
+
+        for (unsigned exponent = 10; exponent <= 36; exponent += 2) {
+            const std::uint64_t bound = 1ull << exponent;
+            const std::size_t end = bucketOf(bound);
+            for (; next < end; next++)
+                cumulative += t.buckets[next];
+            out << "techwarehouse_operation_duration_seconds_bucket{operation=\"" << kNames[op]
+                << "\",le=\"" << static_cast<double>(bound) / 1e9 << "\"} " << cumulative << "\n";
+        }
+        out << "techwarehouse_operation_duration_seconds_bucket{operation=\"" << kNames[op]
+            << "\",le=\"+Inf\"} " << t.timed << "\n";
+        out << "techwarehouse_operation_duration_seconds_sum{operation=\"" << kNames[op] << "\"} "
+            << static_cast<double>(t.sumNanos) / 1e9 << "\n";
+        out << "techwarehouse_operation_duration_seconds_count{operation=\"" << kNames[op] << "\"} "
+            << t.timed << "\n";
+    }
+    return out.str();
+}
+
+bool Metrics::writePrometheus(const std::string& file) {
+    const std::string text = toPrometheus();
+    {
+        std::ofstream out(file + ".tmp", std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return false;
+        out << text;
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(file + ".tmp", file, ec);
+    return !ec;
+}
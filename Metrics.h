@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// Define TW_METRICS as 0 to compile the instrumentation out: Metrics::Scope
+// becomes an empty object and nothing is counted or timed.
+#ifndef TW_METRICS
+#define TW_METRICS 1
+#endif
+
+// The public Inventory operations that are counted and timed.
+enum class InventoryOp : std::uint8_t {
+    AddProduct,
+    SerialExists,
+    FindBySerial,
+    GetAllProducts,
+    ReadProducts,
+    SearchByName,
+    ListByCategory,
+    ForEachProduct,
+    ForEachInCategory,
+    Query,
+    CountMatching,
+    RemoveProduct,
+    UpdateProductFromJson,
+    ReplaceProduct,
+    CanStockIn,
+    CanStockOut,
+    StockIn,
+    StockOut,
+    ApplyBatch,
+    GetStockValue,
+    GetTotalUnits,
+    CountLowStock,
+    GetPriceRange,
+    FindByPriceRange,
+    CountByPriceRange,
+    FindByQuantityRange,
+    CountByQuantityRange,
+    LowestStock,
+    TopByPrice,
+    LoadFromFile,
+    SaveToFile,
+    LoadSnapshot,
+    SaveSnapshot,
+    Checkpoint,
+    MemoryUsage,
+    Count
+};
+
+// Per-thread call counters and log-bucketed latency histograms. Each thread
+// records into its own block with plain relaxed stores, so recording takes
+// no lock and shares no cache line; reports add the blocks up. A block
+// outlives its thread and is handed to the next thread that starts
+// recording, so nothing counted is lost.
+//
+// Latencies land in HDR-style buckets: exact below 16 ns, then eight per
+// power of two (12.5% wide) up to 2^40 ns. Every call is counted, but the
+// clock is read only on sampled calls: each operation's last timed call sets
+// how often it is timed from then on, every call when it takes longer than
+// kTimingBudget and proportionally fewer when faster, so the clock reads stay
+// around 1% of the operation's own cost.
+class Metrics {
+public:
+    static constexpr std::size_t kOps = static_cast<std::size_t>(InventoryOp::Count);
+    static constexpr unsigned kSubBucketBits = 3;
+    static constexpr unsigned kMaxExponent = 40;
+    static constexpr std::size_t kBuckets = (kMaxExponent - 2) << kSubBucketBits;
+    // A timed call costs two clock reads, taken as 80 ns; calls slower than
+    // 100 times that are always timed.
+    static constexpr std::uint64_t kTimingBudget = 8000;
+    static constexpr std::uint32_t kMaxSamplePeriod = 256;
+
+    static bool enabled();
+    static const char* name(InventoryOp op);
+
+    // {"enabled", "uptimeSeconds", "operations": [{"operation", "calls",
+    // "timed", "meanUs", "p50Us", "p90Us", "p99Us", "p999Us", "maxUs"}]},
+    // listing the operations called at least once.
+    static nlohmann::json toJson();
+    // Prometheus text exposition: a calls counter and a latency histogram
+    // (power-of-four buckets from 1 us) per operation.
+    static std::string toPrometheus();
+    // Through a temporary file and a rename, so a scraper never reads half.
+    static bool writePrometheus(const std::string& file);
+
+    static std::size_t bucketOf(std::uint64_t nanos);
+    // Smallest latency in the bucket; lowerBound(kBuckets) is the end of the last.
+    static std::uint64_t lowerBound(std::size_t bucket);
+
+    struct alignas(64) Block {
+        std::atomic<std::uint64_t> calls[kOps];
+        std::atomic<std::uint64_t> timed[kOps];
+        std::atomic<std::uint64_t> sumNanos[kOps];
+        std::atomic<std::uint64_t> maxNanos[kOps];
+        std::atomic<std::uint64_t> buckets[kOps][kBuckets];
+        std::uint32_t sampleMask[kOps];     // owner only: timed when (calls & mask) == 0
+        std::atomic<bool> inUse;
+    };
+
+    // This thread's block; attached on first use.
+    static Block& local() {
+        thread_local BlockLease lease;
+        if (!lease.block)
+            lease.block = attach();
+        return *lease.block;
+    }
+
+    static void record(Block& block, InventoryOp op, std::uint64_t nanos);
+
+#if TW_METRICS
+    // Counts one call of `op` and, when sampled, times it until destruction.
+    class Scope {
+    public:
+        // Only the owning thread writes its block, so an increment is a
+        // relaxed load and store rather than an atomic read-modify-write.
+        explicit Scope(InventoryOp op) : block(local()), op(op) {
+            auto& calls = block.calls[static_cast<std::size_t>(op)];
+            const std::uint64_t n = calls.load(std::memory_order_relaxed);
+            calls.store(n + 1, std::memory_order_relaxed);
+            if ((n & block.sampleMask[static_cast<std::size_t>(op)]) == 0) {
+                timed = true;
+                started = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~Scope() {
+            if (!timed)
+                return;
+            auto elapsed = std::chrono::steady_clock::now() - started;
+            record(block, op, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Block& block;
+        InventoryOp op;
+        bool timed = false;
+        std::chrono::steady_clock::time_point started;
+    };
+#else
+    class Scope {
+    public:
+        explicit Scope(InventoryOp) {}
+    };
+#endif
+
+private:
+    struct BlockLease {
+        Block* block = nullptr;
+        ~BlockLease() {
+            if (block)
+                block->inUse.store(false, std::memory_order_release);
+        }
+    };
+
+    static Block* attach();
+};
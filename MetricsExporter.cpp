@@ -0,0 +1,43 @@
+#include "MetricsExporter.h"
+
+#include "Metrics.h"
+
+MetricsExporter::MetricsExporter(const std::string& file, std::chrono::seconds interval)
+    : file(file), interval(interval), stopping(false) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::start() {
+    if (worker.joinable())
+        return;
+
+    stopping = false;
+    worker = std::thread(&MetricsExporter::run, this);
+}
+
+void MetricsExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    if (worker.joinable()) {
+        worker.join();
+        Metrics::writePrometheus(file);
+    }
+}
+
+void MetricsExporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        lock.unlock();
+        Metrics::writePrometheus(file);
+        lock.lock();
+
+        wake.wait_for(lock, interval, [this] { return stopping; });
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Background thread that rewrites a Prometheus text-exposition file with the
+// current Metrics every interval, for a node_exporter textfile collector or
+// anything else that scrapes files. stop() writes it one last time.
+class MetricsExporter {
+public:
+    MetricsExporter(const std::string& file, std::chrono::seconds interval);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void start();
+    void stop();
+
+private:
+    std::string file;
+    std::chrono::seconds interval;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool stopping;
+
+    void run();
+};
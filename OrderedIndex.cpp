@@ -0,0 +1,349 @@
+#include "OrderedIndex.h"
+
+#include <algorithm>
+
+#include "Product.h"
+
+namespace {
+    // Entries per leaf and children per inner node.
+    constexpr std::size_t kCapacity = 64;
+    // A node below this borrows from or merges with a sibling.
+    constexpr std::size_t kMinFill = kCapacity / 4;
+    // Bulk builds leave room so the first inserts do not split every node.
+    constexpr std::size_t kBuildFill = kCapacity * 3 / 4;
+}
+
+// Leaves keep their entries sorted; inner nodes keep, in `entries`, the
+// smallest key under each child, so both kinds answer min() the same way.
+struct OrderedIndex::Node {
+    bool leaf = true;
+    std::size_t total = 0;
+    std::vector<Entry> entries;
+    std::vector<std::unique_ptr<Node>> children;
+    Node* prev = nullptr;
+    Node* next = nullptr;
+
+    std::size_t size() const { return leaf ? entries.size() : children.size(); }
+    const Entry& min() const { return entries.front(); }
+
+    // Child whose key range holds `entry`.
+    std::size_t route(const Entry& entry) const {
+        auto it = std::upper_bound(entries.begin() + 1, entries.end(), entry, OrderedIndex::less);
+        return static_cast<std::size_t>(it - entries.begin()) - 1;
+    }
+
+    // Last child whose smallest value is below `value` (or at most `value`
+    // when inclusive); 0 if there is none.
+    std::size_t routeValue(double value, bool inclusive) const {
+        auto it = std::partition_point(entries.begin() + 1, entries.end(), [&](const Entry& e) {
+            return inclusive ? e.value <= value : e.value < value;
+        });
+        return static_cast<std::size_t>(it - entries.begin()) - 1;
+    }
+
+    // Leaf position of the first entry above `value` (at or above when not inclusive).
+    std::size_t boundValue(double value, bool inclusive) const {
+        auto it = std::partition_point(entries.begin(), entries.end(), [&](const Entry& e) {
+            return inclusive ? e.value <= value : e.value < value;
+        });
+        return static_cast<std::size_t>(it - entries.begin());
+    }
+};
+
+OrderedIndex::OrderedIndex() = default;
+OrderedIndex::~OrderedIndex() = default;
+
+bool OrderedIndex::less(const Entry& a, const Entry& b) {
+    if (a.value != b.value)
+        return a.value < b.value;
+    return a.product->getSerialNumber() < b.product->getSerialNumber();
+}
+
+std::size_t OrderedIndex::size() const {
+    return root ? root->total : 0;
+}
+
+std::size_t OrderedIndex::bytes() const {
+    if (!root)
+        return 0;
+
+    std::size_t used = 0;
+    std::vector<const Node*> pending{ root.get() };
+    while (!pending.empty()) {
+        const Node* node = pending.back();
+        pending.pop_back();
+        used += sizeof(Node) + node->entries.capacity() * sizeof(Entry) + node->children.capacity() * sizeof(std::unique_ptr<Node>);
+        for (const auto& child : node->children)
+            pending.push_back(child.get());
+    }
+    return used;
+}
+
+void OrderedIndex::clear() {
+    root.reset();
+}
+
+// ===================== INSERT =====================
+
+void OrderedIndex::insert(double value, const Product* product) {
+    if (!root)
+        root = std::make_unique<Node>();
+
+    std::unique_ptr<Node> split = insertInto(*root, Entry{ value, product });
+    if (!split)
+        return;
+
+    auto grown = std::make_unique<Node>();
+    grown->leaf = false;
+    grown->total = root->total + split->total;
+    grown->entries = { root->min(), split->min() };
+    grown->children.push_back(std::move(root));
+    grown->children.push_back(std::move(split));
+    root = std::move(grown);
+}
+
+// Returns the new right sibling when `node` overflows and splits.
+std::unique_ptr<OrderedIndex::Node> OrderedIndex::insertInto(Node& node, const Entry& entry) {
+    if (node.leaf) {
+        node.entries.insert(std::lower_bound(node.entries.begin(), node.entries.end(), entry, less), entry);
+        node.total++;
+        if (node.entries.size() <= kCapacity)
+            return nullptr;
+
+        auto sibling = std::make_unique<Node>();
+        std::size_t half = node.entries.size() / 2;
+        sibling->entries.assign(node.entries.begin() + static_cast<std::ptrdiff_t>(half), node.entries.end());
+        node.entries.resize(half);
+        node.total = node.entries.size();
+        sibling->total = sibling->entries.size();
+
+        sibling->next = node.next;
+        sibling->prev = &node;
+        if (node.next)
+            node.next->prev = sibling.get();
+        node.next = sibling.get();
+        return sibling;
+    }
+
+    std::size_t i = node.route(entry);
+    std::unique_ptr<Node> split = insertInto(*node.children[i], entry);
+    node.entries[i] = node.children[i]->min();
+    node.total++;
+
+    if (split) {
+        node.entries.insert(node.entries.begin() + static_cast<std::ptrdiff_t>(i) + 1, split->min());
+        node.children.insert(node.children.begin() + static_cast<std::ptrdiff_t>(i) + 1, std::move(split));
+    }
+    if (node.children.size() <= kCapacity)
+        return nullptr;
+
+    auto sibling = std::make_unique<Node>();
+    sibling->leaf = false;
+    std::size_t half = node.children.size() / 2;
+    for (std::size_t c = half; c < node.children.size(); c++) {
+        sibling->total += node.children[c]->total;
+        sibling->children.push_back(std::move(node.children[c]));
+    }
+    sibling->entries.assign(node.entries.begin() + static_cast<std::ptrdiff_t>(half), node.entries.end());
+    node.children.resize(half);
+    node.entries.resize(half);
+    node.total -= sibling->total;
+    return sibling;
+}
+
+// ===================== ERASE =====================
+
+bool OrderedIndex::erase(double value, const Product* product) {
+    if (!root)
+        return false;
+
+    if (!eraseFrom(*root, Entry{ value, product }))
+        return false;
+
+    if (!root->leaf && root->children.size() == 1) {
+        std::unique_ptr<Node> only = std::move(root->children.front());
+        root = std::move(only);
+    }
+    return true;
+}
+
+bool OrderedIndex::eraseFrom(Node& node, const Entry& entry) {
+    if (node.leaf) {
+        auto it = std::lower_bound(node.entries.begin(), node.entries.end(), entry, less);
+        if (it == node.entries.end() || less(entry, *it))
+            return false;
+        node.entries.erase(it);
+        node.total--;
+        return true;
+    }
+
+    std::size_t i = node.route(entry);
+    Node& child = *node.children[i];
+    if (!eraseFrom(child, entry))
+        return false;
+
+    node.total--;
+    if (child.size() > 0)
+        node.entries[i] = child.min();
+    if (child.size() < kMinFill && node.children.size() > 1)
+        rebalance(node, i);
+    return true;
+}
+
+// Merges the underfull child with a neighbour when both fit in one node,
+// otherwise moves one entry (or child) across to it.
+void OrderedIndex::rebalance(Node& parent, std::size_t child) {
+    std::size_t left = child > 0 ? child - 1 : child;
+    std::size_t right = left + 1;
+    Node& a = *parent.children[left];
+    Node& b = *parent.children[right];
+
+    if (a.size() + b.size() <= kCapacity) {
+        a.entries.insert(a.entries.end(), b.entries.begin(), b.entries.end());
+        for (auto& moved : b.children)
+            a.children.push_back(std::move(moved));
+        a.total += b.total;
+
+        if (a.leaf) {
+            a.next = b.next;
+            if (b.next)
+                b.next->prev = &a;
+        }
+
+        parent.entries.erase(parent.entries.begin() + static_cast<std::ptrdiff_t>(right));
+        parent.children.erase(parent.children.begin() + static_cast<std::ptrdiff_t>(right));
+        if (a.size() > 0)
+            parent.entries[left] = a.min();
+        return;
+    }
+
+    if (a.size() < b.size()) {
+        a.entries.push_back(b.entries.front());
+        b.entries.erase(b.entries.begin());
+        std::size_t moved = 1;
+        if (!a.leaf) {
+            moved = b.children.front()->total;
+            a.children.push_back(std::move(b.children.front()));
+            b.children.erase(b.children.begin());
+        }
+        a.total += moved;
+        b.total -= moved;
+    }
+    else {
+        b.entries.insert(b.entries.begin(), a.entries.back());
+        a.entries.pop_back();
+        std::size_t moved = 1;
+        if (!a.leaf) {
+            moved = a.children.back()->total;
+            b.children.insert(b.children.begin(), std::move(a.children.back()));
+            a.children.pop_back();
+        }
+        a.total -= moved;
+        b.total += moved;
+    }
+    parent.entries[left] = a.min();
+    parent.entries[right] = b.min();
+}
+
+// ===================== BULK BUILD =====================
+
+void OrderedIndex::assign(std::vector<Entry> entries) {
+    root.reset();
+    if (entries.empty())
+        return;
+
+    std::sort(entries.begin(), entries.end(), less);
+
+    // Spreading the items evenly keeps every node at least kBuildFill / 2 full.
+    auto groups = [](std::size_t items) { return (items + kBuildFill - 1) / kBuildFill; };
+
+    std::vector<std::unique_ptr<Node>> level;
+    std::size_t leaves = groups(entries.size());
+    level.reserve(leaves);
+    for (std::size_t k = 0; k < leaves; k++) {
+        auto leaf = std::make_unique<Node>();
+        std::size_t begin = entries.size() * k / leaves;
+        std::size_t end = entries.size() * (k + 1) / leaves;
+        leaf->entries.assign(entries.begin() + static_cast<std::ptrdiff_t>(begin), entries.begin() + static_cast<std::ptrdiff_t>(end));
+        leaf->total = end - begin;
+        if (!level.empty()) {
+            leaf->prev = level.back().get();
+            level.back()->next = leaf.get();
+        }
+        level.push_back(std::move(leaf));
+    }
+
+    while (level.size() > 1) {
+        std::vector<std::unique_ptr<Node>> parents;
+        std::size_t count = groups(level.size());
+        parents.reserve(count);
+        for (std::size_t k = 0; k < count; k++) {
+            auto inner = std::make_unique<Node>();
+            inner->leaf = false;
+            std::size_t begin = level.size() * k / count;
+            std::size_t end = level.size() * (k + 1) / count;
+            for (std::size_t c = begin; c < end; c++) {
+                inner->total += level[c]->total;
+                inner->entries.push_back(level[c]->min());
+                inner->children.push_back(std::move(level[c]));
+            }
+            parents.push_back(std::move(inner));
+        }
+        level = std::move(parents);
+    }
+    root = std::move(level.front());
+}
+
+// ===================== QUERIES =====================
+
+std::size_t OrderedIndex::countBelow(double value, bool inclusive) const {
+    std::size_t below = 0;
+    const Node* node = root.get();
+    while (node && !node->leaf) {
+        std::size_t i = node->routeValue(value, inclusive);
+        for (std::size_t c = 0; c < i; c++)
+            below += node->children[c]->total;
+        node = node->children[i].get();
+    }
+    if (node)
+        below += node->boundValue(value, inclusive);
+    return below;
+}
+
+std::size_t OrderedIndex::count(double low, double high) const {
+    if (!(low <= high))
+        return 0;
+    return countBelow(high, true) - countBelow(low, false);
+}
+
+void OrderedIndex::scan(double low, double high, bool descending, const std::function<bool(const Entry&)>& visit) const {
+    if (!root || !(low <= high))
+        return;
+
+    // Descend to the leaf holding the first entry of the walk.
+    const double start = descending ? high : low;
+    const Node* node = root.get();
+    while (!node->leaf)
+        node = node->children[node->routeValue(start, descending)].get();
+
+    if (!descending) {
+        std::size_t at = node->boundValue(low, false);
+        for (; node; node = node->next, at = 0) {
+            for (; at < node->entries.size(); at++) {
+                const Entry& e = node->entries[at];
+                if (e.value > high || !visit(e))
+                    return;
+            }
+        }
+        return;
+    }
+
+    std::size_t end = node->boundValue(high, true);
+    for (; node; node = node->prev, end = node ? node->entries.size() : 0) {
+        while (end > 0) {
+            const Entry& e = node->entries[--end];
+            if (e.value < low || !visit(e))
+                return;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Product;
+
+// Order-statistic B+-tree over (value, serial) keys, one entry per product.
+// Every inner node knows how many entries lie under each child, so counting
+// a value range is two root-to-leaf descents, and leaves are linked both
+// ways, so walking k entries from any starting key costs O(log n + k).
+// Keys are unique because serials are; the product must not change its
+// serial while it is indexed.
+class OrderedIndex {
+public:
+    struct Entry {
+        double value;
+        const Product* product;
+    };
+
+    OrderedIndex();
+    ~OrderedIndex();
+
+    OrderedIndex(const OrderedIndex&) = delete;
+    OrderedIndex& operator=(const OrderedIndex&) = delete;
+
+    void insert(double value, const Product* product);
+    // False when no entry has this value and the product's serial.
+    bool erase(double value, const Product* product);
+
+    void clear();
+    // Replaces the contents in one sort and a bottom-up build.
+    void assign(std::vector<Entry> entries);
+    std::size_t size() const;
+    // Heap bytes held by the tree's nodes.
+    std::size_t bytes() const;
+
+    // Entries with low <= value <= high.
+    std::size_t count(double low, double high) const;
+
+    // Calls visit(entry) for entries with low <= value <= high in key order
+    // (reversed when `descending`) until it returns false.
+    void scan(double low, double high, bool descending, const std::function<bool(const Entry&)>& visit) const;
+
+private:
+    struct Node;
+
+    std::unique_ptr<Node> root;
+
+    static bool less(const Entry& a, const Entry& b);
+
+    std::size_t countBelow(double value, bool inclusive) const;
+    std::unique_ptr<Node> insertInto(Node& node, const Entry& entry);
+    bool eraseFrom(Node& node, const Entry& entry);
+    void rebalance(Node& parent, std::size_t child);
+};
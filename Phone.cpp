@@ -16,6 +16,22 @@ Phone::Phone(
       storageGB(storageGB),
       has5G(has5G) {}
 
+const std::string& Phone::getCpu() const {
+    return cpu.str();
+}
+
+const InternedString& Phone::getInternedCpu() const {
+    return cpu;
+}
+
+int Phone::getStorageGB() const {
+    return storageGB;
+}
+
+bool Phone::supports5G() const {
+    return has5G;
+}
+
 std::string Phone::getType() const {
     return "Phone";
 }
@@ -25,11 +41,11 @@ nlohmann::json Phone::toJson() const {
         {"type", getType()},
         {"serialNumber", serialNumber},
         {"name", name},
-        {"brand", brand},
+        {"brand", brand.str()},
         {"price", price},
-        {"quantity", quantity},
+        {"quantity", getQuantity()},
         {"categoryId", categoryId},
-        {"cpu", cpu},
+        {"cpu", cpu.str()},
         {"storageGB", storageGB},
         {"has5G", has5G}
     };
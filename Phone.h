@@ -5,7 +5,7 @@
 
 class Phone : public Product {
 private:
-    std::string cpu;
+    InternedString cpu;
     int storageGB;
     bool has5G;
 
@@ -22,6 +22,11 @@ public:
         bool has5G
     );
 
+    const std::string& getCpu() const;
+    const InternedString& getInternedCpu() const;
+    int getStorageGB() const;
+    bool supports5G() const;
+
     std::string getType() const override;
     nlohmann::json toJson() const override;
 
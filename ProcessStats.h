@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// Resident memory of the current process, as reported by the OS.
+class ProcessStats {
+public:
+    // Largest resident set so far; 0 if the platform cannot tell.
+    static std::uint64_t peakRssBytes();
+    static std::uint64_t currentRssBytes();
+};
@@ -1,5 +1,7 @@
 #include "Product.h"
 
+#include <climits>
+
 Product::Product(
     const std::string& serialNumber,
     const std::string& name,
@@ -16,40 +18,109 @@ Product::Product(
     categoryId(categoryId) {
 }
 
+Product::Product(const Product& other)
+    : serialNumber(other.serialNumber),
+    name(other.name),
+    brand(other.brand),
+    price(other.price),
+    quantity(other.getQuantity()),
+    categoryId(other.categoryId) {
+}
+
+Product& Product::operator=(const Product& other) {
+    serialNumber = other.serialNumber;
+    name = other.name;
+    brand = other.brand;
+    price = other.price;
+    quantity.store(other.getQuantity(), std::memory_order_relaxed);
+    categoryId = other.categoryId;
+    return *this;
+}
+
+Product::Product(Product&& other) noexcept
+    : serialNumber(std::move(other.serialNumber)),
+    name(std::move(other.name)),
+    brand(std::move(other.brand)),
+    price(other.price),
+    quantity(other.getQuantity()),
+    categoryId(other.categoryId) {
+}
+
+Product& Product::operator=(Product&& other) noexcept {
+    serialNumber = std::move(other.serialNumber);
+    name = std::move(other.name);
+    brand = std::move(other.brand);
+    price = other.price;
+    quantity.store(other.getQuantity(), std::memory_order_relaxed);
+    categoryId = other.categoryId;
+    return *this;
+}
+
 const std::string& Product::getSerialNumber() const { return serialNumber; }
 const std::string& Product::getName() const { return name; }
-const std::string& Product::getBrand() const { return brand; }
+const std::string& Product::getBrand() const { return brand.str(); }
+const InternedString& Product::getInternedBrand() const { return brand; }
 double Product::getPrice() const { return price; }
-int Product::getQuantity() const { return quantity; }
+int Product::getQuantity() const { return quantity.load(std::memory_order_relaxed); }
 int Product::getCategoryId() const { return categoryId; }
 
 
-void Product::setName(const std::string& newName) {
+bool Product::setName(const std::string& newName) {
+    if (isAttached())
+        return false;
     name = newName;
+    return true;
 }
 
-void Product::setBrand(const std::string& newBrand) {
+bool Product::setBrand(const std::string& newBrand) {
+    if (isAttached())
+        return false;
     brand = newBrand;
+    return true;
 }
 
-void Product::setPrice(double newPrice) {
-    if (newPrice >= 0)
-        price = newPrice;
+bool Product::setPrice(double newPrice) {
+    if (newPrice < 0 || isAttached())
+        return false;
+    price = newPrice;
+    return true;
 }
 
-void Product::setQuantity(int newQuantity) {
-    if (newQuantity >= 0)
-        quantity = newQuantity;
+bool Product::setQuantity(int newQuantity) {
+    if (newQuantity < 0 || isAttached())
+        return false;
+    quantity.store(newQuantity, std::memory_order_relaxed);
+    return true;
 }
 
-void Product::increaseQuantity(int amount) {
-    if (amount > 0)
-        quantity += amount;
+bool Product::increaseQuantity(int amount) {
+    if (amount <= 0)
+        return false;
+
+    int current = quantity.load(std::memory_order_relaxed);
+    do {
+        if (current > INT_MAX - amount)
+            return false;
+    } while (!quantity.compare_exchange_weak(current, current + amount, std::memory_order_relaxed));
+    return true;
 }
 
 bool Product::decreaseQuantity(int amount) {
-    if (amount <= 0 || amount > quantity)
+    if (amount <= 0)
         return false;
-    quantity -= amount;
+
+    int current = quantity.load(std::memory_order_relaxed);
+    do {
+        if (amount > current)
+            return false;
+    } while (!quantity.compare_exchange_weak(current, current - amount, std::memory_order_relaxed));
     return true;
 }
+
+void Product::setAttached(bool held) {
+    attached.store(held, std::memory_order_release);
+}
+
+bool Product::isAttached() const {
+    return attached.load(std::memory_order_acquire);
+}
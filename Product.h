@@ -1,15 +1,23 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <nlohmann/json.hpp>
 
+#include "StringInterner.h"
+
 class Product {
+private:
+    // Set and cleared by the owning inventory while other threads may be
+    // in a setter.
+    std::atomic<bool> attached{ false };
+
 protected:
     std::string serialNumber;
     std::string name;
-    std::string brand;
+    InternedString brand;
     double price;
-    int quantity;
+    std::atomic<int> quantity;
     int categoryId;
 
 public:
@@ -22,25 +30,46 @@ public:
         int categoryId
     );
 
+    // A copy is not attached to any inventory.
+    Product(const Product& other);
+    Product& operator=(const Product& other);
+    Product(Product&& other) noexcept;
+    Product& operator=(Product&& other) noexcept;
+
     virtual ~Product() = default;
 
-    
+
     const std::string& getSerialNumber() const;
     const std::string& getName() const;
     const std::string& getBrand() const;
+    // Equal brands give equal handles: filter with == instead of string compares.
+    const InternedString& getInternedBrand() const;
     double getPrice() const;
     int getQuantity() const;
     int getCategoryId() const;
 
       
-    void setName(const std::string& name);
-    void setBrand(const std::string& brand);
-    void setPrice(double price);
-    void setQuantity(int quantity);
+    // A product held by an inventory is shared with its indexes, journal
+    // and snapshots, so it is never changed in place: the setters return
+    // false for it (and for a negative price or quantity). Change it through
+    // Inventory::updateProductFromJson or replaceProduct, which journal the
+    // change and swap in a new copy.
+    bool setName(const std::string& name);
+    bool setBrand(const std::string& brand);
+    bool setPrice(double price);
+    bool setQuantity(int quantity);
 
-    void increaseQuantity(int amount);
+    // Safe to call from several threads at once. Both refuse a change that
+    // would take the quantity below zero or past INT_MAX. They work on held
+    // products too: they are for the owning inventory, which holds its lock,
+    // journals the movement and updates its indexes around them.
+    bool increaseQuantity(int amount);
     bool decreaseQuantity(int amount);
 
+    // Set by the inventory that holds the product.
+    void setAttached(bool attached);
+    bool isAttached() const;
+
     virtual std::string getType() const = 0;
     virtual nlohmann::json toJson() const = 0;
 };
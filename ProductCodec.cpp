@@ -0,0 +1,212 @@
+#include "ProductCodec.h"
+
+#include <cstring>
+
+#include "Laptop.h"
+#include "Phone.h"
+#include "DesktopComputer.h"
+#include "ProductStore.h"
+
+namespace {
+    enum ProductTag : std::uint8_t {
+        LaptopTag = 1,
+        PhoneTag = 2,
+        DesktopTag = 3
+    };
+
+    std::uint64_t loadLe(const unsigned char* p, int bytes) {
+        std::uint64_t v = 0;
+        for (int i = bytes - 1; i >= 0; i--)
+            v = (v << 8) | p[i];
+        return v;
+    }
+}
+
+// ===================== WRITER =====================
+
+BinaryWriter::BinaryWriter(std::string& out)
+    : out(out) {
+}
+
+void BinaryWriter::u8(std::uint8_t v) {
+    out.push_back(static_cast<char>(v));
+}
+
+void BinaryWriter::u32(std::uint32_t v) {
+    char b[4];
+    for (int i = 0; i < 4; i++)
+        b[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    out.append(b, 4);
+}
+
+void BinaryWriter::u64(std::uint64_t v) {
+    char b[8];
+    for (int i = 0; i < 8; i++)
+        b[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    out.append(b, 8);
+}
+
+void BinaryWriter::i32(std::int32_t v) {
+    u32(static_cast<std::uint32_t>(v));
+}
+
+void BinaryWriter::f64(double v) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    u64(bits);
+}
+
+void BinaryWriter::str(std::string_view v) {
+    u32(static_cast<std::uint32_t>(v.size()));
+    out.append(v.data(), v.size());
+}
+
+// ===================== READER =====================
+
+BinaryReader::BinaryReader(const char* data, std::size_t size)
+    : cursor(data), end(data + size) {
+}
+
+bool BinaryReader::take(void* dst, std::size_t n) {
+    if (static_cast<std::size_t>(end - cursor) < n)
+        return false;
+    std::memcpy(dst, cursor, n);
+    cursor += n;
+    return true;
+}
+
+bool BinaryReader::u8(std::uint8_t& v) {
+    return take(&v, 1);
+}
+
+bool BinaryReader::u32(std::uint32_t& v) {
+    unsigned char b[4];
+    if (!take(b, 4))
+        return false;
+    v = static_cast<std::uint32_t>(loadLe(b, 4));
+    return true;
+}
+
+bool BinaryReader::u64(std::uint64_t& v) {
+    unsigned char b[8];
+    if (!take(b, 8))
+        return false;
+    v = loadLe(b, 8);
+    return true;
+}
+
+bool BinaryReader::i32(std::int32_t& v) {
+    std::uint32_t u;
+    if (!u32(u))
+        return false;
+    v = static_cast<std::int32_t>(u);
+    return true;
+}
+
+bool BinaryReader::f64(double& v) {
+    std::uint64_t bits;
+    if (!u64(bits))
+        return false;
+    std::memcpy(&v, &bits, sizeof v);
+    return true;
+}
+
+bool BinaryReader::str(std::string& v) {
+    std::uint32_t length;
+    if (!u32(length) || remaining() < length)
+        return false;
+    v.assign(cursor, length);
+    cursor += length;
+    return true;
+}
+
+std::size_t BinaryReader::remaining() const {
+    return static_cast<std::size_t>(end - cursor);
+}
+
+const char* BinaryReader::position() const {
+    return cursor;
+}
+
+// ===================== PRODUCTS =====================
+
+bool ProductCodec::encode(const Product& product, BinaryWriter& out) {
+    return encode(product, product.getQuantity(), out);
+}
+
+bool ProductCodec::encode(const Product& product, int quantity, BinaryWriter& out) {
+    auto common = [&](ProductTag tag) {
+        out.u8(tag);
+        out.str(product.getSerialNumber());
+        out.str(product.getName());
+        out.str(product.getBrand());
+        out.f64(product.getPrice());
+        out.i32(quantity);
+        out.i32(product.getCategoryId());
+    };
+
+    struct Encoder {
+        decltype(common)& head;
+        BinaryWriter& out;
+
+        bool operator()(std::monostate) const { return false; }
+        bool operator()(const Laptop* laptop) const {
+            head(LaptopTag);
+            out.str(laptop->getCpu());
+            out.i32(laptop->getRamGB());
+            out.i32(laptop->getStorageGB());
+            return true;
+        }
+        bool operator()(const Phone* phone) const {
+            head(PhoneTag);
+            out.str(phone->getCpu());
+            out.i32(phone->getStorageGB());
+            out.u8(phone->supports5G() ? 1 : 0);
+            return true;
+        }
+        bool operator()(const DesktopComputer* desktop) const {
+            head(DesktopTag);
+            out.str(desktop->getCpu());
+            out.str(desktop->getGpu());
+            out.i32(desktop->getRamGB());
+            return true;
+        }
+    };
+    return ProductStore::visit(product, Encoder{common, out});
+}
+
+std::shared_ptr<Product> ProductCodec::decode(BinaryReader& in) {
+    std::uint8_t tag;
+    std::string serial, name, brand, cpu;
+    double price;
+    std::int32_t quantity, categoryId;
+
+    if (!in.u8(tag) || !in.str(serial) || !in.str(name) || !in.str(brand) ||
+        !in.f64(price) || !in.i32(quantity) || quantity < 0 || !in.i32(categoryId) || !in.str(cpu))
+        return nullptr;
+
+    if (tag == LaptopTag) {
+        std::int32_t ramGB, storageGB;
+        if (!in.i32(ramGB) || !in.i32(storageGB))
+            return nullptr;
+        return ProductStore::make<Laptop>(serial, name, brand, price, quantity, categoryId, cpu, ramGB, storageGB);
+    }
+
+    if (tag == PhoneTag) {
+        std::int32_t storageGB;
+        std::uint8_t has5G;
+        if (!in.i32(storageGB) || !in.u8(has5G))
+            return nullptr;
+        return ProductStore::make<Phone>(serial, name, brand, price, quantity, categoryId, cpu, storageGB, has5G != 0);
+    }
+
+    if (tag == DesktopTag) {
+        std::string gpu;
+        std::int32_t ramGB;
+        if (!in.str(gpu) || !in.i32(ramGB))
+            return nullptr;
+        return ProductStore::make<DesktopComputer>(serial, name, brand, price, quantity, categoryId, cpu, gpu, ramGB);
+    }
+
+    return nullptr;
+}
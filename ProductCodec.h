@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Product.h"
+
+// Compact binary encoding shared by the snapshot and journal formats.
+// Integers and doubles are fixed-width little-endian, strings are a u32
+// length followed by the bytes. A product record is:
+//
+//   u8  type (1 = Laptop, 2 = Phone, 3 = DesktopComputer)
+//   str serialNumber, str name, str brand
+//   f64 price, i32 quantity, i32 categoryId
+//   str cpu
+//   Laptop:          i32 ramGB, i32 storageGB
+//   Phone:           i32 storageGB, u8 has5G
+//   DesktopComputer: str gpu, i32 ramGB
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out);
+
+    void u8(std::uint8_t v);
+    void u32(std::uint32_t v);
+    void u64(std::uint64_t v);
+    void i32(std::int32_t v);
+    void f64(double v);
+    void str(std::string_view v);
+
+private:
+    std::string& out;
+};
+
+// Bounds-checked reader over a byte range; every accessor returns false
+// once the input is exhausted or malformed.
+class BinaryReader {
+public:
+    BinaryReader(const char* data, std::size_t size);
+
+    bool u8(std::uint8_t& v);
+    bool u32(std::uint32_t& v);
+    bool u64(std::uint64_t& v);
+    bool i32(std::int32_t& v);
+    bool f64(double& v);
+    bool str(std::string& v);
+
+    std::size_t remaining() const;
+    const char* position() const;
+
+private:
+    const char* cursor;
+    const char* end;
+
+    bool take(void* dst, std::size_t n);
+};
+
+class ProductCodec {
+public:
+    static bool encode(const Product& product, BinaryWriter& out);
+    // Same, but records `quantity` instead of the product's current one.
+    static bool encode(const Product& product, int quantity, BinaryWriter& out);
+    static std::shared_ptr<Product> decode(BinaryReader& in);
+};
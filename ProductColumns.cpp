@@ -0,0 +1,95 @@
+#include "ProductColumns.h"
+
+#include "ColumnKernels.h"
+
+void ProductColumns::push(const Product& product) {
+    priceColumn.push_back(product.getPrice());
+    quantityColumn.push_back(product.getQuantity());
+    categoryColumn.push_back(product.getCategoryId());
+}
+
+void ProductColumns::removeAt(std::size_t row) {
+    std::size_t last = size() - 1;
+    if (row != last) {
+        priceColumn[row] = priceColumn[last];
+        quantityColumn[row] = quantityColumn[last];
+        categoryColumn[row] = categoryColumn[last];
+    }
+    priceColumn.pop_back();
+    quantityColumn.pop_back();
+    categoryColumn.pop_back();
+}
+
+void ProductColumns::replaceAt(std::size_t row, const Product& product) {
+    priceColumn[row] = product.getPrice();
+    quantityColumn[row] = product.getQuantity();
+    categoryColumn[row] = product.getCategoryId();
+}
+
+void ProductColumns::setQuantity(std::size_t row, int quantity) {
+    quantityColumn[row] = quantity;
+}
+
+void ProductColumns::clear() {
+    priceColumn.clear();
+    quantityColumn.clear();
+    categoryColumn.clear();
+}
+
+void ProductColumns::reserve(std::size_t count) {
+    priceColumn.reserve(count);
+    quantityColumn.reserve(count);
+    categoryColumn.reserve(count);
+}
+
+std::size_t ProductColumns::size() const {
+    return priceColumn.size();
+}
+
+std::size_t ProductColumns::bytes() const {
+    return priceColumn.capacity() * sizeof(double) +
+        quantityColumn.capacity() * sizeof(std::int32_t) +
+        categoryColumn.capacity() * sizeof(std::int32_t);
+}
+
+const double* ProductColumns::prices() const {
+    return priceColumn.data();
+}
+
+const std::int32_t* ProductColumns::quantities() const {
+    return quantityColumn.data();
+}
+
+const std::int32_t* ProductColumns::categoryIds() const {
+    return categoryColumn.data();
+}
+
+// ===================== AGGREGATES =====================
+
+double ProductColumns::stockValue() const {
+    return ColumnKernels::dot(prices(), quantities(), size());
+}
+
+double ProductColumns::stockValue(int categoryId) const {
+    return ColumnKernels::dotWhere(prices(), quantities(), categoryIds(), size(), categoryId);
+}
+
+std::int64_t ProductColumns::totalUnits() const {
+    return ColumnKernels::sum(quantities(), size());
+}
+
+std::int64_t ProductColumns::totalUnits(int categoryId) const {
+    return ColumnKernels::sumWhere(quantities(), categoryIds(), size(), categoryId);
+}
+
+std::size_t ProductColumns::countBelow(int units) const {
+    return ColumnKernels::countLess(quantities(), size(), units);
+}
+
+std::size_t ProductColumns::countBelow(int units, int categoryId) const {
+    return ColumnKernels::countLessWhere(quantities(), categoryIds(), size(), units, categoryId);
+}
+
+bool ProductColumns::priceRange(double& minPrice, double& maxPrice) const {
+    return ColumnKernels::minMax(prices(), size(), minPrice, maxPrice);
+}
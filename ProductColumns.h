@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Product.h"
+
+// Structure-of-arrays mirror of Inventory's product list: row i holds the
+// price, quantity and category of products[i]. Inventory keeps it in step
+// on every mutation, so aggregates scan three dense arrays instead of
+// chasing a pointer per product.
+class ProductColumns {
+public:
+    void push(const Product& product);
+    // Swap-and-pop, matching Inventory's removal.
+    void removeAt(std::size_t row);
+    void replaceAt(std::size_t row, const Product& product);
+    void setQuantity(std::size_t row, int quantity);
+
+    void clear();
+    void reserve(std::size_t count);
+    std::size_t size() const;
+    std::size_t bytes() const;
+
+    const double* prices() const;
+    const std::int32_t* quantities() const;
+    const std::int32_t* categoryIds() const;
+
+    // ---------- Aggregates ----------
+    double stockValue() const;
+    double stockValue(int categoryId) const;
+    std::int64_t totalUnits() const;
+    std::int64_t totalUnits(int categoryId) const;
+    std::size_t countBelow(int units) const;
+    std::size_t countBelow(int units, int categoryId) const;
+    bool priceRange(double& minPrice, double& maxPrice) const;
+
+private:
+    std::vector<double> priceColumn;
+    std::vector<std::int32_t> quantityColumn;
+    std::vector<std::int32_t> categoryColumn;
+};
@@ -0,0 +1,134 @@
+#include "ProductGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "DesktopComputer.h"
+#include "Laptop.h"
+#include "Phone.h"
+#include "ProductStore.h"
+
+namespace {
+    const char* const kBrands[] = { "Dell", "HP", "Lenovo", "Apple", "Asus", "Acer", "Samsung", "Xiaomi", "MSI", "Google" };
+    const char* const kCpus[] = { "Intel i5-1335U", "Intel i7-1365U", "Intel i9-13900K", "AMD Ryzen 5 7600", "AMD Ryzen 7 7840U",
+        "AMD Ryzen 9 7950X", "Apple M2", "Apple M3", "Snapdragon 8 Gen 2", "Dimensity 9200" };
+    const char* const kGpus[] = { "Intel UHD", "Intel Iris Xe", "NVIDIA RTX 4060", "NVIDIA RTX 4070", "NVIDIA RTX 4090", "AMD RX 7800 XT" };
+    const char* const kModels[] = { "Pro", "Air", "Ultra", "Lite", "Plus", "Max", "Neo", "Edge", "Prime", "Studio" };
+    const int kRam[] = { 8, 16, 32, 64 };
+    const int kStorage[] = { 128, 256, 512, 1024, 2048 };
+
+    template <typename T, std::size_t N>
+    const T& pick(const T (&values)[N], std::uint64_t r) {
+        return values[r % N];
+    }
+
+    // SplitMix64 finaliser: a cheap, well-mixed hash.
+    std::uint64_t mix64(std::uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Top 53 bits as a double in [0, 1).
+    double unit(std::uint64_t r) {
+        return static_cast<double>(r >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    template <std::size_t N>
+    WeightedValues fromList(const char* const (&values)[N], double skew) {
+        WeightedValues list;
+        for (const char* v : values)
+            list.add(v);
+        list.applySkew(skew);
+        return list;
+    }
+}
+
+// ===================== WEIGHTED VALUES =====================
+
+void WeightedValues::add(const std::string& value, double weight) {
+    if (weight <= 0.0)
+        return;
+    values.push_back(value);
+    cumulative.push_back((cumulative.empty() ? 0.0 : cumulative.back()) + weight);
+}
+
+void WeightedValues::applySkew(double skew) {
+    if (skew <= 0.0)
+        return;
+    double total = 0.0;
+    for (std::size_t i = 0; i < cumulative.size(); i++) {
+        total += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+        cumulative[i] = total;
+    }
+}
+
+const std::string& WeightedValues::pick(std::uint64_t r) const {
+    const double target = unit(r) * cumulative.back();
+    std::size_t i = std::upper_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+    return values[std::min(i, values.size() - 1)];
+}
+
+bool WeightedValues::empty() const {
+    return values.empty();
+}
+
+ProductMix ProductMix::defaults(double skew) {
+    ProductMix mix;
+    mix.brands = fromList(kBrands, skew);
+    mix.cpus = fromList(kCpus, skew);
+    mix.gpus = fromList(kGpus, skew);
+    mix.models = fromList(kModels, skew);
+    return mix;
+}
+
+// ===================== GENERATOR =====================
+
+ProductGenerator::ProductGenerator(std::uint64_t seed, ProductMix mix)
+    : seed(seed), mix(std::move(mix)) {
+    ProductMix fallback = ProductMix::defaults();
+    if (this->mix.brands.empty())
+        this->mix.brands = fallback.brands;
+    if (this->mix.cpus.empty())
+        this->mix.cpus = fallback.cpus;
+    if (this->mix.gpus.empty())
+        this->mix.gpus = fallback.gpus;
+    if (this->mix.models.empty())
+        this->mix.models = fallback.models;
+}
+
+std::string ProductGenerator::serialFor(std::uint64_t index) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "SN%010llu", static_cast<unsigned long long>(index));
+    return buffer;
+}
+
+std::uint64_t ProductGenerator::random(std::uint64_t index, std::uint64_t stream) const {
+    return mix64(seed ^ mix64(index ^ mix64(stream)));
+}
+
+std::shared_ptr<Product> ProductGenerator::make(std::uint64_t index) const {
+    return make(index, serialFor(index));
+}
+
+std::shared_ptr<Product> ProductGenerator::make(std::uint64_t index, const std::string& serial) const {
+    std::uint64_t state = mix64(seed ^ mix64(index));
+    auto next = [&state] { return state = mix64(state); };
+
+    const std::string& brand = mix.brands.pick(next());
+    const std::string name = brand + " " + mix.models.pick(next()) + " " + std::to_string(next() % 1000);
+    const double price = 50.0 + static_cast<double>(next() % 500000) / 100.0;
+    const int quantity = static_cast<int>(next() % 200);
+    const std::string& cpu = mix.cpus.pick(next());
+
+    const double types = mix.laptopWeight + mix.phoneWeight + mix.desktopWeight;
+    const double type = unit(next()) * (types > 0.0 ? types : 1.0);
+
+    if (type < mix.laptopWeight)
+        return ProductStore::make<Laptop>(serial, name, brand, price, quantity, 1, cpu, pick(kRam, next()), pick(kStorage, next()));
+    if (type < mix.laptopWeight + mix.phoneWeight)
+        return ProductStore::make<Phone>(serial, name, brand, price, quantity, 2, cpu, pick(kStorage, next()), next() % 2 == 0);
+    return ProductStore::make<DesktopComputer>(serial, name, brand, price, quantity, 3, cpu, mix.gpus.pick(next()), pick(kRam, next()));
+}
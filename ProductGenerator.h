@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Product.h"
+
+// Values drawn with given relative weights.
+class WeightedValues {
+public:
+    void add(const std::string& value, double weight = 1.0);
+    // Re-weights the values in order by 1 / rank^skew (Zipf); 0 keeps them uniform.
+    void applySkew(double skew);
+
+    // `r` is a uniform 64-bit random number.
+    const std::string& pick(std::uint64_t r) const;
+    bool empty() const;
+
+private:
+    std::vector<std::string> values;
+    std::vector<double> cumulative;
+};
+
+// Distributions a ProductGenerator draws from.
+struct ProductMix {
+    WeightedValues brands;
+    WeightedValues cpus;
+    WeightedValues gpus;
+    WeightedValues models;
+    double laptopWeight = 1.0;
+    double phoneWeight = 1.0;
+    double desktopWeight = 1.0;
+
+    // Built-in lists, each skewed by `skew` (see WeightedValues::applySkew).
+    static ProductMix defaults(double skew = 0.0);
+};
+
+// Synthetic products for benchmarks and sizing. Product i depends only on
+// the seed, the mix and i, so any subset can be generated in any order or
+// in parallel and still match a sequential run.
+class ProductGenerator {
+public:
+    explicit ProductGenerator(std::uint64_t seed = 42, ProductMix mix = ProductMix::defaults());
+
+    std::shared_ptr<Product> make(std::uint64_t index) const;
+    // Same, with another serial number.
+    std::shared_ptr<Product> make(std::uint64_t index, const std::string& serial) const;
+
+    static std::string serialFor(std::uint64_t index);
+
+    // Deterministic 64-bit hash of (seed, index, stream), for callers that
+    // need more per-record randomness of their own.
+    std::uint64_t random(std::uint64_t index, std::uint64_t stream) const;
+
+private:
+    std::uint64_t seed;
+    ProductMix mix;
+};
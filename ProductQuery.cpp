@@ -0,0 +1,626 @@
+#include "ProductQuery.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <typeinfo>
+
+#include "DesktopComputer.h"
+#include "Laptop.h"
+#include "Phone.h"
+
+namespace {
+    // ---------- Lexer ----------
+
+    struct Token {
+        enum class Kind { Word, Text, Op, Open, Close, End };
+
+        Kind kind = Kind::End;
+        std::string value;
+    };
+
+    bool isWordChar(char c) {
+        return !std::isspace(static_cast<unsigned char>(c)) && c != '(' && c != ')' && c != '=' && c != '!'
+            && c != '<' && c != '>' && c != '~' && c != '\'' && c != '"';
+    }
+
+    bool tokenize(const std::string& text, std::vector<Token>& tokens, std::string& error) {
+        std::size_t at = 0;
+        while (true) {
+            while (at < text.size() && std::isspace(static_cast<unsigned char>(text[at])))
+                at++;
+
+            Token token;
+            if (at >= text.size()) {
+                tokens.push_back(token);
+                return true;
+            }
+
+            char c = text[at];
+            if (c == '(' || c == ')') {
+                token.kind = c == '(' ? Token::Kind::Open : Token::Kind::Close;
+                token.value = c;
+                at++;
+            }
+            else if (c == '\'' || c == '"') {
+                std::size_t end = text.find(c, at + 1);
+                if (end == std::string::npos) {
+                    error = "unterminated quoted text";
+                    return false;
+                }
+                token.kind = Token::Kind::Text;
+                token.value = text.substr(at + 1, end - at - 1);
+                at = end + 1;
+            }
+            else if (c == '=' || c == '~') {
+                token.kind = Token::Kind::Op;
+                token.value = c;
+                at++;
+            }
+            else if (c == '!' || c == '<' || c == '>') {
+                token.kind = Token::Kind::Op;
+                token.value = c;
+                at++;
+                if (at < text.size() && text[at] == '=') {
+                    token.value += '=';
+                    at++;
+                }
+                else if (c == '!') {
+                    error = "expected '!='";
+                    return false;
+                }
+            }
+            else {
+                std::size_t start = at;
+                while (at < text.size() && isWordChar(text[at]))
+                    at++;
+                token.kind = Token::Kind::Word;
+                token.value = text.substr(start, at - start);
+            }
+            tokens.push_back(std::move(token));
+        }
+    }
+
+    std::string lower(const std::string& text) {
+        std::string out = text;
+        for (char& c : out)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return out;
+    }
+
+    // ---------- Fields ----------
+
+    bool fieldFromName(const std::string& name, QueryField& field) {
+        static const struct { const char* name; QueryField field; } names[] = {
+            { "serial", QueryField::Serial }, { "serialnumber", QueryField::Serial },
+            { "name", QueryField::Name },
+            { "brand", QueryField::Brand },
+            { "type", QueryField::Type },
+            { "price", QueryField::Price },
+            { "quantity", QueryField::Quantity }, { "qty", QueryField::Quantity },
+            { "category", QueryField::Category }, { "categoryid", QueryField::Category },
+            { "cpu", QueryField::Cpu },
+            { "gpu", QueryField::Gpu },
+            { "ramgb", QueryField::RamGB }, { "ram", QueryField::RamGB },
+            { "storagegb", QueryField::StorageGB }, { "storage", QueryField::StorageGB },
+            { "has5g", QueryField::Has5G }, { "5g", QueryField::Has5G },
+        };
+
+        std::string key = lower(name);
+        for (const auto& entry : names) {
+            if (key == entry.name) {
+                field = entry.field;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isTextField(QueryField field) {
+        return field == QueryField::Serial || field == QueryField::Name || field == QueryField::Brand
+            || field == QueryField::Type || field == QueryField::Cpu || field == QueryField::Gpu;
+    }
+
+    // Numeric value of the field, false when the product has no such field.
+    bool numberOf(QueryField field, const Product& p, double& value) {
+        switch (field) {
+        case QueryField::Price:
+            value = p.getPrice();
+            return true;
+        case QueryField::Quantity:
+            value = p.getQuantity();
+            return true;
+        case QueryField::Category:
+            value = p.getCategoryId();
+            return true;
+        case QueryField::RamGB:
+            if (const auto* laptop = dynamic_cast<const Laptop*>(&p)) {
+                value = laptop->getRamGB();
+                return true;
+            }
+            if (const auto* desktop = dynamic_cast<const DesktopComputer*>(&p)) {
+                value = desktop->getRamGB();
+                return true;
+            }
+            return false;
+        case QueryField::StorageGB:
+            if (const auto* laptop = dynamic_cast<const Laptop*>(&p)) {
+                value = laptop->getStorageGB();
+                return true;
+            }
+            if (const auto* phone = dynamic_cast<const Phone*>(&p)) {
+                value = phone->getStorageGB();
+                return true;
+            }
+            return false;
+        case QueryField::Has5G:
+            if (const auto* phone = dynamic_cast<const Phone*>(&p)) {
+                value = phone->supports5G() ? 1.0 : 0.0;
+                return true;
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    const InternedString* internedOf(QueryField field, const Product& p) {
+        switch (field) {
+        case QueryField::Brand:
+            return &p.getInternedBrand();
+        case QueryField::Cpu:
+            if (const auto* laptop = dynamic_cast<const Laptop*>(&p))
+                return &laptop->getInternedCpu();
+            if (const auto* phone = dynamic_cast<const Phone*>(&p))
+                return &phone->getInternedCpu();
+            if (const auto* desktop = dynamic_cast<const DesktopComputer*>(&p))
+                return &desktop->getInternedCpu();
+            return nullptr;
+        case QueryField::Gpu:
+            if (const auto* desktop = dynamic_cast<const DesktopComputer*>(&p))
+                return &desktop->getInternedGpu();
+            return nullptr;
+        default:
+            return nullptr;
+        }
+    }
+
+    // getType() builds a string; these literals do not.
+    const char* typeNameOf(const Product& p) {
+        const std::type_info& type = typeid(p);
+        if (type == typeid(Laptop))
+            return "Laptop";
+        if (type == typeid(Phone))
+            return "Phone";
+        if (type == typeid(DesktopComputer))
+            return "DesktopComputer";
+        return "";
+    }
+
+    const std::string* textOf(QueryField field, const Product& p) {
+        switch (field) {
+        case QueryField::Serial:
+            return &p.getSerialNumber();
+        case QueryField::Name:
+            return &p.getName();
+        default: {
+            const InternedString* interned = internedOf(field, p);
+            return interned ? &interned->str() : nullptr;
+        }
+        }
+    }
+
+    // ---------- Compilation ----------
+
+    template <typename Cmp>
+    ProductPredicate numeric(QueryField field, double operand) {
+        switch (field) {
+        case QueryField::Price:
+            return [operand](const Product& p) { return Cmp()(p.getPrice(), operand); };
+        case QueryField::Quantity:
+            return [operand](const Product& p) { return Cmp()(static_cast<double>(p.getQuantity()), operand); };
+        case QueryField::Category:
+            return [operand](const Product& p) { return Cmp()(static_cast<double>(p.getCategoryId()), operand); };
+        default:
+            return [field, operand](const Product& p) {
+                double value;
+                return numberOf(field, p, value) && Cmp()(value, operand);
+            };
+        }
+    }
+
+    ProductPredicate compileCondition(const QueryCondition& c) {
+        if (!isTextField(c.field)) {
+            switch (c.op) {
+            case QueryOp::Equal: return numeric<std::equal_to<double>>(c.field, c.number);
+            case QueryOp::NotEqual: return numeric<std::not_equal_to<double>>(c.field, c.number);
+            case QueryOp::Less: return numeric<std::less<double>>(c.field, c.number);
+            case QueryOp::LessEqual: return numeric<std::less_equal<double>>(c.field, c.number);
+            case QueryOp::Greater: return numeric<std::greater<double>>(c.field, c.number);
+            case QueryOp::GreaterEqual: return numeric<std::greater_equal<double>>(c.field, c.number);
+            default: return [](const Product&) { return false; };
+            }
+        }
+
+        const QueryField field = c.field;
+        const bool negate = c.op == QueryOp::NotEqual;
+
+        if (c.op == QueryOp::Contains) {
+            std::string term = c.text;
+            if (field == QueryField::Type)
+                return [term](const Product& p) { return std::string(typeNameOf(p)).find(term) != std::string::npos; };
+            return [field, term](const Product& p) {
+                const std::string* text = textOf(field, p);
+                return text && text->find(term) != std::string::npos;
+            };
+        }
+
+        if (field == QueryField::Type) {
+            const std::type_info* type = &typeid(void);
+            if (c.text == "Laptop")
+                type = &typeid(Laptop);
+            else if (c.text == "Phone")
+                type = &typeid(Phone);
+            else if (c.text == "DesktopComputer")
+                type = &typeid(DesktopComputer);
+            return [type, negate](const Product& p) { return (typeid(p) == *type) != negate; };
+        }
+
+        if (field == QueryField::Brand || field == QueryField::Cpu || field == QueryField::Gpu) {
+            // A value no product has ever held matches nothing, and is not
+            // interned just for this query.
+            const std::string* known = StringInterner::find(c.text);
+            if (!known)
+                return [field, negate](const Product& p) { return internedOf(field, p) && negate; };
+
+            InternedString wanted = InternedString::fromInterned(*known);
+            return [field, wanted, negate](const Product& p) {
+                const InternedString* value = internedOf(field, p);
+                return value && (*value == wanted) != negate;
+            };
+        }
+
+        std::string wanted = c.text;
+        return [field, wanted, negate](const Product& p) {
+            const std::string* text = textOf(field, p);
+            return text && (*text == wanted) != negate;
+        };
+    }
+
+    // ---------- Parser ----------
+
+    class Parser {
+    public:
+        Parser(const std::vector<Token>& tokens, std::string& error)
+            : tokens(tokens), error(error) {
+        }
+
+        bool isKeyword(const char* keyword) const {
+            return peek().kind == Token::Kind::Word && lower(peek().value) == keyword;
+        }
+
+        bool atClauseEnd() const {
+            return peek().kind == Token::Kind::End || isKeyword("order") || isKeyword("limit");
+        }
+
+        const Token& peek() const { return tokens[at]; }
+        const Token& next() { return tokens[at < tokens.size() - 1 ? at++ : at]; }
+
+        bool fail(const std::string& message) {
+            error = message;
+            if (peek().kind != Token::Kind::End)
+                error += " at '" + peek().value + "'";
+            return false;
+        }
+
+        bool parseOr(QueryNode& node) {
+            if (!parseAnd(node))
+                return false;
+            while (isKeyword("or")) {
+                next();
+                QueryNode right;
+                if (!parseAnd(right))
+                    return false;
+                join(QueryNode::Kind::Or, node, std::move(right));
+            }
+            return true;
+        }
+
+        bool parseAnd(QueryNode& node) {
+            if (!parseUnary(node))
+                return false;
+            while (isKeyword("and")) {
+                next();
+                QueryNode right;
+                if (!parseUnary(right))
+                    return false;
+                join(QueryNode::Kind::And, node, std::move(right));
+            }
+            return true;
+        }
+
+        bool parseUnary(QueryNode& node) {
+            if (isKeyword("not")) {
+                next();
+                node.kind = QueryNode::Kind::Not;
+                node.children.emplace_back();
+                return parseUnary(node.children.back());
+            }
+            if (peek().kind == Token::Kind::Open) {
+                next();
+                if (!parseOr(node))
+                    return false;
+                if (peek().kind != Token::Kind::Close)
+                    return fail("expected ')'");
+                next();
+                return true;
+            }
+            return parseCondition(node.condition);
+        }
+
+        bool parseCondition(QueryCondition& c) {
+            if (peek().kind != Token::Kind::Word || !fieldFromName(peek().value, c.field))
+                return fail("expected a field name");
+            next();
+
+            if (peek().kind != Token::Kind::Op)
+                return fail("expected an operator");
+            const std::string op = next().value;
+            if (op == "=") c.op = QueryOp::Equal;
+            else if (op == "!=") c.op = QueryOp::NotEqual;
+            else if (op == "<") c.op = QueryOp::Less;
+            else if (op == "<=") c.op = QueryOp::LessEqual;
+            else if (op == ">") c.op = QueryOp::Greater;
+            else if (op == ">=") c.op = QueryOp::GreaterEqual;
+            else c.op = QueryOp::Contains;
+
+            if (peek().kind != Token::Kind::Word && peek().kind != Token::Kind::Text)
+                return fail("expected a value");
+            const Token& value = next();
+
+            if (isTextField(c.field)) {
+                if (c.op != QueryOp::Equal && c.op != QueryOp::NotEqual && c.op != QueryOp::Contains)
+                    return fail(std::string("only = != ~ apply to ") + ProductQuery::fieldName(c.field));
+                if (c.field == QueryField::Type && c.op != QueryOp::Contains && value.value != "Laptop"
+                    && value.value != "Phone" && value.value != "DesktopComputer")
+                    return fail("unknown type '" + value.value + "'");
+                c.text = value.value;
+                return true;
+            }
+
+            if (c.op == QueryOp::Contains)
+                return fail(std::string("~ does not apply to ") + ProductQuery::fieldName(c.field));
+
+            if (c.field == QueryField::Has5G) {
+                std::string flag = lower(value.value);
+                if (flag == "true" || flag == "yes" || flag == "1")
+                    c.number = 1.0;
+                else if (flag == "false" || flag == "no" || flag == "0")
+                    c.number = 0.0;
+                else
+                    return fail("expected true or false");
+                return true;
+            }
+
+            char* end = nullptr;
+            c.number = std::strtod(value.value.c_str(), &end);
+            if (value.value.empty() || *end != '\0')
+                return fail("expected a number for " + std::string(ProductQuery::fieldName(c.field)));
+            return true;
+        }
+
+    private:
+        const std::vector<Token>& tokens;
+        std::string& error;
+        std::size_t at = 0;
+
+        // Chains of the same operator become one node with many children.
+        static void join(QueryNode::Kind kind, QueryNode& left, QueryNode&& right) {
+            if (left.kind != kind) {
+                QueryNode combined;
+                combined.kind = kind;
+                combined.children.push_back(std::move(left));
+                left = std::move(combined);
+            }
+            if (right.kind == kind) {
+                for (auto& child : right.children)
+                    left.children.push_back(std::move(child));
+            }
+            else {
+                left.children.push_back(std::move(right));
+            }
+        }
+    };
+}
+
+// ===================== PARSE =====================
+
+bool ProductQuery::parse(const std::string& text, ProductQuery& query, std::string& error) {
+    std::vector<Token> tokens;
+    if (!tokenize(text, tokens, error))
+        return false;
+
+    ProductQuery parsed;
+    Parser parser(tokens, error);
+
+    if (parser.isKeyword("where"))
+        parser.next();
+
+    if (!parser.atClauseEnd()) {
+        QueryNode root;
+        if (!parser.parseOr(root))
+            return false;
+
+        if (root.kind == QueryNode::Kind::And)
+            parsed.where = std::move(root.children);
+        else
+            parsed.where.push_back(std::move(root));
+    }
+
+    if (parser.isKeyword("order")) {
+        parser.next();
+        if (!parser.isKeyword("by"))
+            return parser.fail("expected BY");
+        parser.next();
+
+        if (parser.peek().kind != Token::Kind::Word || !fieldFromName(parser.peek().value, parsed.orderBy))
+            return parser.fail("expected a field name");
+        parser.next();
+        parsed.ordered = true;
+
+        if (parser.isKeyword("asc"))
+            parser.next();
+        else if (parser.isKeyword("desc")) {
+            parser.next();
+            parsed.descending = true;
+        }
+    }
+
+    if (parser.isKeyword("limit")) {
+        parser.next();
+        const std::string& value = parser.peek().value;
+        char* end = nullptr;
+        unsigned long long n = std::strtoull(value.c_str(), &end, 10);
+        if (parser.peek().kind != Token::Kind::Word || value.empty() || *end != '\0' || value[0] == '-')
+            return parser.fail("expected a row count");
+        parser.next();
+        parsed.maxResults = static_cast<std::size_t>(n);
+    }
+
+    if (parser.peek().kind != Token::Kind::End)
+        return parser.fail("unexpected text");
+
+    query = std::move(parsed);
+    return true;
+}
+
+const std::vector<QueryNode>& ProductQuery::terms() const {
+    return where;
+}
+
+bool ProductQuery::isOrdered() const {
+    return ordered;
+}
+
+QueryField ProductQuery::orderField() const {
+    return orderBy;
+}
+
+bool ProductQuery::isDescending() const {
+    return descending;
+}
+
+std::size_t ProductQuery::limit() const {
+    return maxResults;
+}
+
+// ===================== COMPILE =====================
+
+ProductPredicate ProductQuery::compile(const QueryNode& node) {
+    if (node.kind == QueryNode::Kind::Condition)
+        return compileCondition(node.condition);
+
+    if (node.kind == QueryNode::Kind::Not) {
+        ProductPredicate inner = compile(node.children.front());
+        return [inner](const Product& p) { return !inner(p); };
+    }
+
+    std::vector<ProductPredicate> parts;
+    parts.reserve(node.children.size());
+    for (const auto& child : node.children)
+        parts.push_back(compile(child));
+
+    if (node.kind == QueryNode::Kind::And) {
+        return [parts](const Product& p) {
+            for (const auto& part : parts) {
+                if (!part(p))
+                    return false;
+            }
+            return true;
+        };
+    }
+    return [parts](const Product& p) {
+        for (const auto& part : parts) {
+            if (part(p))
+                return true;
+        }
+        return false;
+    };
+}
+
+int ProductQuery::compare(QueryField field, const Product& a, const Product& b, bool descending) {
+    int order = 0;
+
+    if (field == QueryField::Type) {
+        order = std::string(typeNameOf(a)).compare(typeNameOf(b));
+    }
+    else if (isTextField(field)) {
+        const std::string* x = textOf(field, a);
+        const std::string* y = textOf(field, b);
+        if (!x || !y)
+            return (x ? 0 : 1) - (y ? 0 : 1);
+        order = x->compare(*y);
+    }
+    else {
+        double x = 0.0;
+        double y = 0.0;
+        bool hasX = numberOf(field, a, x);
+        bool hasY = numberOf(field, b, y);
+        if (!hasX || !hasY)
+            return (hasX ? 0 : 1) - (hasY ? 0 : 1);
+        order = x < y ? -1 : (y < x ? 1 : 0);
+    }
+    return descending ? -order : order;
+}
+
+// ===================== DESCRIBE =====================
+
+const char* ProductQuery::fieldName(QueryField field) {
+    switch (field) {
+    case QueryField::Serial: return "serial";
+    case QueryField::Name: return "name";
+    case QueryField::Brand: return "brand";
+    case QueryField::Type: return "type";
+    case QueryField::Price: return "price";
+    case QueryField::Quantity: return "quantity";
+    case QueryField::Category: return "category";
+    case QueryField::Cpu: return "cpu";
+    case QueryField::Gpu: return "gpu";
+    case QueryField::RamGB: return "ramGB";
+    case QueryField::StorageGB: return "storageGB";
+    case QueryField::Has5G: return "has5G";
+    }
+    return "?";
+}
+
+std::string ProductQuery::describe(const QueryNode& node) {
+    std::ostringstream out;
+
+    if (node.kind == QueryNode::Kind::Condition) {
+        static const char* const ops[] = { "=", "!=", "<", "<=", ">", ">=", "~" };
+        const QueryCondition& c = node.condition;
+        out << fieldName(c.field) << ' ' << ops[static_cast<int>(c.op)] << ' ';
+        if (isTextField(c.field))
+            out << '\'' << c.text << '\'';
+        else if (c.field == QueryField::Has5G)
+            out << (c.number != 0.0 ? "true" : "false");
+        else
+            out << c.number;
+        return out.str();
+    }
+
+    if (node.kind == QueryNode::Kind::Not) {
+        out << "NOT (" << describe(node.children.front()) << ')';
+        return out.str();
+    }
+
+    const char* glue = node.kind == QueryNode::Kind::And ? " AND " : " OR ";
+    for (std::size_t i = 0; i < node.children.size(); i++) {
+        const QueryNode& child = node.children[i];
+        bool nested = child.kind == QueryNode::Kind::And || child.kind == QueryNode::Kind::Or;
+        if (i > 0)
+            out << glue;
+        out << (nested ? "(" : "") << describe(child) << (nested ? ")" : "");
+    }
+    return out.str();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Product.h"
+
+enum class QueryField {
+    Serial,
+    Name,
+    Brand,
+    Type,
+    Price,
+    Quantity,
+    Category,
+    Cpu,
+    Gpu,
+    RamGB,
+    StorageGB,
+    Has5G
+};
+
+enum class QueryOp {
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Contains
+};
+
+struct QueryCondition {
+    QueryField field = QueryField::Serial;
+    QueryOp op = QueryOp::Equal;
+    double number = 0.0;    // numeric fields; has5G is 1 or 0
+    std::string text;       // text fields
+};
+
+// One node of a WHERE clause: a condition, or And/Or over its children,
+// or Not over its only child.
+struct QueryNode {
+    enum class Kind { Condition, And, Or, Not };
+
+    Kind kind = Kind::Condition;
+    QueryCondition condition;
+    std::vector<QueryNode> children;
+};
+
+using ProductPredicate = std::function<bool(const Product&)>;
+
+// A parsed filter expression such as
+//
+//   type=Laptop AND ramGB>=16 AND price<2000 AND quantity>0 ORDER BY price DESC LIMIT 10
+//
+// Fields: serial, name, brand, type, price, quantity, category, cpu, gpu,
+// ramGB, storageGB, has5G (names are case-insensitive). Operators are
+// = != < <= > >= on numbers, and = != ~ (contains) on text. Keywords AND,
+// OR, NOT, ORDER BY, ASC, DESC and LIMIT are case-insensitive; text with
+// spaces goes in quotes. A condition on a field the product does not have
+// (ramGB of a phone) is false.
+class ProductQuery {
+public:
+    static constexpr std::size_t kNoLimit = static_cast<std::size_t>(-1);
+
+    // False with a message in `error` when the text is not a valid query.
+    static bool parse(const std::string& text, ProductQuery& query, std::string& error);
+
+    // The WHERE clause split at its top-level ANDs; empty matches everything.
+    const std::vector<QueryNode>& terms() const;
+
+    bool isOrdered() const;
+    QueryField orderField() const;
+    bool isDescending() const;
+    std::size_t limit() const;
+
+    // Builds a closure for the node once, so matching a product does not
+    // look at the query text again. Brand, cpu and gpu equality compare
+    // interned handles.
+    static ProductPredicate compile(const QueryNode& node);
+
+    // Negative, zero or positive as a orders before, with or after b on
+    // the field; products without the field order last either way.
+    static int compare(QueryField field, const Product& a, const Product& b, bool descending = false);
+
+    static const char* fieldName(QueryField field);
+    static std::string describe(const QueryNode& node);
+
+private:
+    std::vector<QueryNode> where;
+    bool ordered = false;
+    QueryField orderBy = QueryField::Serial;
+    bool descending = false;
+    std::size_t maxResults = kNoLimit;
+};
@@ -0,0 +1,192 @@
+#include "ProductRenderer.h"
+
+#include <algorithm>
+#include <charconv>
+
+static const char* const kTitles[] = { "Serial", "Type", "Name", "Brand", "Price", "Qty", "Category" };
+static const std::string_view kRule = "----------------------------------------\n";
+
+// ===================== CONSTRUCTION =====================
+
+ProductRenderer::ProductRenderer(std::ostream& out, const std::vector<Category>& categories, Layout layout)
+    : out(out), layout(layout)
+{
+    for (const auto& c : categories)
+        categoryNames.emplace(c.getId(), c.getName());
+
+    for (int col = 0; col < ColumnCount; col++)
+        widths[col] = textWidth(kTitles[col]);
+
+    buffer.reserve(kFlushAt + 4096);
+}
+
+ProductRenderer::~ProductRenderer()
+{
+    flush();
+}
+
+// ===================== RENDERING =====================
+
+void ProductRenderer::measure(const Product& product)
+{
+    if (layout != Layout::Table)
+        return;
+
+    char number[48];
+    auto widen = [this](Column col, std::size_t width) {
+        widths[col] = std::max(widths[col], std::min(width, kMaxTextWidth));
+    };
+
+    widen(ColSerial, textWidth(product.getSerialNumber()));
+    widen(ColType, textWidth(product.getType()));
+    widen(ColName, textWidth(product.getName()));
+    widen(ColBrand, textWidth(product.getBrand()));
+    widen(ColPrice, formatPrice(product.getPrice(), number).size());
+    widen(ColCategory, textWidth(categoryName(product.getCategoryId())));
+
+    char digits[24];
+    widen(ColQuantity, formatInt(product.getQuantity(), digits).size());
+}
+
+void ProductRenderer::header()
+{
+    if (layout != Layout::Table)
+        return;
+
+    for (int col = 0; col < ColumnCount; col++)
+    {
+        if (col > 0)
+            append(" | ");
+        if (col == ColPrice || col == ColQuantity)
+            appendNumber(kTitles[col], widths[col]);
+        else
+            appendCell(kTitles[col], widths[col]);
+    }
+    append("\n");
+
+    std::size_t total = 0;
+    for (int col = 0; col < ColumnCount; col++)
+        total += widths[col] + (col > 0 ? 3 : 0);
+    buffer.append(total, '-');
+    append("\n");
+}
+
+void ProductRenderer::render(const Product& product)
+{
+    if (layout == Layout::Table)
+        renderRow(product);
+    else
+        renderDetailed(product);
+
+    if (buffer.size() >= kFlushAt)
+        flush();
+}
+
+void ProductRenderer::flush()
+{
+    if (buffer.empty())
+        return;
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+    buffer.clear();
+}
+
+void ProductRenderer::renderDetailed(const Product& product)
+{
+    char number[48];
+    char digits[24];
+
+    append(kRule);
+    append(" Serial   : "); append(product.getSerialNumber()); append("\n");
+    append(" Type     : "); append(product.getType()); append("\n");
+    append(" Name     : "); append(product.getName()); append("\n");
+    append(" Brand    : "); append(product.getBrand()); append("\n");
+    append(" Price    : "); append(formatPrice(product.getPrice(), number)); append("\n");
+    append(" Quantity : "); append(formatInt(product.getQuantity(), digits)); append("\n");
+    append(" Category : "); append(categoryName(product.getCategoryId()));
+    append(" (ID="); append(formatInt(product.getCategoryId(), digits)); append(")\n");
+    append(kRule);
+}
+
+void ProductRenderer::renderRow(const Product& product)
+{
+    char number[48];
+    char digits[24];
+
+    appendCell(product.getSerialNumber(), widths[ColSerial]);
+    append(" | ");
+    appendCell(product.getType(), widths[ColType]);
+    append(" | ");
+    appendCell(product.getName(), widths[ColName]);
+    append(" | ");
+    appendCell(product.getBrand(), widths[ColBrand]);
+    append(" | ");
+    appendNumber(formatPrice(product.getPrice(), number), widths[ColPrice]);
+    append(" | ");
+    appendNumber(formatInt(product.getQuantity(), digits), widths[ColQuantity]);
+    append(" | ");
+    append(categoryName(product.getCategoryId()));
+    append("\n");
+}
+
+// ===================== FORMATTING =====================
+
+std::string_view ProductRenderer::categoryName(int id) const
+{
+    auto it = categoryNames.find(id);
+    return it == categoryNames.end() ? std::string_view("Unknown") : std::string_view(it->second);
+}
+
+void ProductRenderer::append(std::string_view text)
+{
+    buffer.append(text.data(), text.size());
+}
+
+void ProductRenderer::appendCell(std::string_view text, std::size_t width)
+{
+    std::size_t used = 0;
+    std::size_t end = 0;
+    while (end < text.size())
+    {
+        if ((static_cast<unsigned char>(text[end]) & 0xC0) != 0x80)
+        {
+            if (used == width)
+                break;
+            used++;
+        }
+        end++;
+    }
+
+    buffer.append(text.data(), end);
+    buffer.append(width - used, ' ');
+}
+
+void ProductRenderer::appendNumber(std::string_view digits, std::size_t width)
+{
+    if (digits.size() < width)
+        buffer.append(width - digits.size(), ' ');
+    append(digits);
+}
+
+std::size_t ProductRenderer::textWidth(std::string_view text)
+{
+    std::size_t width = 0;
+    for (char c : text)
+        if ((static_cast<unsigned char>(c) & 0xC0) != 0x80)
+            width++;
+    return width;
+}
+
+std::string_view ProductRenderer::formatInt(long long value, char (&scratch)[24])
+{
+    auto result = std::to_chars(scratch, scratch + sizeof(scratch), value);
+    return std::string_view(scratch, static_cast<std::size_t>(result.ptr - scratch));
+}
+
+std::string_view ProductRenderer::formatPrice(double value, char (&scratch)[48])
+{
+    auto result = std::to_chars(scratch, scratch + sizeof(scratch), value, std::chars_format::fixed, 2);
+    if (result.ec != std::errc())
+        result = std::to_chars(scratch, scratch + sizeof(scratch), value, std::chars_format::general);
+    return std::string_view(scratch, static_cast<std::size_t>(result.ptr - scratch));
+}
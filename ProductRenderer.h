@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Category.h"
+#include "Product.h"
+
+// Formats product listings into one reusable buffer and hands it to the
+// stream in large writes instead of a stream insertion per field. Numbers go
+// through std::to_chars and category names are resolved once, when the
+// renderer is built, so a listing costs about what the terminal can take.
+class ProductRenderer {
+public:
+    enum class Layout {
+        Detailed,   // a block of labelled fields per product
+        Table       // one line per product
+    };
+
+    ProductRenderer(std::ostream& out, const std::vector<Category>& categories, Layout layout);
+    ~ProductRenderer();
+
+    ProductRenderer(const ProductRenderer&) = delete;
+    ProductRenderer& operator=(const ProductRenderer&) = delete;
+
+    // Table layout: widens the columns to fit the product. Measure what is
+    // about to be listed before the first header() so the columns line up.
+    void measure(const Product& product);
+    // Column titles in the table layout; nothing in the detailed one.
+    void header();
+    void render(const Product& product);
+    // Writes out whatever is buffered.
+    void flush();
+
+private:
+    static constexpr std::size_t kFlushAt = 256 * 1024;
+    static constexpr std::size_t kMaxTextWidth = 40;
+
+    enum Column { ColSerial, ColType, ColName, ColBrand, ColPrice, ColQuantity, ColCategory, ColumnCount };
+
+    std::ostream& out;
+    Layout layout;
+    std::unordered_map<int, std::string> categoryNames;
+    std::string buffer;
+    std::size_t widths[ColumnCount];
+
+    std::string_view categoryName(int id) const;
+
+    void append(std::string_view text);
+    // Left-aligned, cut to `width` characters, then padded to it.
+    void appendCell(std::string_view text, std::size_t width);
+    // Right-aligned in `width`.
+    void appendNumber(std::string_view digits, std::size_t width);
+
+    void renderDetailed(const Product& product);
+    void renderRow(const Product& product);
+
+    // Characters, not bytes: names may be UTF-8.
+    static std::size_t textWidth(std::string_view text);
+    static std::string_view formatInt(long long value, char (&scratch)[24]);
+    static std::string_view formatPrice(double value, char (&scratch)[48]);
+};
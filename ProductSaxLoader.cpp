@@ -0,0 +1,641 @@
+#include "ProductSaxLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+
+#include "ConcurrentSerialSet.h"
+#include "Laptop.h"
+#include "Phone.h"
+#include "DesktopComputer.h"
+#include "ProductStore.h"
+#include "MemoryAccounting.h"
+#include "Trace.h"
+
+using json = nlohmann::json;
+
+namespace {
+    enum Field {
+        Type,
+        SerialNumber,
+        Name,
+        Brand,
+        Price,
+        Quantity,
+        CategoryId,
+        Cpu,
+        Gpu,
+        RamGB,
+        StorageGB,
+        Has5G,
+        FieldCount,
+        UnknownField = FieldCount
+    };
+
+    Field fieldFromKey(const std::string& key) {
+        if (key == "type") return Type;
+        if (key == "serialNumber") return SerialNumber;
+        if (key == "name") return Name;
+        if (key == "brand") return Brand;
+        if (key == "price") return Price;
+        if (key == "quantity") return Quantity;
+        if (key == "categoryId") return CategoryId;
+        if (key == "cpu") return Cpu;
+        if (key == "gpu") return Gpu;
+        if (key == "ramGB") return RamGB;
+        if (key == "storageGB") return StorageGB;
+        if (key == "has5G") return Has5G;
+        return UnknownField;
+    }
+
+    struct FieldValue {
+        enum class Kind { Missing, String, Integer, Unsigned, Float, Boolean, Other };
+
+        Kind kind = Kind::Missing;
+        std::string text;
+        json::number_integer_t integer = 0;
+        json::number_unsigned_t unsignedValue = 0;
+        json::number_float_t number = 0.0;
+        bool flag = false;
+    };
+
+    // The readers mirror json::get<T>(): numbers convert between each other,
+    // int additionally accepts booleans, strings and booleans must match exactly.
+    bool takeString(FieldValue& f, std::string& out) {
+        if (f.kind != FieldValue::Kind::String)
+            return false;
+        out = std::move(f.text);
+        return true;
+    }
+
+    bool readDouble(const FieldValue& f, double& out) {
+        switch (f.kind) {
+        case FieldValue::Kind::Integer: out = static_cast<double>(f.integer); return true;
+        case FieldValue::Kind::Unsigned: out = static_cast<double>(f.unsignedValue); return true;
+        case FieldValue::Kind::Float: out = f.number; return true;
+        default: return false;
+        }
+    }
+
+    bool readInt(const FieldValue& f, int& out) {
+        switch (f.kind) {
+        case FieldValue::Kind::Integer: out = static_cast<int>(f.integer); return true;
+        case FieldValue::Kind::Unsigned: out = static_cast<int>(f.unsignedValue); return true;
+        case FieldValue::Kind::Float: out = static_cast<int>(f.number); return true;
+        case FieldValue::Kind::Boolean: out = f.flag ? 1 : 0; return true;
+        default: return false;
+        }
+    }
+
+    bool readBool(const FieldValue& f, bool& out) {
+        if (f.kind != FieldValue::Kind::Boolean)
+            return false;
+        out = f.flag;
+        return true;
+    }
+
+    // Depth counts open containers: 1 = document object, 2 = "products"
+    // array, 3 = one product record, 4+ = nested values inside a record.
+    class ProductSaxHandler {
+    public:
+        ProductSaxHandler(std::vector<std::shared_ptr<Product>>& out, LoadStats& stats)
+            : out(out), stats(stats) {
+        }
+
+        bool null() {
+            value(FieldValue::Kind::Other);
+            return true;
+        }
+
+        bool boolean(bool val) {
+            if (FieldValue* f = value(FieldValue::Kind::Boolean))
+                f->flag = val;
+            return true;
+        }
+
+        bool number_integer(json::number_integer_t val) {
+            if (FieldValue* f = value(FieldValue::Kind::Integer))
+                f->integer = val;
+            return true;
+        }
+
+        bool number_unsigned(json::number_unsigned_t val) {
+            if (FieldValue* f = value(FieldValue::Kind::Unsigned))
+                f->unsignedValue = val;
+            return true;
+        }
+
+        bool number_float(json::number_float_t val, const json::string_t&) {
+            if (FieldValue* f = value(FieldValue::Kind::Float))
+                f->number = val;
+            return true;
+        }
+
+        bool string(json::string_t& val) {
+            if (FieldValue* f = value(FieldValue::Kind::String))
+                f->text = std::move(val);
+            return true;
+        }
+
+        bool binary(json::binary_t&) {
+            value(FieldValue::Kind::Other);
+            return true;
+        }
+
+        bool start_object(std::size_t) {
+            if (inProducts && depth == 2)
+                beginRecord();
+            else
+                value(FieldValue::Kind::Other);
+            ++depth;
+            return true;
+        }
+
+        bool end_object() {
+            --depth;
+            if (inRecord && depth == 2)
+                finishRecord();
+            return true;
+        }
+
+        bool key(json::string_t& val) {
+            if (depth == 1 && val == "products") {
+                // Like the DOM, a repeated "products" key replaces the earlier one.
+                out.clear();
+                stats.records = 0;
+                expectProducts = true;
+            }
+            else if (inRecord && depth == 3) {
+                field = fieldFromKey(val);
+            }
+            return true;
+        }
+
+        bool start_array(std::size_t) {
+            if (depth == 1 && expectProducts) {
+                expectProducts = false;
+                inProducts = true;
+            }
+            else {
+                value(FieldValue::Kind::Other);
+            }
+            ++depth;
+            return true;
+        }
+
+        bool end_array() {
+            --depth;
+            if (inProducts && depth == 1)
+                inProducts = false;
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+            return false;
+        }
+
+        // For parsing a bare array of records, as if it were the value of
+        // "products". The number of the record behind each product goes to
+        // `recordNumbers`.
+        void expectRecords(std::vector<std::size_t>& recordNumbers) {
+            depth = 1;
+            expectProducts = true;
+            positions = &recordNumbers;
+        }
+
+        // Time spent constructing products, out of the whole parse; only
+        // measured while a trace is recording.
+        std::uint64_t buildMicros() const {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(building).count());
+        }
+
+    private:
+        std::vector<std::shared_ptr<Product>>& out;
+        LoadStats& stats;
+
+        std::size_t depth = 0;
+        bool expectProducts = false;
+        bool inProducts = false;
+        bool inRecord = false;
+        std::vector<std::size_t>* positions = nullptr;
+        const bool timeBuilds = Trace::active();
+        std::chrono::steady_clock::duration building{};
+        Field field = UnknownField;
+        FieldValue fields[FieldCount];
+
+        // Routes a value event (scalar or container start) to whatever it
+        // belongs to and returns the record field it should fill, if any.
+        FieldValue* value(FieldValue::Kind kind) {
+            if (depth == 1) {
+                expectProducts = false;
+                return nullptr;
+            }
+            if (inProducts && depth == 2) {
+                ++stats.records;
+                return nullptr;
+            }
+            if (!inRecord || depth != 3 || field == UnknownField)
+                return nullptr;
+
+            FieldValue& f = fields[field];
+            f.kind = kind;
+            return &f;
+        }
+
+        void beginRecord() {
+            ++stats.records;
+            inRecord = true;
+            field = UnknownField;
+            for (auto& f : fields)
+                f.kind = FieldValue::Kind::Missing;
+        }
+
+        void finishRecord() {
+            inRecord = false;
+            std::shared_ptr<Product> product;
+            if (timeBuilds) {
+                const auto started = std::chrono::steady_clock::now();
+                product = buildProduct();
+                building += std::chrono::steady_clock::now() - started;
+            }
+            else {
+                product = buildProduct();
+            }
+
+            if (product) {
+                out.push_back(std::move(product));
+                if (positions)
+                    positions->push_back(stats.records - 1);
+            }
+        }
+
+        std::shared_ptr<Product> buildProduct() {
+            std::string type;
+            if (!takeString(fields[Type], type))
+                return nullptr;
+
+            if (type != "Laptop" && type != "Phone" && type != "DesktopComputer")
+                return nullptr;
+
+            std::string serial, name, brand, cpu;
+            double price;
+            int quantity, categoryId;
+
+            if (!takeString(fields[SerialNumber], serial) ||
+                !takeString(fields[Name], name) ||
+                !takeString(fields[Brand], brand) ||
+                !readDouble(fields[Price], price) ||
+                !readInt(fields[Quantity], quantity) || quantity < 0 ||
+                !readInt(fields[CategoryId], categoryId) ||
+                !takeString(fields[Cpu], cpu))
+                return nullptr;
+
+            if (type == "Laptop") {
+                int ramGB, storageGB;
+                if (!readInt(fields[RamGB], ramGB) || !readInt(fields[StorageGB], storageGB))
+                    return nullptr;
+                return ProductStore::make<Laptop>(serial, name, brand, price, quantity, categoryId, cpu, ramGB, storageGB);
+            }
+
+            if (type == "Phone") {
+                int storageGB;
+                bool has5G;
+                if (!readInt(fields[StorageGB], storageGB) || !readBool(fields[Has5G], has5G))
+                    return nullptr;
+                return ProductStore::make<Phone>(serial, name, brand, price, quantity, categoryId, cpu, storageGB, has5G);
+            }
+
+            std::string gpu;
+            int ramGB;
+            if (!takeString(fields[Gpu], gpu) || !readInt(fields[RamGB], ramGB))
+                return nullptr;
+            return ProductStore::make<DesktopComputer>(serial, name, brand, price, quantity, categoryId, cpu, gpu, ramGB);
+        }
+    };
+
+    // Just enough of JSON to find where values start and end: strings,
+    // nesting and separators. What it finds is parsed properly afterwards.
+    class StructuralScanner {
+    public:
+        const char* at;
+        const char* end;
+
+        StructuralScanner(const char* at, const char* end) : at(at), end(end) {}
+
+        void skipSpace() {
+            while (at < end && (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t'))
+                ++at;
+        }
+
+        bool consume(char c) {
+            skipSpace();
+            if (at == end || *at != c)
+                return false;
+            ++at;
+            return true;
+        }
+
+        bool skipValue() {
+            skipSpace();
+            if (at == end)
+                return false;
+            if (*at == '"')
+                return skipString();
+            if (*at == '{' || *at == '[')
+                return skipNested();
+
+            const char* start = at;
+            while (at < end && *at != ',' && *at != '}' && *at != ']' &&
+                   *at != ' ' && *at != '\n' && *at != '\r' && *at != '\t')
+                ++at;
+            return at != start;
+        }
+
+        // `at` is on the opening quote. A quote ends the string unless an
+        // odd run of backslashes comes right before it.
+        bool skipString() {
+            ++at;
+            while (true) {
+                const char* quote = static_cast<const char*>(std::memchr(at, '"', static_cast<std::size_t>(end - at)));
+                if (!quote)
+                    return false;
+
+                const char* run = quote;
+                while (run > at && run[-1] == '\\')
+                    --run;
+                at = quote + 1;
+                if ((quote - run) % 2 == 0)
+                    return true;
+            }
+        }
+
+    private:
+        bool skipNested() {
+            std::size_t depth = 0;
+            while (at < end) {
+                const char c = *at;
+                if (c == '"') {
+                    if (!skipString())
+                        return false;
+                    continue;
+                }
+                if (c == '{' || c == '[') {
+                    ++depth;
+                }
+                else if (c == '}' || c == ']') {
+                    if (--depth == 0) {
+                        ++at;
+                        return true;
+                    }
+                }
+                ++at;
+            }
+            return false;
+        }
+    };
+
+    // A run of whole records from the products array.
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        std::size_t firstRecord = 0;
+        std::size_t records = 0;
+    };
+
+    struct ChunkResult {
+        std::vector<std::shared_ptr<Product>> products;
+        std::vector<std::size_t> positions;     // record number of each product
+        bool valid = false;
+    };
+
+    enum class ScanResult { Chunked, Invalid, Unexpected };
+
+    // Cuts the products array into chunks of about `target` bytes. Anything
+    // else in the top-level object is checked with json::accept, since the
+    // workers never see it.
+    ScanResult scanDocument(const char* data, std::size_t size, std::size_t target, std::vector<Chunk>& chunks, std::size_t& records) {
+        StructuralScanner scan(data, data + size);
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+            scan.at += 3;
+
+        if (!scan.consume('{'))
+            return ScanResult::Unexpected;
+        if (scan.consume('}'))
+            return ScanResult::Chunked;
+
+        do {
+            scan.skipSpace();
+            const char* keyStart = scan.at;
+            if (scan.at == scan.end || *scan.at != '"' || !scan.skipString())
+                return ScanResult::Unexpected;
+
+            std::string_view key(keyStart + 1, static_cast<std::size_t>(scan.at - keyStart - 2));
+            if (key.find('\\') != std::string_view::npos)
+                return ScanResult::Unexpected;
+            if (!scan.consume(':'))
+                return ScanResult::Unexpected;
+
+            if (key != "products") {
+                scan.skipSpace();
+                const char* valueStart = scan.at;
+                if (!scan.skipValue())
+                    return ScanResult::Unexpected;
+                if (!json::accept(valueStart, scan.at))
+                    return ScanResult::Invalid;
+                continue;
+            }
+
+            // A repeated "products" key replaces the earlier array.
+            chunks.clear();
+            records = 0;
+            if (!scan.consume('[')) {
+                const char* valueStart = scan.at;
+                if (!scan.skipValue())
+                    return ScanResult::Unexpected;
+                if (!json::accept(valueStart, scan.at))
+                    return ScanResult::Invalid;
+                continue;
+            }
+            if (scan.consume(']'))
+                continue;
+
+            Chunk chunk;
+            do {
+                scan.skipSpace();
+                if (!chunk.begin) {
+                    chunk.begin = scan.at;
+                    chunk.firstRecord = records;
+                }
+                if (!scan.skipValue())
+                    return ScanResult::Unexpected;
+                ++records;
+                ++chunk.records;
+
+                if (static_cast<std::size_t>(scan.at - chunk.begin) >= target) {
+                    chunk.end = scan.at;
+                    chunks.push_back(chunk);
+                    chunk = Chunk();
+                }
+            } while (scan.consume(','));
+
+            if (!scan.consume(']'))
+                return ScanResult::Unexpected;
+            if (chunk.begin) {
+                chunk.end = scan.at - 1;
+                chunks.push_back(chunk);
+            }
+        } while (scan.consume(','));
+
+        return scan.consume('}') ? ScanResult::Chunked : ScanResult::Unexpected;
+    }
+
+    // Reads a chunk as the array "[" + chunk + "]" without copying it, so a
+    // single sax_parse call covers all of its records.
+    class BracketedIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char*;
+        using reference = char;
+
+        BracketedIterator(const Chunk& chunk, difference_type at)
+            : data(chunk.begin), length(chunk.end - chunk.begin), at(at) {}
+
+        char operator*() const { return at < 0 ? '[' : at < length ? data[at] : ']'; }
+        BracketedIterator& operator++() { ++at; return *this; }
+        BracketedIterator operator++(int) { BracketedIterator old = *this; ++at; return old; }
+
+        bool operator==(const BracketedIterator& other) const { return at == other.at; }
+        bool operator!=(const BracketedIterator& other) const { return at != other.at; }
+
+        static BracketedIterator begin(const Chunk& chunk) { return BracketedIterator(chunk, -1); }
+        static BracketedIterator end(const Chunk& chunk) { return BracketedIterator(chunk, chunk.end - chunk.begin + 1); }
+
+    private:
+        const char* data;
+        difference_type length;
+        difference_type at;
+    };
+
+    void parseChunk(const Chunk& chunk, ChunkResult& result, ConcurrentSerialSet& serials) {
+        Trace::Span span("parseChunk", "load");
+        MemoryAccounting::Scope memory(MemorySubsystem::Products);
+        span.arg("records", chunk.records);
+
+        LoadStats chunkStats;
+        ProductSaxHandler handler(result.products, chunkStats);
+        handler.expectRecords(result.positions);
+
+        result.valid = json::sax_parse(BracketedIterator::begin(chunk), BracketedIterator::end(chunk),
+            &handler, json::input_format_t::json, true);
+        span.arg("buildUs", handler.buildMicros());
+        if (!result.valid)
+            return;
+
+        for (std::size_t k = 0; k < result.products.size(); k++) {
+            result.positions[k] += chunk.firstRecord;
+            serials.claim(result.products[k]->getSerialNumber(), result.positions[k]);
+        }
+    }
+
+    bool parseWhole(const char* data, std::size_t size, std::vector<std::shared_ptr<Product>>& out, LoadStats& stats) {
+        Trace::Span span("parseWhole", "load");
+        MemoryAccounting::Scope memory(MemorySubsystem::Products);
+        out.clear();
+        stats.records = 0;
+
+        ProductSaxHandler handler(out, stats);
+        const bool valid = json::sax_parse(data, data + size, &handler, json::input_format_t::json, false);
+        span.arg("records", stats.records);
+        span.arg("buildUs", handler.buildMicros());
+        return valid;
+    }
+}
+
+// Reading, parsing and construction interleave here, so the span carries the
+// construction time as an argument.
+bool ProductSaxLoader::load(std::istream& in, std::vector<std::shared_ptr<Product>>& out, LoadStats& stats) {
+    Trace::Span span("parseStream", "load");
+    MemoryAccounting::Scope memory(MemorySubsystem::Products);
+    out.clear();
+    stats.records = 0;
+
+    ProductSaxHandler handler(out, stats);
+
+    // Non-strict, like operator>>: trailing content after the document is ignored.
+    const bool valid = json::sax_parse(in, &handler, json::input_format_t::json, false);
+    span.arg("records", stats.records);
+    span.arg("buildUs", handler.buildMicros());
+    return valid;
+}
+
+bool ProductSaxLoader::loadParallel(const char* data, std::size_t size, std::vector<std::shared_ptr<Product>>& out,
+    LoadStats& stats, ThreadPool& pool) {
+    const std::size_t target = std::max<std::size_t>(size / (pool.size() * 8 + 1), 64 * 1024);
+
+    std::vector<Chunk> chunks;
+    std::size_t records = 0;
+    ScanResult scanned;
+    {
+        Trace::Span span("scanDocument", "load");
+        scanned = scanDocument(data, size, target, chunks, records);
+        span.arg("chunks", chunks.size());
+        span.arg("records", records);
+    }
+
+    switch (scanned) {
+    case ScanResult::Invalid:
+        return false;
+    case ScanResult::Unexpected:
+        return parseWhole(data, size, out, stats);
+    case ScanResult::Chunked:
+        break;
+    }
+
+    ConcurrentSerialSet serials;
+    serials.reserve(records);
+
+    std::vector<ChunkResult> results(chunks.size());
+    {
+        Trace::Span span("parseChunks", "load");
+        pool.parallelFor(chunks.size(), [&](std::size_t i) {
+            parseChunk(chunks[i], results[i], serials);
+        });
+    }
+
+    for (const auto& result : results)
+        if (!result.valid)
+            return false;
+
+    // Every claim is in, so each worker can drop the products that lost
+    // their serial to an earlier record.
+    {
+        Trace::Span span("dropDuplicates", "load");
+        pool.parallelFor(results.size(), [&](std::size_t i) {
+            ChunkResult& result = results[i];
+            for (std::size_t k = 0; k < result.products.size(); k++)
+                if (serials.owner(result.products[k]->getSerialNumber()) != result.positions[k])
+                    result.products[k].reset();
+        });
+    }
+
+    Trace::Span span("gatherProducts", "load");
+    std::size_t built = 0;
+    for (const auto& result : results)
+        built += result.products.size();
+
+    out.clear();
+    out.reserve(built);
+    for (auto& result : results)
+        for (auto& product : result.products)
+            if (product)
+                out.push_back(std::move(product));
+
+    stats.records = records;
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <vector>
+
+#include "LoadStats.h"
+#include "Product.h"
+#include "ThreadPool.h"
+
+// Streams a warehouse JSON document through nlohmann's SAX interface and
+// builds Laptop/Phone/DesktopComputer objects as their fields arrive, without
+// materialising a json DOM. Accepts and rejects records exactly like the
+// per-type fromJson functions; rejected records are skipped.
+class ProductSaxLoader {
+public:
+    // Returns false if the document is not valid JSON; `out` is then left
+    // unspecified. A document without a "products" array yields no products.
+    static bool load(std::istream& in, std::vector<std::shared_ptr<Product>>& out, LoadStats& stats);
+
+    // Same result from a document in memory, built on the pool: a structural
+    // pre-scan cuts the "products" array into chunks of whole records, the
+    // workers parse and construct each chunk independently, and the chunks
+    // are joined in file order. Repeated serials are settled on the workers
+    // through a ConcurrentSerialSet, keeping the first in the file, so `out`
+    // holds distinct serials. Documents the pre-scan does not expect are
+    // handed to a single-threaded parse of the same bytes.
+    static bool loadParallel(const char* data, std::size_t size, std::vector<std::shared_ptr<Product>>& out,
+        LoadStats& stats, ThreadPool& pool = ThreadPool::shared());
+};
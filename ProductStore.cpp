@@ -0,0 +1,188 @@
+#include "ProductStore.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <typeinfo>
+
+#include "MemoryAccounting.h"
+
+namespace {
+    // About 64 KB of products per chunk.
+    constexpr std::size_t kChunkBytes = 64 * 1024;
+
+    // Slots a thread moves to or from the shared free list at a time.
+    constexpr std::size_t kCacheBatch = 32;
+
+    struct Pools {
+        std::mutex mutex;
+        std::vector<SlotPool*> all;
+    };
+
+    // Never destroyed: products held in static storage may still release
+    // their slots while other statics are torn down.
+    Pools& pools() {
+        static Pools* instance = new Pools();
+        return *instance;
+    }
+}
+
+// ===================== SLOT POOL =====================
+
+static_assert(std::is_trivially_destructible<SlotPool::Cache>::value,
+    "a thread's Cache must outlive its Retire for statics torn down after it");
+
+SlotPool::SlotPool(std::size_t slotSize, std::size_t slotsPerChunk)
+    : size(slotSize), perChunk(slotsPerChunk) {
+}
+
+// Only the owning thread writes its cache's count; stats read it under the mutex.
+static void addLive(SlotPool::Cache& cache, std::ptrdiff_t delta) {
+    cache.live.store(cache.live.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+void* SlotPool::allocate(Cache& cache) {
+    if (cache.retired) {
+        std::lock_guard<std::mutex> lock(mutex);
+        retiredLive++;
+        return takeLocked();
+    }
+
+    if (!cache.freeList)
+        refill(cache);
+    void* slot = cache.freeList;
+    cache.freeList = *static_cast<void**>(slot);
+    cache.count--;
+    addLive(cache, 1);
+    return slot;
+}
+
+void SlotPool::release(Cache& cache, void* slot) {
+    if (cache.retired) {
+        std::lock_guard<std::mutex> lock(mutex);
+        *static_cast<void**>(slot) = freeList;
+        freeList = slot;
+        retiredLive--;
+        return;
+    }
+
+    *static_cast<void**>(slot) = cache.freeList;
+    cache.freeList = slot;
+    cache.count++;
+    addLive(cache, -1);
+    // A thread that only frees (say, the one dropping a replaced product
+    // list) would otherwise hoard the slots.
+    if (cache.count >= 2 * kCacheBatch)
+        drain(cache, kCacheBatch);
+}
+
+// Takes up to kCacheBatch slots from the shared list, carving new ones when
+// it is empty, but starts a new chunk only for the first.
+void SlotPool::refill(Cache& cache) {
+    void* slots[kCacheBatch];
+    std::size_t n = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (n < kCacheBatch && (n == 0 || freeList || used < perChunk))
+            slots[n++] = takeLocked();
+    }
+
+    // Pushed in reverse, so the thread hands them out in the order taken.
+    while (n > 0) {
+        void* slot = slots[--n];
+        *static_cast<void**>(slot) = cache.freeList;
+        cache.freeList = slot;
+        cache.count++;
+    }
+}
+
+// Hands all but `keep` of the cache's free slots back to the shared list.
+void SlotPool::drain(Cache& cache, std::size_t keep) {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (cache.count > keep) {
+        void* slot = cache.freeList;
+        cache.freeList = *static_cast<void**>(slot);
+        *static_cast<void**>(slot) = freeList;
+        freeList = slot;
+        cache.count--;
+    }
+}
+
+void* SlotPool::takeLocked() {
+    if (freeList) {
+        void* slot = freeList;
+        freeList = *static_cast<void**>(slot);
+        return slot;
+    }
+
+    if (chunks.empty() || used == perChunk) {
+        MemoryAccounting::Scope memory(MemorySubsystem::Products);
+        chunks.emplace_back(new unsigned char[size * perChunk]);
+        used = 0;
+    }
+    return chunks.back().get() + size * used++;
+}
+
+std::size_t SlotPool::live() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ptrdiff_t total = retiredLive;
+    for (const Cache* cache : caches)
+        total += cache->live.load(std::memory_order_relaxed);
+    return total > 0 ? static_cast<std::size_t>(total) : 0;
+}
+
+std::size_t SlotPool::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunks.size() * perChunk;
+}
+
+SlotPool::Retire::Retire(SlotPool& pool, Cache& cache) : pool(pool), cache(cache) {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.caches.push_back(&cache);
+}
+
+SlotPool::Retire::~Retire() {
+    pool.drain(cache, 0);
+
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.retiredLive += cache.live.load(std::memory_order_relaxed);
+    cache.live.store(0, std::memory_order_relaxed);
+    pool.caches.erase(std::find(pool.caches.begin(), pool.caches.end(), &cache));
+    cache.retired = true;
+}
+
+// ===================== STORE =====================
+
+SlotPool& ProductStore::addPool(std::size_t size, std::size_t alignment) {
+    // Room for the free-list link, and every slot keeps the type's alignment.
+    if (size < sizeof(void*))
+        size = sizeof(void*);
+    size = (size + alignment - 1) / alignment * alignment;
+
+    Pools& p = pools();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.all.push_back(new SlotPool(size, kChunkBytes / size > 0 ? kChunkBytes / size : 1));
+    return *p.all.back();
+}
+
+ProductStore::Ref ProductStore::refOf(const Product& product) {
+    const std::type_info& type = typeid(product);
+    if (type == typeid(Laptop))
+        return static_cast<const Laptop*>(&product);
+    if (type == typeid(Phone))
+        return static_cast<const Phone*>(&product);
+    if (type == typeid(DesktopComputer))
+        return static_cast<const DesktopComputer*>(&product);
+    return std::monostate();
+}
+
+ProductStore::Stats ProductStore::stats() {
+    Pools& p = pools();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    Stats stats;
+    for (const SlotPool* pool : p.all) {
+        stats.live += pool->live();
+        stats.slots += pool->capacity();
+        stats.bytes += pool->capacity() * pool->slotSize();
+    }
+    return stats;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "DesktopComputer.h"
+#include "Laptop.h"
+#include "Phone.h"
+
+// Equal-sized slots carved from chunks that are never moved or freed. Each
+// thread keeps its own free list per pool (a Cache) and only takes the
+// pool's mutex to move a batch of slots between that and the shared free
+// list, so threads building or dropping products do not queue on one lock.
+class SlotPool {
+public:
+    // One thread's free slots. Trivially destructible, so a thread_local
+    // Cache stays usable while statics are torn down after its Retire ran;
+    // a retired cache falls back to the shared list under the mutex.
+    struct Cache {
+        void* freeList = nullptr;
+        std::size_t count = 0;
+        std::atomic<std::ptrdiff_t> live{ 0 };  // slots this thread took minus returned
+        bool retired = false;
+    };
+
+    // Registers a Cache with its pool; on thread exit hands its free slots
+    // back and retires it.
+    class Retire {
+    public:
+        Retire(SlotPool& pool, Cache& cache);
+        ~Retire();
+
+        Retire(const Retire&) = delete;
+        Retire& operator=(const Retire&) = delete;
+
+    private:
+        SlotPool& pool;
+        Cache& cache;
+    };
+
+    SlotPool(std::size_t slotSize, std::size_t slotsPerChunk);
+
+    SlotPool(const SlotPool&) = delete;
+    SlotPool& operator=(const SlotPool&) = delete;
+
+    // `cache` belongs to the calling thread; a slot may be released by a
+    // different thread than the one that allocated it.
+    void* allocate(Cache& cache);
+    void release(Cache& cache, void* slot);
+
+    std::size_t slotSize() const { return size; }
+    std::size_t live() const;
+    std::size_t capacity() const;
+
+private:
+    const std::size_t size;
+    const std::size_t perChunk;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+    std::size_t used = 0;           // slots handed out from the last chunk
+    void* freeList = nullptr;       // each free slot starts with the next one
+    std::vector<Cache*> caches;     // of live threads
+    std::ptrdiff_t retiredLive = 0; // live slots counted by retired caches
+
+    void refill(Cache& cache);
+    void drain(Cache& cache, std::size_t keep);
+    void* takeLocked();
+};
+
+// Where products live. make<T>() builds a Laptop, Phone or DesktopComputer
+// in the pool for its type, with the shared_ptr control block in the same
+// slot (std::allocate_shared): products of one type sit side by side, never
+// move, and cost no heap allocation of their own. The slot goes back to its
+// pool when the last shared_ptr to the product is dropped. The pools are
+// process-wide and never destroyed, like the StringInterner.
+//
+// There are no separate handles: the shared_ptr the Inventory holds is the
+// handle, and the product's address stays valid for as long as it lives.
+// Scans that must not touch reference counts go through the Inventory's
+// views (forEachProduct, viewProducts), which read the products in place.
+class ProductStore {
+public:
+    template <typename T, typename... Args>
+    static std::shared_ptr<Product> make(Args&&... args) {
+        return std::allocate_shared<T>(Allocator<T>(), std::forward<Args>(args)...);
+    }
+
+    // The concrete product behind a Product&; monostate for a type the
+    // store does not know.
+    using Ref = std::variant<std::monostate, const Laptop*, const Phone*, const DesktopComputer*>;
+    static Ref refOf(const Product& product);
+
+    // Calls f with a const Laptop*, Phone* or DesktopComputer* (or
+    // std::monostate) through std::visit: one type test per product instead
+    // of a virtual call or dynamic_cast per field.
+    template <typename F>
+    static decltype(auto) visit(const Product& product, F&& f) {
+        return std::visit(std::forward<F>(f), refOf(product));
+    }
+
+    struct Stats {
+        std::size_t live = 0;       // products in the pools
+        std::size_t slots = 0;      // live plus free slots
+        std::size_t bytes = 0;      // chunk memory held
+    };
+    static Stats stats();
+
+    template <typename T>
+    class Allocator {
+    public:
+        using value_type = T;
+
+        Allocator() = default;
+        template <typename U>
+        Allocator(const Allocator<U>&) {}
+
+        T* allocate(std::size_t n) {
+            if (n != 1)
+                return std::allocator<T>().allocate(n);
+            return static_cast<T*>(pool().allocate(cache()));
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            if (n != 1)
+                std::allocator<T>().deallocate(p, n);
+            else
+                pool().release(cache(), p);
+        }
+
+        template <typename U>
+        bool operator==(const Allocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const Allocator<U>&) const { return false; }
+
+    private:
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "chunks only have new[]'s alignment");
+
+        // allocate_shared rebinds to its own in-place block type, so each
+        // product type gets a pool sized for product plus control block.
+        static SlotPool& pool() {
+            static SlotPool& instance = addPool(sizeof(T), alignof(T));
+            return instance;
+        }
+
+        static SlotPool::Cache& cache() {
+            thread_local SlotPool::Cache instance;
+            thread_local SlotPool::Retire retire(pool(), instance);
+            return instance;
+        }
+    };
+
+private:
+    static SlotPool& addPool(std::size_t size, std::size_t alignment);
+};
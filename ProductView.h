@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "Product.h"
+#include "ShardedMutex.h"
+
+// Walks a product list as const Product&, never copying the shared_ptrs.
+class ProductIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Product;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Product*;
+    using reference = const Product&;
+
+    ProductIterator() = default;
+    explicit ProductIterator(const std::shared_ptr<Product>* at) : at(at) {}
+
+    reference operator*() const { return **at; }
+    pointer operator->() const { return at->get(); }
+    reference operator[](difference_type n) const { return *at[n]; }
+
+    ProductIterator& operator++() { ++at; return *this; }
+    ProductIterator operator++(int) { ProductIterator old = *this; ++at; return old; }
+    ProductIterator& operator--() { --at; return *this; }
+    ProductIterator operator--(int) { ProductIterator old = *this; --at; return old; }
+    ProductIterator& operator+=(difference_type n) { at += n; return *this; }
+    ProductIterator& operator-=(difference_type n) { at -= n; return *this; }
+
+    friend ProductIterator operator+(ProductIterator it, difference_type n) { return it += n; }
+    friend ProductIterator operator-(ProductIterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const ProductIterator& a, const ProductIterator& b) { return a.at - b.at; }
+
+    bool operator==(const ProductIterator& other) const { return at == other.at; }
+    bool operator!=(const ProductIterator& other) const { return at != other.at; }
+    bool operator<(const ProductIterator& other) const { return at < other.at; }
+
+private:
+    const std::shared_ptr<Product>* at = nullptr;
+};
+
+// Lazy filter over a ProductIterator range: the predicate runs as the range
+// is walked, and nothing is collected.
+template <typename Pred>
+class FilteredProductRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Product;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Product*;
+        using reference = const Product&;
+
+        iterator(ProductIterator at, ProductIterator end, const Pred* pred)
+            : at(at), end(end), pred(pred) {
+            skip();
+        }
+
+        reference operator*() const { return *at; }
+        pointer operator->() const { return at.operator->(); }
+
+        iterator& operator++() { ++at; skip(); return *this; }
+        iterator operator++(int) { iterator old = *this; ++*this; return old; }
+
+        bool operator==(const iterator& other) const { return at == other.at; }
+        bool operator!=(const iterator& other) const { return at != other.at; }
+
+    private:
+        ProductIterator at;
+        ProductIterator end;
+        const Pred* pred;
+
+        void skip() {
+            while (at != end && !(*pred)(*at))
+                ++at;
+        }
+    };
+
+    FilteredProductRange(ProductIterator first, ProductIterator last, Pred pred)
+        : first(first), last(last), pred(std::move(pred)) {}
+
+    iterator begin() const { return iterator(first, last, &pred); }
+    iterator end() const { return iterator(last, last, &pred); }
+    bool empty() const { return begin() == end(); }
+
+private:
+    ProductIterator first;
+    ProductIterator last;
+    Pred pred;
+};
+
+// Read-only window onto an inventory's products. It holds one shard shared
+// for its lifetime, which is enough to keep products from being added or
+// removed (quantities may still move), so keep it short-lived and do not
+// call into the inventory at all while one is open on the same thread.
+class ProductView {
+public:
+    ProductView(const std::vector<std::shared_ptr<Product>>& products, ShardedMutex& locks)
+        : lock(locks, locks.shardOfThisThread(), ShardLock::Shared), products(products) {}
+
+    ProductView(const ProductView&) = delete;
+    ProductView& operator=(const ProductView&) = delete;
+
+    ProductIterator begin() const { return ProductIterator(products.data()); }
+    ProductIterator end() const { return ProductIterator(products.data() + products.size()); }
+    std::size_t size() const { return products.size(); }
+    bool empty() const { return products.empty(); }
+    const Product& operator[](std::size_t i) const { return *products[i]; }
+
+    // Products for which pred(const Product&) is true, evaluated lazily.
+    // The range borrows this view's lock, so it must not outlive the view.
+    template <typename Pred>
+    FilteredProductRange<Pred> where(Pred pred) const {
+        return FilteredProductRange<Pred>(begin(), end(), std::move(pred));
+    }
+
+private:
+    ShardLock lock;
+    const std::vector<std::shared_ptr<Product>>& products;
+};
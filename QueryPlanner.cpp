@@ -0,0 +1,468 @@
+#include "QueryPlanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <sstream>
+
+namespace {
+    using Rows = std::vector<std::size_t>;
+
+    // An ordered index seeds the candidates only when it cuts them to this
+    // fraction of the inventory; past that the dense column scan is cheaper.
+    constexpr std::size_t kIndexSeedFraction = 8;
+
+    bool isCondition(const QueryNode& node, QueryField field, QueryOp op) {
+        return node.kind == QueryNode::Kind::Condition && node.condition.field == field && node.condition.op == op;
+    }
+
+    bool isColumnTerm(const QueryNode& node) {
+        if (node.kind != QueryNode::Kind::Condition || node.condition.op == QueryOp::Contains)
+            return false;
+        QueryField field = node.condition.field;
+        return field == QueryField::Price || field == QueryField::Quantity || field == QueryField::Category;
+    }
+
+    std::string describeTerm(const QueryNode& term) {
+        bool nested = term.kind == QueryNode::Kind::Or;
+        return (nested ? "(" : "") + ProductQuery::describe(term) + (nested ? ")" : "");
+    }
+
+    std::string describeTerms(const std::vector<const QueryNode*>& terms) {
+        std::string summary;
+        for (const QueryNode* term : terms)
+            summary += (summary.empty() ? "" : " AND ") + describeTerm(*term);
+        return summary;
+    }
+
+    const OrderedIndex* orderedIndexFor(QueryField field, const QuerySources& sources) {
+        if (field == QueryField::Price)
+            return &sources.prices;
+        if (field == QueryField::Quantity)
+            return &sources.quantities;
+        return nullptr;
+    }
+
+    // ---------- Value ranges ----------
+
+    // Closed bounds implied by a field's AND terms. Strict bounds are kept
+    // closed here; the terms themselves still filter the candidates.
+    struct Range {
+        double low = -std::numeric_limits<double>::infinity();
+        double high = std::numeric_limits<double>::infinity();
+        bool bounded = false;
+    };
+
+    Range rangeOf(QueryField field, const std::vector<QueryNode>& terms) {
+        Range range;
+        for (const auto& term : terms) {
+            if (term.kind != QueryNode::Kind::Condition || term.condition.field != field)
+                continue;
+
+            const double v = term.condition.number;
+            switch (term.condition.op) {
+            case QueryOp::Equal: range.low = std::max(range.low, v); range.high = std::min(range.high, v); break;
+            case QueryOp::Less:
+            case QueryOp::LessEqual: range.high = std::min(range.high, v); break;
+            case QueryOp::Greater:
+            case QueryOp::GreaterEqual: range.low = std::max(range.low, v); break;
+            default: continue;
+            }
+            range.bounded = true;
+        }
+        return range;
+    }
+
+    std::string describeRange(QueryField field, const Range& range) {
+        std::ostringstream out;
+        if (range.low > -std::numeric_limits<double>::infinity())
+            out << range.low << " <= ";
+        out << ProductQuery::fieldName(field);
+        if (range.high < std::numeric_limits<double>::infinity())
+            out << " <= " << range.high;
+        return out.str();
+    }
+
+    // ---------- Column filters ----------
+
+    bool columnMatches(const QueryCondition& c, const ProductColumns& columns, std::size_t row) {
+        double value = c.field == QueryField::Price ? columns.prices()[row]
+            : c.field == QueryField::Quantity ? static_cast<double>(columns.quantities()[row])
+            : static_cast<double>(columns.categoryIds()[row]);
+
+        switch (c.op) {
+        case QueryOp::Equal: return value == c.number;
+        case QueryOp::NotEqual: return value != c.number;
+        case QueryOp::Less: return value < c.number;
+        case QueryOp::LessEqual: return value <= c.number;
+        case QueryOp::Greater: return value > c.number;
+        case QueryOp::GreaterEqual: return value >= c.number;
+        default: return false;
+        }
+    }
+
+    // Without a seed every row is tested; the store is unconditional and
+    // only the count moves, so the loop has no branch on the data.
+    template <typename T, typename Cmp>
+    void filterRows(const T* column, std::size_t count, double operand, bool seeded, Rows& rows) {
+        Cmp cmp;
+        std::size_t kept = 0;
+
+        if (!seeded) {
+            rows.resize(count);
+            for (std::size_t row = 0; row < count; row++) {
+                rows[kept] = row;
+                kept += cmp(static_cast<double>(column[row]), operand) ? 1 : 0;
+            }
+        }
+        else {
+            for (std::size_t row : rows) {
+                rows[kept] = row;
+                kept += cmp(static_cast<double>(column[row]), operand) ? 1 : 0;
+            }
+        }
+        rows.resize(kept);
+    }
+
+    template <typename T>
+    void filterColumn(const T* column, std::size_t count, const QueryCondition& c, bool seeded, Rows& rows) {
+        switch (c.op) {
+        case QueryOp::Equal: filterRows<T, std::equal_to<double>>(column, count, c.number, seeded, rows); break;
+        case QueryOp::NotEqual: filterRows<T, std::not_equal_to<double>>(column, count, c.number, seeded, rows); break;
+        case QueryOp::Less: filterRows<T, std::less<double>>(column, count, c.number, seeded, rows); break;
+        case QueryOp::LessEqual: filterRows<T, std::less_equal<double>>(column, count, c.number, seeded, rows); break;
+        case QueryOp::Greater: filterRows<T, std::greater<double>>(column, count, c.number, seeded, rows); break;
+        case QueryOp::GreaterEqual: filterRows<T, std::greater_equal<double>>(column, count, c.number, seeded, rows); break;
+        default: break;
+        }
+    }
+
+    void filterByColumn(const QueryCondition& c, const ProductColumns& columns, bool seeded, Rows& rows) {
+        const std::size_t count = columns.size();
+        if (c.field == QueryField::Price)
+            filterColumn(columns.prices(), count, c, seeded, rows);
+        else if (c.field == QueryField::Quantity)
+            filterColumn(columns.quantities(), count, c, seeded, rows);
+        else
+            filterColumn(columns.categoryIds(), count, c, seeded, rows);
+    }
+
+    // ---------- Ordering ----------
+
+    template <typename T>
+    int compareValues(T a, T b) {
+        return a < b ? -1 : (b < a ? 1 : 0);
+    }
+
+    // Ties order by serial, reversed along with the field for DESC: the
+    // order the ordered indexes walk in, so every plan gives the same rows.
+    void orderRows(const ProductQuery& query, const QuerySources& sources, Rows& rows, std::size_t limit) {
+        const QueryField field = query.orderField();
+        const bool descending = query.isDescending();
+        const int direction = descending ? -1 : 1;
+
+        auto before = [&](std::size_t a, std::size_t b) {
+            int order;
+            if (field == QueryField::Price)
+                order = direction * compareValues(sources.columns.prices()[a], sources.columns.prices()[b]);
+            else if (field == QueryField::Quantity)
+                order = direction * compareValues(sources.columns.quantities()[a], sources.columns.quantities()[b]);
+            else if (field == QueryField::Category)
+                order = direction * compareValues(sources.columns.categoryIds()[a], sources.columns.categoryIds()[b]);
+            else
+                order = ProductQuery::compare(field, *sources.products[a], *sources.products[b], descending);
+
+            if (order == 0)
+                order = direction * sources.products[a]->getSerialNumber().compare(sources.products[b]->getSerialNumber());
+            return order < 0;
+        };
+
+        if (limit < rows.size()) {
+            std::partial_sort(rows.begin(), rows.begin() + static_cast<std::ptrdiff_t>(limit), rows.end(), before);
+            rows.resize(limit);
+        }
+        else {
+            std::sort(rows.begin(), rows.end(), before);
+        }
+    }
+}
+
+// ===================== RUN =====================
+
+QueryResult QueryPlanner::run(const ProductQuery& query, const QuerySources& sources) {
+    auto started = std::chrono::steady_clock::now();
+    QueryResult result;
+
+    const std::vector<QueryNode>& terms = query.terms();
+    const std::size_t limit = query.limit();
+    std::vector<std::string> steps;
+
+    // ---------- Seed ----------
+    // serial = x names at most one product; otherwise the longest name ~ x,
+    // whose trigrams are the most selective.
+    const QueryNode* seed = nullptr;
+    for (const auto& term : terms) {
+        if (isCondition(term, QueryField::Serial, QueryOp::Equal)) {
+            seed = &term;
+            break;
+        }
+        if (isCondition(term, QueryField::Name, QueryOp::Contains) && term.condition.text.size() >= TrigramIndex::kGramSize
+            && (!seed || term.condition.text.size() > seed->condition.text.size()))
+            seed = &term;
+    }
+
+    std::vector<const QueryNode*> bitmapTerms;
+    std::vector<const QueryNode*> columnTerms;
+    std::vector<const QueryNode*> objectTerms;
+    for (const auto& term : terms) {
+        if (&term == seed)
+            continue;
+        if (BitmapIndex::covers(term))
+            bitmapTerms.push_back(&term);
+        else
+            (isColumnTerm(term) ? columnTerms : objectTerms).push_back(&term);
+    }
+
+    std::vector<ProductPredicate> predicates;
+    for (const QueryNode* term : objectTerms)
+        predicates.push_back(ProductQuery::compile(*term));
+    const std::string objectSummary = describeTerms(objectTerms);
+
+    auto objectMatches = [&](std::size_t row) {
+        const Product& p = *sources.products[row];
+        for (const auto& predicate : predicates) {
+            if (!predicate(p))
+                return false;
+        }
+        return true;
+    };
+
+    Rows rows;
+    bool seeded = false;
+    bool presorted = false;
+
+    // ---------- Bitmap terms ----------
+    // Combined up front; the result seeds the rows or filters another seed.
+    const bool bitmapped = !bitmapTerms.empty();
+    const std::string bitmapSummary = describeTerms(bitmapTerms);
+    RoaringBitmap bitmapRows;
+    if (bitmapped)
+        bitmapRows = sources.bitmaps.evaluate(bitmapTerms);
+
+    auto inBitmap = [&](std::size_t row) {
+        return !bitmapped || bitmapRows.contains(static_cast<std::uint32_t>(row));
+    };
+
+    auto filterByBitmap = [&]() {
+        if (!bitmapped)
+            return;
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < rows.size(); i++) {
+            if (inBitmap(rows[i]))
+                rows[kept++] = rows[i];
+        }
+        rows.resize(kept);
+        steps.push_back("bitmap filter (" + bitmapSummary + ")");
+    };
+
+    auto seedFromBitmap = [&]() {
+        bitmapRows.appendTo(rows);
+        steps.push_back("bitmap index (" + bitmapSummary + ", " + std::to_string(rows.size()) + " rows)");
+        seeded = true;
+    };
+
+    const OrderedIndex* orderIndex = query.isOrdered() ? orderedIndexFor(query.orderField(), sources) : nullptr;
+
+    // A walk visits about limit * n / matches entries to find `limit` of the
+    // bitmap's rows; when the bitmap holds fewer rows than that, sorting
+    // them is cheaper.
+    const double bitmapCount = static_cast<double>(bitmapRows.cardinality());
+    const bool walkBeatsBitmap = !bitmapped
+        || bitmapCount * bitmapCount > static_cast<double>(limit) * static_cast<double>(sources.products.size());
+
+    if (seed) {
+        if (seed->condition.field == QueryField::Serial) {
+            std::size_t position = sources.serials.find(seed->condition.text);
+            if (position != SerialIndex::npos)
+                rows.push_back(position);
+            steps.push_back("serial index (" + ProductQuery::describe(*seed) + ")");
+        }
+        else {
+            for (const Product* p : sources.names.search(seed->condition.text))
+                rows.push_back(sources.serials.find(p->getSerialNumber()));
+            std::sort(rows.begin(), rows.end());
+            steps.push_back("trigram index (" + ProductQuery::describe(*seed) + ")");
+        }
+        filterByBitmap();
+        seeded = true;
+    }
+    else if (orderIndex && limit != ProductQuery::kNoLimit && walkBeatsBitmap) {
+        // ---------- Ordered walk ----------
+        // ORDER BY an indexed field with a LIMIT: walk the index in result
+        // order and stop at the limit-th match, so nothing is sorted.
+        const QueryField field = query.orderField();
+        const Range range = rangeOf(field, terms);
+
+        if (limit > 0) {
+            orderIndex->scan(range.low, range.high, query.isDescending(), [&](const OrderedIndex::Entry& entry) {
+                std::size_t row = sources.serials.find(entry.product->getSerialNumber());
+                if (!inBitmap(row))
+                    return true;
+                for (const QueryNode* term : columnTerms) {
+                    if (!columnMatches(term->condition, sources.columns, row))
+                        return true;
+                }
+                if (objectMatches(row))
+                    rows.push_back(row);
+                return rows.size() < limit;
+            });
+        }
+
+        steps.push_back(std::string(ProductQuery::fieldName(field)) + " index walk (" + describeRange(field, range)
+            + (query.isDescending() ? ", DESC)" : ", ASC)"));
+        std::string summary = bitmapSummary;
+        for (const std::string& part : { describeTerms(columnTerms), objectSummary }) {
+            if (!part.empty())
+                summary += (summary.empty() ? "" : " AND ") + part;
+        }
+        if (!summary.empty())
+            steps.push_back("filter (" + summary + ")");
+        steps.push_back("limit " + std::to_string(limit));
+        columnTerms.clear();
+        predicates.clear();
+        seeded = true;
+        presorted = true;
+    }
+    else {
+        // ---------- Range seed ----------
+        // The ordered index whose range holds the fewest products, if it
+        // holds few enough to beat a column scan and fewer than the bitmap.
+        const OrderedIndex* best = nullptr;
+        QueryField bestField = QueryField::Price;
+        Range bestRange;
+        std::size_t bestCount = sources.products.size() / kIndexSeedFraction + 1;
+        if (bitmapped)
+            bestCount = std::min(bestCount, bitmapRows.cardinality());
+
+        for (QueryField field : { QueryField::Price, QueryField::Quantity }) {
+            Range range = rangeOf(field, terms);
+            if (!range.bounded)
+                continue;
+            const OrderedIndex* index = orderedIndexFor(field, sources);
+            std::size_t count = index->count(range.low, range.high);
+            if (count < bestCount) {
+                best = index;
+                bestField = field;
+                bestRange = range;
+                bestCount = count;
+            }
+        }
+
+        if (best) {
+            rows.reserve(bestCount);
+            best->scan(bestRange.low, bestRange.high, false, [&](const OrderedIndex::Entry& entry) {
+                rows.push_back(sources.serials.find(entry.product->getSerialNumber()));
+                return true;
+            });
+            std::sort(rows.begin(), rows.end());
+            steps.push_back(std::string(ProductQuery::fieldName(bestField)) + " index (" + describeRange(bestField, bestRange)
+                + ", " + std::to_string(bestCount) + " rows)");
+            filterByBitmap();
+            seeded = true;
+        }
+        else if (bitmapped) {
+            seedFromBitmap();
+        }
+    }
+
+    // ---------- Column terms ----------
+    for (const QueryNode* term : columnTerms) {
+        filterByColumn(term->condition, sources.columns, seeded, rows);
+        steps.push_back(std::string(seeded ? "column filter (" : "column scan (") + ProductQuery::describe(*term) + ")");
+        seeded = true;
+    }
+
+    // ---------- Object terms ----------
+    // Without ORDER BY the first `limit` matches in inventory order are the
+    // answer, so the filter stops there.
+    const std::size_t stopAt = query.isOrdered() ? ProductQuery::kNoLimit : limit;
+
+    if (!predicates.empty()) {
+        std::size_t kept = 0;
+        if (!seeded) {
+            for (std::size_t row = 0; row < sources.products.size() && kept < stopAt; row++) {
+                if (objectMatches(row)) {
+                    rows.push_back(row);
+                    kept++;
+                }
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < rows.size() && kept < stopAt; i++) {
+                if (objectMatches(rows[i]))
+                    rows[kept++] = rows[i];
+            }
+            rows.resize(kept);
+        }
+        steps.push_back(std::string(seeded ? "object filter (" : "object scan (") + objectSummary + ")");
+        seeded = true;
+    }
+
+    if (!seeded) {
+        rows.resize(std::min(sources.products.size(), stopAt));
+        for (std::size_t row = 0; row < rows.size(); row++)
+            rows[row] = row;
+        steps.push_back("all products");
+    }
+
+    // ---------- Order / limit ----------
+    if (!presorted) {
+        if (query.isOrdered()) {
+            orderRows(query, sources, rows, limit);
+            std::string step = std::string(limit != ProductQuery::kNoLimit ? "top-k by " : "sort by ")
+                + ProductQuery::fieldName(query.orderField()) + (query.isDescending() ? " DESC" : " ASC");
+            steps.push_back(step);
+        }
+        if (rows.size() > limit)
+            rows.resize(limit);
+        if (limit != ProductQuery::kNoLimit)
+            steps.push_back("limit " + std::to_string(limit));
+    }
+
+    result.products.reserve(rows.size());
+    for (std::size_t row : rows)
+        result.products.push_back(sources.products[row]);
+
+    for (const auto& step : steps)
+        result.plan += (result.plan.empty() ? "" : " -> ") + step;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
+
+// ===================== COUNT =====================
+
+QueryCount QueryPlanner::count(const ProductQuery& query, const QuerySources& sources) {
+    auto started = std::chrono::steady_clock::now();
+    QueryCount result;
+
+    std::vector<const QueryNode*> terms;
+    bool covered = true;
+    for (const auto& term : query.terms()) {
+        terms.push_back(&term);
+        covered = covered && BitmapIndex::covers(term);
+    }
+
+    if (covered) {
+        result.count = std::min(sources.bitmaps.count(terms), query.limit());
+        result.plan = terms.empty() ? "all products" : "bitmap count (" + describeTerms(terms) + ")";
+    }
+    else {
+        QueryResult matches = run(query, sources);
+        result.count = matches.products.size();
+        result.plan = matches.plan;
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return result;
+}
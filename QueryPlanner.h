@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BitmapIndex.h"
+#include "OrderedIndex.h"
+#include "Product.h"
+#include "ProductColumns.h"
+#include "ProductQuery.h"
+#include "SerialIndex.h"
+#include "TrigramIndex.h"
+
+struct QueryResult {
+    std::vector<std::shared_ptr<Product>> products;
+    std::string plan;       // the steps the planner chose, for display
+    double seconds = 0.0;
+};
+
+struct QueryCount {
+    std::size_t count = 0;
+    std::string plan;
+    double seconds = 0.0;
+};
+
+// What a query may read. The owner keeps all of it unchanged while the
+// query runs.
+struct QuerySources {
+    const std::vector<std::shared_ptr<Product>>& products;
+    const ProductColumns& columns;
+    const SerialIndex& serials;
+    const TrigramIndex& names;
+    const OrderedIndex& prices;
+    const OrderedIndex& quantities;
+    const BitmapIndex& bitmaps;
+};
+
+// Runs a ProductQuery. AND terms the bitmap index covers (type, brand,
+// category, ramGB, storageGB, gpu, has5G, in stock) are combined there
+// first. The planner then picks the narrowest index-backed source for the
+// candidate rows: serial = x through the serial index, name ~ x through
+// the trigram index, the bitmap result, or a price/quantity range through
+// its ordered index when that range is small; without one it scans. Terms
+// on price, quantity and category then filter the candidates on the dense
+// columns, and only the remaining terms look at the product objects.
+// ORDER BY price or quantity with a LIMIT walks the ordered index instead
+// and stops at the limit.
+class QueryPlanner {
+public:
+    static QueryResult run(const ProductQuery& query, const QuerySources& sources);
+    // Number of products run() would return. When the bitmap index covers
+    // every term this is counted on the bitmaps alone.
+    static QueryCount count(const ProductQuery& query, const QuerySources& sources);
+};
@@ -0,0 +1,510 @@
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ColumnKernels.h"
+
+namespace {
+    // An array container past this many rows becomes a bitmap.
+    constexpr std::size_t kArrayMax = 4096;
+    // A bitmap shrinks back only well below kArrayMax, so a row moving in
+    // and out at the boundary does not convert the container every time.
+    constexpr std::size_t kShrinkBelow = kArrayMax / 2;
+    constexpr std::size_t kWords = 65536 / 64;
+    // Set operations leave their result a bitmap down to this many rows:
+    // pulling the rows out of a bitmap costs more than the later operations
+    // on the array would save.
+    constexpr std::size_t kExtractBelow = kWords / 8;
+
+    int lowestBit(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        int index = 0;
+        while (!(word & 1)) {
+            word >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+
+    bool testBit(const std::vector<std::uint64_t>& words, std::uint16_t low) {
+        return (words[low >> 6] >> (low & 63)) & 1;
+    }
+
+    // Binary search per element beats a merge once one side is this many
+    // times longer than the other.
+    constexpr std::size_t kGallopRatio = 32;
+
+    bool skewed(std::size_t small, std::size_t large) {
+        return small * kGallopRatio < large;
+    }
+}
+
+// ===================== CONTAINERS =====================
+
+RoaringBitmap::Container* RoaringBitmap::find(std::uint16_t key) {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+        [](const Container& c, std::uint16_t k) { return c.key < k; });
+    return it != containers.end() && it->key == key ? &*it : nullptr;
+}
+
+const RoaringBitmap::Container* RoaringBitmap::find(std::uint16_t key) const {
+    return const_cast<RoaringBitmap*>(this)->find(key);
+}
+
+void RoaringBitmap::toBitmap(Container& c) {
+    c.words.assign(kWords, 0);
+    for (std::uint16_t low : c.array)
+        c.words[low >> 6] |= std::uint64_t(1) << (low & 63);
+    std::vector<std::uint16_t>().swap(c.array);
+}
+
+void RoaringBitmap::toArray(Container& c) {
+    c.array.clear();
+    c.array.reserve(c.count);
+    for (std::size_t i = 0; i < kWords; i++) {
+        for (std::uint64_t word = c.words[i]; word; word &= word - 1)
+            c.array.push_back(static_cast<std::uint16_t>(i * 64 + lowestBit(word)));
+    }
+    std::vector<std::uint64_t>().swap(c.words);
+}
+
+void RoaringBitmap::settle(Container& c) {
+    if (c.isBitmap() && c.count <= kExtractBelow)
+        toArray(c);
+    else if (!c.isBitmap() && c.count > kArrayMax)
+        toBitmap(c);
+}
+
+bool RoaringBitmap::containsLow(const Container& c, std::uint16_t low) {
+    if (c.isBitmap())
+        return testBit(c.words, low);
+    return std::binary_search(c.array.begin(), c.array.end(), low);
+}
+
+// ===================== SINGLE ROWS =====================
+
+void RoaringBitmap::add(std::uint32_t row) {
+    const std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+    const std::uint16_t low = static_cast<std::uint16_t>(row & 0xffff);
+
+    Container* c;
+    if (containers.empty() || containers.back().key < key) {
+        containers.emplace_back();
+        containers.back().key = key;
+        c = &containers.back();
+    }
+    else {
+        auto it = std::lower_bound(containers.begin(), containers.end(), key,
+            [](const Container& x, std::uint16_t k) { return x.key < k; });
+        if (it == containers.end() || it->key != key) {
+            it = containers.emplace(it);
+            it->key = key;
+        }
+        c = &*it;
+    }
+
+    if (c->isBitmap()) {
+        std::uint64_t& word = c->words[low >> 6];
+        const std::uint64_t bit = std::uint64_t(1) << (low & 63);
+        if (word & bit)
+            return;
+        word |= bit;
+    }
+    else {
+        auto at = std::lower_bound(c->array.begin(), c->array.end(), low);
+        if (at != c->array.end() && *at == low)
+            return;
+        c->array.insert(at, low);
+    }
+
+    c->count++;
+    total++;
+    if (!c->isBitmap() && c->count > kArrayMax)
+        toBitmap(*c);
+}
+
+bool RoaringBitmap::remove(std::uint32_t row) {
+    const std::uint16_t key = static_cast<std::uint16_t>(row >> 16);
+    const std::uint16_t low = static_cast<std::uint16_t>(row & 0xffff);
+
+    Container* c = find(key);
+    if (!c)
+        return false;
+
+    if (c->isBitmap()) {
+        std::uint64_t& word = c->words[low >> 6];
+        const std::uint64_t bit = std::uint64_t(1) << (low & 63);
+        if (!(word & bit))
+            return false;
+        word &= ~bit;
+    }
+    else {
+        auto at = std::lower_bound(c->array.begin(), c->array.end(), low);
+        if (at == c->array.end() || *at != low)
+            return false;
+        c->array.erase(at);
+    }
+
+    c->count--;
+    total--;
+    if (c->count == 0)
+        containers.erase(containers.begin() + (c - containers.data()));
+    else if (c->isBitmap() && c->count < kShrinkBelow)
+        toArray(*c);
+    return true;
+}
+
+bool RoaringBitmap::contains(std::uint32_t row) const {
+    const Container* c = find(static_cast<std::uint16_t>(row >> 16));
+    return c && containsLow(*c, static_cast<std::uint16_t>(row & 0xffff));
+}
+
+std::size_t RoaringBitmap::cardinality() const {
+    return total;
+}
+
+bool RoaringBitmap::empty() const {
+    return total == 0;
+}
+
+void RoaringBitmap::clear() {
+    containers.clear();
+    total = 0;
+}
+
+std::size_t RoaringBitmap::bytes() const {
+    std::size_t used = containers.capacity() * sizeof(Container);
+    for (const auto& c : containers)
+        used += c.array.capacity() * sizeof(std::uint16_t) + c.words.capacity() * sizeof(std::uint64_t);
+    return used;
+}
+
+void RoaringBitmap::appendTo(std::vector<std::size_t>& rows) const {
+    rows.reserve(rows.size() + total);
+    for (const auto& c : containers) {
+        const std::size_t base = std::size_t(c.key) << 16;
+        if (!c.isBitmap()) {
+            for (std::uint16_t low : c.array)
+                rows.push_back(base + low);
+            continue;
+        }
+        for (std::size_t i = 0; i < kWords; i++) {
+            for (std::uint64_t word = c.words[i]; word; word &= word - 1)
+                rows.push_back(base + i * 64 + static_cast<std::size_t>(lowestBit(word)));
+        }
+    }
+}
+
+// ===================== CONTAINER OPERATIONS =====================
+
+RoaringBitmap::Container RoaringBitmap::intersectContainers(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitmap() && b.isBitmap()) {
+        out.words.resize(kWords);
+        out.count = static_cast<std::uint32_t>(ColumnKernels::combine(ColumnKernels::BitOp::And,
+            a.words.data(), b.words.data(), out.words.data(), kWords));
+        settle(out);
+        return out;
+    }
+
+    if (a.isBitmap() || b.isBitmap()) {
+        const Container& sparse = a.isBitmap() ? b : a;
+        const Container& dense = a.isBitmap() ? a : b;
+        for (std::uint16_t low : sparse.array) {
+            if (testBit(dense.words, low))
+                out.array.push_back(low);
+        }
+    }
+    else {
+        const Container& small = a.array.size() <= b.array.size() ? a : b;
+        const Container& large = a.array.size() <= b.array.size() ? b : a;
+        if (skewed(small.array.size(), large.array.size())) {
+            for (std::uint16_t low : small.array) {
+                if (std::binary_search(large.array.begin(), large.array.end(), low))
+                    out.array.push_back(low);
+            }
+        }
+        else {
+            std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out.array));
+        }
+    }
+    out.count = static_cast<std::uint32_t>(out.array.size());
+    return out;
+}
+
+RoaringBitmap::Container RoaringBitmap::uniteContainers(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitmap() && b.isBitmap()) {
+        out.words.resize(kWords);
+        out.count = static_cast<std::uint32_t>(ColumnKernels::combine(ColumnKernels::BitOp::Or,
+            a.words.data(), b.words.data(), out.words.data(), kWords));
+    }
+    else if (a.isBitmap() || b.isBitmap()) {
+        const Container& dense = a.isBitmap() ? a : b;
+        const Container& other = a.isBitmap() ? b : a;
+        out.words = dense.words;
+        out.count = dense.count;
+        for (std::uint16_t low : other.array) {
+            std::uint64_t& word = out.words[low >> 6];
+            const std::uint64_t bit = std::uint64_t(1) << (low & 63);
+            out.count += (word & bit) ? 0 : 1;
+            word |= bit;
+        }
+    }
+    else {
+        out.array.reserve(a.array.size() + b.array.size());
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out.array));
+        out.count = static_cast<std::uint32_t>(out.array.size());
+    }
+    settle(out);
+    return out;
+}
+
+RoaringBitmap::Container RoaringBitmap::subtractContainers(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+
+    if (a.isBitmap()) {
+        if (b.isBitmap()) {
+            out.words.resize(kWords);
+            out.count = static_cast<std::uint32_t>(ColumnKernels::combine(ColumnKernels::BitOp::AndNot,
+                a.words.data(), b.words.data(), out.words.data(), kWords));
+        }
+        else {
+            out.words = a.words;
+            out.count = a.count;
+            for (std::uint16_t low : b.array) {
+                std::uint64_t& word = out.words[low >> 6];
+                const std::uint64_t bit = std::uint64_t(1) << (low & 63);
+                out.count -= (word & bit) ? 1 : 0;
+                word &= ~bit;
+            }
+        }
+        settle(out);
+        return out;
+    }
+
+    if (b.isBitmap()) {
+        for (std::uint16_t low : a.array) {
+            if (!testBit(b.words, low))
+                out.array.push_back(low);
+        }
+    }
+    else {
+        std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(out.array));
+    }
+    out.count = static_cast<std::uint32_t>(out.array.size());
+    return out;
+}
+
+std::size_t RoaringBitmap::intersectCountContainers(const Container& a, const Container& b) {
+    if (a.isBitmap() && b.isBitmap())
+        return ColumnKernels::popcountAnd(a.words.data(), b.words.data(), kWords);
+
+    std::size_t count = 0;
+    if (a.isBitmap() || b.isBitmap()) {
+        const Container& sparse = a.isBitmap() ? b : a;
+        const Container& dense = a.isBitmap() ? a : b;
+        for (std::uint16_t low : sparse.array)
+            count += testBit(dense.words, low);
+        return count;
+    }
+
+    const Container& small = a.array.size() <= b.array.size() ? a : b;
+    const Container& large = a.array.size() <= b.array.size() ? b : a;
+    if (skewed(small.array.size(), large.array.size())) {
+        for (std::uint16_t low : small.array)
+            count += std::binary_search(large.array.begin(), large.array.end(), low);
+        return count;
+    }
+
+    auto x = a.array.begin();
+    auto y = b.array.begin();
+    while (x != a.array.end() && y != b.array.end()) {
+        if (*x < *y)
+            ++x;
+        else if (*y < *x)
+            ++y;
+        else {
+            count++;
+            ++x;
+            ++y;
+        }
+    }
+    return count;
+}
+
+// ===================== SET OPERATIONS =====================
+
+RoaringBitmap RoaringBitmap::intersect(const RoaringBitmap& a, const RoaringBitmap& b) {
+    RoaringBitmap out;
+    auto x = a.containers.begin();
+    auto y = b.containers.begin();
+    while (x != a.containers.end() && y != b.containers.end()) {
+        if (x->key < y->key)
+            ++x;
+        else if (y->key < x->key)
+            ++y;
+        else {
+            Container c = intersectContainers(*x, *y);
+            if (c.count > 0) {
+                out.total += c.count;
+                out.containers.push_back(std::move(c));
+            }
+            ++x;
+            ++y;
+        }
+    }
+    return out;
+}
+
+RoaringBitmap RoaringBitmap::unite(const RoaringBitmap& a, const RoaringBitmap& b) {
+    RoaringBitmap out;
+    out.containers.reserve(std::max(a.containers.size(), b.containers.size()));
+    auto x = a.containers.begin();
+    auto y = b.containers.begin();
+    while (x != a.containers.end() || y != b.containers.end()) {
+        if (y == b.containers.end() || (x != a.containers.end() && x->key < y->key))
+            out.containers.push_back(*x++);
+        else if (x == a.containers.end() || y->key < x->key)
+            out.containers.push_back(*y++);
+        else
+            out.containers.push_back(uniteContainers(*x++, *y++));
+        out.total += out.containers.back().count;
+    }
+    return out;
+}
+
+RoaringBitmap RoaringBitmap::uniteAll(const std::vector<const RoaringBitmap*>& sets) {
+    std::vector<const Container*> all;
+    for (const RoaringBitmap* set : sets) {
+        for (const auto& c : set->containers)
+            all.push_back(&c);
+    }
+    std::stable_sort(all.begin(), all.end(), [](const Container* a, const Container* b) { return a->key < b->key; });
+
+    // Every key's containers are ORed into one bitmap, counted once.
+    RoaringBitmap out;
+    for (std::size_t i = 0; i < all.size();) {
+        std::size_t end = i + 1;
+        while (end < all.size() && all[end]->key == all[i]->key)
+            end++;
+
+        if (end == i + 1) {
+            out.containers.push_back(*all[i]);
+        }
+        else {
+            Container c;
+            c.key = all[i]->key;
+            c.words.assign(kWords, 0);
+            // Arrays first, so the last bitmap's OR counts the whole result.
+            bool counted = false;
+            for (std::size_t j = i; j < end; j++) {
+                if (!all[j]->isBitmap()) {
+                    for (std::uint16_t low : all[j]->array)
+                        c.words[low >> 6] |= std::uint64_t(1) << (low & 63);
+                }
+            }
+            for (std::size_t j = i; j < end; j++) {
+                if (all[j]->isBitmap()) {
+                    c.count = static_cast<std::uint32_t>(ColumnKernels::combine(ColumnKernels::BitOp::Or,
+                        c.words.data(), all[j]->words.data(), c.words.data(), kWords));
+                    counted = true;
+                }
+            }
+            if (!counted)
+                c.count = static_cast<std::uint32_t>(ColumnKernels::popcount(c.words.data(), kWords));
+            settle(c);
+            out.containers.push_back(std::move(c));
+        }
+        out.total += out.containers.back().count;
+        i = end;
+    }
+    return out;
+}
+
+RoaringBitmap RoaringBitmap::subtract(const RoaringBitmap& a, const RoaringBitmap& b) {
+    RoaringBitmap out;
+    auto y = b.containers.begin();
+    for (const auto& x : a.containers) {
+        while (y != b.containers.end() && y->key < x.key)
+            ++y;
+
+        Container c = y != b.containers.end() && y->key == x.key ? subtractContainers(x, *y) : x;
+        if (c.count > 0) {
+            out.total += c.count;
+            out.containers.push_back(std::move(c));
+        }
+    }
+    return out;
+}
+
+RoaringBitmap RoaringBitmap::complement(const RoaringBitmap& a, std::size_t rows) {
+    RoaringBitmap out;
+    const std::size_t chunks = (rows + 0xffff) >> 16;
+    for (std::size_t k = 0; k < chunks; k++) {
+        Container c;
+        c.key = static_cast<std::uint16_t>(k);
+
+        // Start from a full chunk, trimmed to `rows` in the last one.
+        const std::size_t span = std::min<std::size_t>(rows - (k << 16), 65536);
+        c.words.resize(kWords);
+        if (span == 65536)
+            std::fill(c.words.begin(), c.words.end(), ~std::uint64_t(0));
+        else {
+            std::fill(c.words.begin(), c.words.begin() + static_cast<std::ptrdiff_t>(span / 64), ~std::uint64_t(0));
+            if (span % 64)
+                c.words[span / 64] = (std::uint64_t(1) << (span % 64)) - 1;
+        }
+
+        const Container* taken = a.find(c.key);
+        if (taken && taken->isBitmap()) {
+            c.count = static_cast<std::uint32_t>(ColumnKernels::combine(ColumnKernels::BitOp::AndNot,
+                c.words.data(), taken->words.data(), c.words.data(), kWords));
+        }
+        else {
+            if (taken) {
+                for (std::uint16_t low : taken->array)
+                    c.words[low >> 6] &= ~(std::uint64_t(1) << (low & 63));
+            }
+            c.count = static_cast<std::uint32_t>(ColumnKernels::popcount(c.words.data(), kWords));
+        }
+        if (c.count == 0)
+            continue;
+        settle(c);
+        out.total += c.count;
+        out.containers.push_back(std::move(c));
+    }
+    return out;
+}
+
+std::size_t RoaringBitmap::intersectCount(const RoaringBitmap& a, const RoaringBitmap& b) {
+    std::size_t count = 0;
+    auto x = a.containers.begin();
+    auto y = b.containers.begin();
+    while (x != a.containers.end() && y != b.containers.end()) {
+        if (x->key < y->key)
+            ++x;
+        else if (y->key < x->key)
+            ++y;
+        else
+            count += intersectCountContainers(*x++, *y++);
+    }
+    return count;
+}
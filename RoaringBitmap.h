@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of row numbers in the Roaring layout. Rows are grouped by
+// their high 16 bits into containers; a container is a sorted array of the
+// low halves while it holds at most 4096 rows and a 65536-bit bitmap past
+// that. Sparse sets stay small, dense ones cost a bit per row, and the set
+// operations work container by container, with the dense pairs counted by
+// ColumnKernels::popcount. Results of set operations are short-lived, so
+// they stay bitmaps down to far fewer rows than sets built by add().
+class RoaringBitmap {
+public:
+    void add(std::uint32_t row);
+    // False when the row was not in the set.
+    bool remove(std::uint32_t row);
+    bool contains(std::uint32_t row) const;
+
+    std::size_t cardinality() const;
+    bool empty() const;
+    void clear();
+    // Heap bytes held by the containers.
+    std::size_t bytes() const;
+
+    // Appends the rows in ascending order.
+    void appendTo(std::vector<std::size_t>& rows) const;
+
+    static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b);
+    static RoaringBitmap unite(const RoaringBitmap& a, const RoaringBitmap& b);
+    // One pass over all the sets instead of a chain of pairwise unions.
+    static RoaringBitmap uniteAll(const std::vector<const RoaringBitmap*>& sets);
+    // Rows of a that are not in b.
+    static RoaringBitmap subtract(const RoaringBitmap& a, const RoaringBitmap& b);
+    // Rows 0 .. rows-1 that are not in a.
+    static RoaringBitmap complement(const RoaringBitmap& a, std::size_t rows);
+    // Size of intersect(a, b) without building it.
+    static std::size_t intersectCount(const RoaringBitmap& a, const RoaringBitmap& b);
+
+private:
+    struct Container {
+        std::uint16_t key = 0;
+        std::uint32_t count = 0;
+        std::vector<std::uint16_t> array;   // sorted, while the container is sparse
+        std::vector<std::uint64_t> words;   // the bitmap once it is dense
+
+        bool isBitmap() const { return !words.empty(); }
+    };
+
+    std::vector<Container> containers;     // ordered by key
+    std::size_t total = 0;
+
+    Container* find(std::uint16_t key);
+    const Container* find(std::uint16_t key) const;
+
+    static void toBitmap(Container& c);
+    static void toArray(Container& c);
+    // Picks the representation for a freshly built container.
+    static void settle(Container& c);
+
+    static bool containsLow(const Container& c, std::uint16_t low);
+    static Container intersectContainers(const Container& a, const Container& b);
+    static Container uniteContainers(const Container& a, const Container& b);
+    static Container subtractContainers(const Container& a, const Container& b);
+    static std::size_t intersectCountContainers(const Container& a, const Container& b);
+};
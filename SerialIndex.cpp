@@ -0,0 +1,149 @@
+#include "SerialIndex.h"
+
+#include <cstring>
+#include <functional>
+
+namespace {
+    constexpr std::size_t kMinCapacity = 16;
+
+    // Max load factor 7/8 keeps probe sequences short with linear probing.
+    bool overLoaded(std::size_t count, std::size_t capacity) {
+        return count * 8 >= capacity * 7;
+    }
+}
+
+SerialIndex::SerialIndex()
+    : count(0) {
+}
+
+std::uint64_t SerialIndex::hashOf(std::string_view serial) {
+    return std::hash<std::string_view>{}(serial);
+}
+
+bool SerialIndex::isEmpty(const Slot& slot) {
+    return slot.data == nullptr;
+}
+
+std::size_t SerialIndex::findSlot(std::string_view serial, std::uint64_t hash) const {
+    if (slots.empty())
+        return npos;
+
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& s = slots[i];
+        if (isEmpty(s))
+            return npos;
+
+        if (s.hash == hash && s.length == serial.size() &&
+            std::memcmp(s.data, serial.data(), serial.size()) == 0)
+            return i;
+    }
+}
+
+std::size_t SerialIndex::find(std::string_view serial) const {
+    std::size_t slot = findSlot(serial, hashOf(serial));
+    if (slot == npos)
+        return npos;
+    return slots[slot].position;
+}
+
+bool SerialIndex::insert(std::string_view serial, std::size_t position) {
+    if (serial.empty())
+        return false;
+
+    if (overLoaded(count + 1, slots.size()))
+        grow(slots.size() * 2);
+
+    const std::uint64_t hash = hashOf(serial);
+    const std::size_t mask = slots.size() - 1;
+
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot& s = slots[i];
+        if (isEmpty(s)) {
+            s.data = serial.data();
+            s.length = static_cast<std::uint32_t>(serial.size());
+            s.position = static_cast<std::uint32_t>(position);
+            s.hash = hash;
+            ++count;
+            return true;
+        }
+
+        if (s.hash == hash && s.length == serial.size() &&
+            std::memcmp(s.data, serial.data(), serial.size()) == 0)
+            return false;
+    }
+}
+
+bool SerialIndex::erase(std::string_view serial) {
+    std::size_t hole = findSlot(serial, hashOf(serial));
+    if (hole == npos)
+        return false;
+
+    // Backward-shift deletion: pull later members of the probe chain into the
+    // hole so no tombstones are needed.
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t i = (hole + 1) & mask; !isEmpty(slots[i]); i = (i + 1) & mask) {
+        std::size_t home = slots[i].hash & mask;
+        bool movable = (hole <= i) ? (home <= hole || home > i) : (home <= hole && home > i);
+        if (movable) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+
+    slots[hole] = Slot{};
+    --count;
+    return true;
+}
+
+bool SerialIndex::setPosition(std::string_view serial, std::size_t position) {
+    std::size_t slot = findSlot(serial, hashOf(serial));
+    if (slot == npos)
+        return false;
+
+    slots[slot].position = static_cast<std::uint32_t>(position);
+    return true;
+}
+
+void SerialIndex::clear() {
+    slots.clear();
+    count = 0;
+}
+
+void SerialIndex::reserve(std::size_t wanted) {
+    std::size_t capacity = slots.empty() ? kMinCapacity : slots.size();
+    while (overLoaded(wanted, capacity))
+        capacity *= 2;
+
+    if (capacity > slots.size())
+        grow(capacity);
+}
+
+std::size_t SerialIndex::size() const {
+    return count;
+}
+
+std::size_t SerialIndex::bytes() const {
+    return slots.capacity() * sizeof(Slot);
+}
+
+void SerialIndex::grow(std::size_t minCapacity) {
+    std::size_t capacity = kMinCapacity;
+    while (capacity < minCapacity)
+        capacity *= 2;
+
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(capacity, Slot{});
+
+    const std::size_t mask = capacity - 1;
+    for (const Slot& s : old) {
+        if (isEmpty(s))
+            continue;
+
+        std::size_t i = s.hash & mask;
+        while (!isEmpty(slots[i]))
+            i = (i + 1) & mask;
+        slots[i] = s;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Flat open-addressing hash table (linear probing, backward-shift deletion)
+// that maps a serial number to the position of its product in Inventory.
+// Keys are views into the product's own serial string, so the product must
+// outlive its entry and lookups never allocate.
+class SerialIndex {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    SerialIndex();
+
+    std::size_t find(std::string_view serial) const;
+
+    bool insert(std::string_view serial, std::size_t position);
+    bool erase(std::string_view serial);
+    bool setPosition(std::string_view serial, std::size_t position);
+
+    void clear();
+    void reserve(std::size_t count);
+    std::size_t size() const;
+    // Heap bytes held by the table; the keys belong to the products.
+    std::size_t bytes() const;
+
+private:
+    struct Slot {
+        const char* data = nullptr;
+        std::uint32_t length = 0;
+        std::uint32_t position = 0;
+        std::uint64_t hash = 0;
+    };
+
+    std::vector<Slot> slots;
+    std::size_t count;
+
+    static std::uint64_t hashOf(std::string_view serial);
+    static bool isEmpty(const Slot& slot);
+
+    std::size_t findSlot(std::string_view serial, std::uint64_t hash) const;
+    void grow(std::size_t minCapacity);
+};
@@ -0,0 +1,89 @@
+#include "ShardedMutex.h"
+
+#include <functional>
+#include <thread>
+
+std::size_t ShardedMutex::shardOf(std::string_view serial) const {
+    return std::hash<std::string_view>()(serial) % kShardCount;
+}
+
+std::size_t ShardedMutex::shardOfThisThread() const {
+    return std::hash<std::thread::id>()(std::this_thread::get_id()) % kShardCount;
+}
+
+// Always in index order, so two writers cannot deadlock.
+void ShardedMutex::lock() {
+    for (auto& s : shards)
+        s.mutex.lock();
+}
+
+void ShardedMutex::unlock() {
+    for (auto it = shards.rbegin(); it != shards.rend(); ++it)
+        it->mutex.unlock();
+}
+
+void ShardedMutex::lock_shared() {
+    for (auto& s : shards)
+        s.mutex.lock_shared();
+}
+
+void ShardedMutex::unlock_shared() {
+    for (auto it = shards.rbegin(); it != shards.rend(); ++it)
+        it->mutex.unlock_shared();
+}
+
+void ShardedMutex::lockShard(std::size_t shard) {
+    shards[shard].mutex.lock();
+}
+
+void ShardedMutex::unlockShard(std::size_t shard) {
+    shards[shard].mutex.unlock();
+}
+
+void ShardedMutex::lockShardShared(std::size_t shard) {
+    shards[shard].mutex.lock_shared();
+}
+
+void ShardedMutex::unlockShardShared(std::size_t shard) {
+    shards[shard].mutex.unlock_shared();
+}
+
+void ShardedMutex::lockShards(const ShardSet& set) {
+    for (std::size_t i = 0; i < kShardCount; i++) {
+        if (set.test(i))
+            shards[i].mutex.lock();
+    }
+}
+
+void ShardedMutex::unlockShards(const ShardSet& set) {
+    for (std::size_t i = kShardCount; i-- > 0;) {
+        if (set.test(i))
+            shards[i].mutex.unlock();
+    }
+}
+
+// ===================== GUARDS =====================
+
+ShardLock::ShardLock(ShardedMutex& mutex, std::size_t shard, Mode mode)
+    : mutex(mutex), shard(shard), mode(mode) {
+    if (mode == Exclusive)
+        mutex.lockShard(shard);
+    else
+        mutex.lockShardShared(shard);
+}
+
+ShardLock::~ShardLock() {
+    if (mode == Exclusive)
+        mutex.unlockShard(shard);
+    else
+        mutex.unlockShardShared(shard);
+}
+
+ShardSetLock::ShardSetLock(ShardedMutex& mutex, const ShardedMutex::ShardSet& set)
+    : mutex(mutex), set(set) {
+    mutex.lockShards(set);
+}
+
+ShardSetLock::~ShardSetLock() {
+    mutex.unlockShards(set);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <shared_mutex>
+#include <string_view>
+
+// Reader/writer lock split into cache-line-sized shards keyed by serial.
+// Operations on one product lock only its shard; structural changes take
+// every shard (lock()/unlock(), so std::lock_guard works), which excludes
+// all other users at once.
+class ShardedMutex {
+public:
+    static constexpr std::size_t kShardCount = 64;
+
+    std::size_t shardOf(std::string_view serial) const;
+    // Spreads whole-inventory readers across shards instead of piling onto one.
+    std::size_t shardOfThisThread() const;
+
+    void lock();
+    void unlock();
+    // Shared on every shard (std::shared_lock works): blocks writers, not readers.
+    void lock_shared();
+    void unlock_shared();
+
+    void lockShard(std::size_t shard);
+    void unlockShard(std::size_t shard);
+    void lockShardShared(std::size_t shard);
+    void unlockShardShared(std::size_t shard);
+
+    using ShardSet = std::bitset<kShardCount>;
+    // Exclusive on every shard in the set, taken in index order like lock().
+    void lockShards(const ShardSet& set);
+    void unlockShards(const ShardSet& set);
+
+private:
+    struct alignas(64) Shard {
+        std::shared_mutex mutex;
+    };
+
+    std::array<Shard, kShardCount> shards;
+};
+
+// Holds one shard, exclusively or shared, for the guard's lifetime.
+class ShardLock {
+public:
+    enum Mode { Exclusive, Shared };
+
+    ShardLock(ShardedMutex& mutex, std::size_t shard, Mode mode);
+    ~ShardLock();
+
+    ShardLock(const ShardLock&) = delete;
+    ShardLock& operator=(const ShardLock&) = delete;
+
+private:
+    ShardedMutex& mutex;
+    std::size_t shard;
+    Mode mode;
+};
+
+// Holds a set of shards exclusively for the guard's lifetime.
+class ShardSetLock {
+public:
+    ShardSetLock(ShardedMutex& mutex, const ShardedMutex::ShardSet& set);
+    ~ShardSetLock();
+
+    ShardSetLock(const ShardSetLock&) = delete;
+    ShardSetLock& operator=(const ShardSetLock&) = delete;
+
+private:
+    ShardedMutex& mutex;
+    ShardedMutex::ShardSet set;
+};
@@ -0,0 +1,175 @@
+#include "Snapshot.h"
+
+#include <cstring>
+#include <filesystem>
+
+#include "Crc32.h"
+#include "CrashPoint.h"
+#include "DurableFile.h"
+#include "MappedFile.h"
+#include "MemoryAccounting.h"
+#include "ProductCodec.h"
+#include "Trace.h"
+
+namespace {
+    const char kMagic[8] = { 'T', 'W', 'S', 'N', 'A', 'P', '\0', '\0' };
+
+    std::size_t headerSize(std::uint32_t version) {
+        return version >= 2 ? 48 : 40;
+    }
+
+    std::string buildHeader(std::uint64_t count, std::uint64_t payloadSize, std::uint32_t payloadCrc,
+        std::uint64_t journalSequence) {
+        std::string header;
+        BinaryWriter head(header);
+        header.append(kMagic, sizeof kMagic);
+        head.u32(Snapshot::kVersion);
+        head.u32(0);
+        head.u64(count);
+        head.u64(payloadSize);
+        head.u64(journalSequence);
+        head.u32(payloadCrc);
+        head.u32(crc32(header.data(), header.size()));
+        return header;
+    }
+}
+
+bool Snapshot::write(const std::string& file, const std::vector<std::shared_ptr<Product>>& products,
+    std::uint64_t journalSequence) {
+    std::string payload;
+    BinaryWriter body(payload);
+    for (const auto& p : products) {
+        if (!ProductCodec::encode(*p, body))
+            return false;
+    }
+
+    return writeFile(file, products.size(), payload, journalSequence);
+}
+
+bool Snapshot::write(const std::string& file, const Image& image) {
+    MemoryAccounting::Scope memory(MemorySubsystem::Snapshot);
+    std::string payload;
+    {
+        Trace::Span span("encodeProducts", "save");
+        BinaryWriter body(payload);
+        for (std::size_t i = 0; i < image.products.size(); i++) {
+            if (!ProductCodec::encode(*image.products[i], image.quantities[i], body))
+                return false;
+        }
+        span.arg("products", image.products.size());
+        span.arg("bytes", payload.size());
+    }
+
+    return writeFile(file, image.products.size(), payload, image.journalSequence);
+}
+
+bool Snapshot::writeFile(const std::string& file, std::uint64_t count, const std::string& payload,
+    std::uint64_t journalSequence) {
+    Trace::Span span("writeSnapshot", "save");
+    span.arg("bytes", payload.size());
+    SnapshotWriter writer;
+    return writer.open(file, journalSequence) &&
+        writer.append(payload, count) &&
+        writer.finish();
+}
+
+bool Snapshot::read(const std::string& file, std::vector<std::shared_ptr<Product>>& out, LoadStats& stats) {
+    MappedFile map;
+    if (!map.open(file) || map.size() < headerSize(1))
+        return false;
+
+    if (std::memcmp(map.data(), kMagic, sizeof kMagic) != 0)
+        return false;
+
+    BinaryReader head(map.data() + sizeof kMagic, map.size() - sizeof kMagic);
+    std::uint32_t version, reserved, payloadCrc, headerCrc;
+    std::uint64_t count, payloadSize, journalSequence = 0;
+
+    if (!head.u32(version) || !head.u32(reserved) || !head.u64(count) || !head.u64(payloadSize))
+        return false;
+
+    if (version < 1 || version > kVersion)
+        return false;
+
+    if (version >= 2 && !head.u64(journalSequence))
+        return false;
+
+    if (!head.u32(payloadCrc) || !head.u32(headerCrc))
+        return false;
+
+    const std::size_t size = headerSize(version);
+    if (crc32(map.data(), size - 4) != headerCrc)
+        return false;
+
+    if (map.size() < size || payloadSize != map.size() - size)
+        return false;
+
+    const char* payload = map.data() + size;
+    {
+        Trace::Span span("verifyChecksum", "load");
+        span.arg("bytes", payloadSize);
+        if (crc32(payload, static_cast<std::size_t>(payloadSize)) != payloadCrc)
+            return false;
+    }
+
+    Trace::Span span("decodeProducts", "load");
+    MemoryAccounting::Scope memory(MemorySubsystem::Products);
+    span.arg("products", count);
+    out.clear();
+    out.reserve(static_cast<std::size_t>(count));
+
+    BinaryReader body(payload, static_cast<std::size_t>(payloadSize));
+    for (std::uint64_t i = 0; i < count; i++) {
+        auto product = ProductCodec::decode(body);
+        if (!product)
+            return false;
+        out.push_back(std::move(product));
+    }
+
+    stats.records = out.size();
+    stats.bytes = map.size();
+    stats.sequence = journalSequence;
+    return body.remaining() == 0;
+}
+
+// ===================== STREAMING WRITER =====================
+
+bool SnapshotWriter::open(const std::string& target, std::uint64_t sequence) {
+    file = target;
+    journalSequence = sequence;
+    count = 0;
+    payloadSize = 0;
+    payloadCrc = 0;
+
+    // A placeholder until finish(); its header CRC cannot match yet.
+    const std::string header(headerSize(Snapshot::kVersion), '\0');
+    return out.open(file + ".tmp", DurableFile::Mode::Truncate) &&
+        out.write(header.data(), header.size());
+}
+
+bool SnapshotWriter::append(const std::string& records, std::uint64_t recordCount) {
+    if (!out.write(records.data(), records.size()))
+        return false;
+
+    payloadCrc = crc32(records.data(), records.size(), payloadCrc);
+    payloadSize += records.size();
+    count += recordCount;
+    return true;
+}
+
+bool SnapshotWriter::finish() {
+    const std::string header = buildHeader(count, payloadSize, payloadCrc, journalSequence);
+    if (!out.writeAt(0, header.data(), header.size()) || !out.sync())
+        return false;
+    out.close();
+    CrashPoint::hit("snapshot.synced");
+
+    std::error_code ec;
+    std::filesystem::rename(file + ".tmp", file, ec);
+    if (ec)
+        return false;
+    CrashPoint::hit("snapshot.renamed");
+
+    DurableFile::syncParentDirectory(file);
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DurableFile.h"
+#include "LoadStats.h"
+#include "Product.h"
+
+// Versioned, checksummed binary image of the inventory. Layout:
+//
+//   char[8] magic "TWSNAP\0\0"
+//   u32     version
+//   u32     reserved (0)
+//   u64     product count
+//   u64     payload size in bytes
+//   u64     journal sequence the image includes (version 2+)
+//   u32     CRC-32 of the payload
+//   u32     CRC-32 of the preceding header bytes
+//   ...     payload: product records in ProductCodec format
+//
+// Version 1 files lack the journal sequence and are read as sequence 0.
+// Files are written next to the target and renamed over it, so readers
+// never observe a half-written snapshot.
+class Snapshot {
+public:
+    static constexpr std::uint32_t kVersion = 2;
+
+    // Point-in-time copy taken by a checkpoint. Products are replaced rather
+    // than edited, except for their quantity, which is copied alongside.
+    struct Image {
+        std::vector<std::shared_ptr<Product>> products;
+        std::vector<int> quantities;
+        std::uint64_t journalSequence = 0;
+    };
+
+    static bool write(const std::string& file, const std::vector<std::shared_ptr<Product>>& products,
+        std::uint64_t journalSequence = 0);
+    static bool write(const std::string& file, const Image& image);
+
+    // Maps the file and decodes it in place. Fails (leaving `out`
+    // unspecified) on a bad magic, unknown version or checksum mismatch.
+    // The stored journal sequence is returned in stats.sequence.
+    static bool read(const std::string& file, std::vector<std::shared_ptr<Product>>& out, LoadStats& stats);
+
+private:
+    static bool writeFile(const std::string& file, std::uint64_t count, const std::string& payload,
+        std::uint64_t journalSequence);
+};
+
+// Writes a snapshot from pieces, so a large one never has to sit in memory
+// whole. The header is filled in by finish(), which then renames the file
+// into place like Snapshot::write.
+class SnapshotWriter {
+public:
+    bool open(const std::string& file, std::uint64_t journalSequence = 0);
+    // `records` holds `count` products in ProductCodec format.
+    bool append(const std::string& records, std::uint64_t count);
+    bool finish();
+
+private:
+    std::string file;
+    DurableFile out;
+    std::uint64_t journalSequence = 0;
+    std::uint64_t count = 0;
+    std::uint64_t payloadSize = 0;
+    std::uint32_t payloadCrc = 0;
+};
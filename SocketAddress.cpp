@@ -0,0 +1,136 @@
+#include "SocketAddress.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+bool SocketAddress::parse(const std::string& text, SocketAddress& out) {
+    if (text.compare(0, 5, "unix:") == 0 && text.size() > 5) {
+        out.kind = Kind::Unix;
+        out.path = text.substr(5);
+        return true;
+    }
+
+    if (text.compare(0, 4, "tcp:") == 0 && text.size() > 4) {
+        unsigned long port = 0;
+        for (std::size_t i = 4; i < text.size(); i++) {
+            if (text[i] < '0' || text[i] > '9')
+                return false;
+            port = port * 10 + static_cast<unsigned long>(text[i] - '0');
+            if (port > 65535)
+                return false;
+        }
+        if (port == 0)
+            return false;
+        out.kind = Kind::Tcp;
+        out.port = static_cast<std::uint16_t>(port);
+        return true;
+    }
+    return false;
+}
+
+std::string SocketAddress::describe() const {
+    return kind == Kind::Unix ? "unix:" + path : "tcp:127.0.0.1:" + std::to_string(port);
+}
+
+#ifdef _WIN32
+
+int SocketAddress::listen() const {
+    return -1;
+}
+
+int SocketAddress::connect() const {
+    return -1;
+}
+
+void SocketAddress::unlink() const {
+}
+
+#else
+
+namespace {
+    bool fillUnix(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        std::memcpy(address.sun_path, path.data(), path.size());
+        return true;
+    }
+
+    void fillTcp(std::uint16_t port, sockaddr_in& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+}
+
+int SocketAddress::listen() const {
+    const int fd = ::socket(kind == Kind::Unix ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    int bound = -1;
+    if (kind == Kind::Unix) {
+        sockaddr_un address;
+        if (fillUnix(path, address)) {
+            ::unlink(path.c_str());
+            bound = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        }
+    }
+    else {
+        const int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address;
+        fillTcp(port, address);
+        bound = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    }
+
+    if (bound != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int SocketAddress::connect() const {
+    const int fd = ::socket(kind == Kind::Unix ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    int connected = -1;
+    if (kind == Kind::Unix) {
+        sockaddr_un address;
+        if (fillUnix(path, address))
+            connected = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    }
+    else {
+        sockaddr_in address;
+        fillTcp(port, address);
+        connected = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        if (connected == 0) {
+            const int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+    }
+
+    if (connected != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void SocketAddress::unlink() const {
+    if (kind == Kind::Unix)
+        ::unlink(path.c_str());
+}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Where the server listens and the load generator connects: "unix:<path>"
+// for a Unix domain socket, or "tcp:<port>" for TCP on 127.0.0.1 only.
+// Sockets are POSIX; on Windows listen() and connect() fail.
+struct SocketAddress {
+    enum class Kind { Unix, Tcp };
+
+    Kind kind = Kind::Tcp;
+    std::string path;
+    std::uint16_t port = 0;
+
+    static bool parse(const std::string& text, SocketAddress& out);
+    std::string describe() const;
+
+    // A non-blocking listening socket, or -1. A stale Unix socket file left
+    // by an earlier run is replaced.
+    int listen() const;
+    // A blocking connected socket, or -1.
+    int connect() const;
+    // Removes the Unix socket file; nothing for TCP.
+    void unlink() const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One line of a stock movement batch (a received pallet, a shipped order).
+struct StockOperation {
+    enum Kind { In, Out };
+
+    Kind kind;
+    std::string serial;
+    int amount;
+};
+
+enum class StockLineStatus {
+    Ok,
+    NotFound,
+    InvalidAmount,
+    InsufficientStock
+};
+
+// Lines are checked in order against the quantities the earlier lines
+// would leave. The batch is applied only if every line is Ok.
+struct BatchResult {
+    bool applied = false;
+    // Every line was Ok, but the journal refused the batch (not applied),
+    // or lost it to a failed fsync once it was applied.
+    bool journalFailed = false;
+    std::vector<StockLineStatus> lines;
+
+    std::size_t failedLines() const {
+        std::size_t failed = 0;
+        for (StockLineStatus s : lines) {
+            if (s != StockLineStatus::Ok)
+                failed++;
+        }
+        return failed;
+    }
+};
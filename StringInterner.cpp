@@ -0,0 +1,75 @@
+#include "StringInterner.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+    constexpr std::size_t kShardCount = 16;
+
+    // Keys are views into the owned strings, so lookups need no allocation.
+    struct alignas(64) Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string_view, std::unique_ptr<std::string>> strings;
+    };
+
+    struct Pool {
+        std::array<Shard, kShardCount> shards;
+        std::atomic<std::size_t> count{ 0 };
+        std::atomic<std::size_t> bytes{ 0 };
+    };
+
+    // Never destroyed: products held in static storage may still refer to it
+    // while other statics are torn down.
+    Pool& pool() {
+        static Pool* instance = new Pool();
+        return *instance;
+    }
+}
+
+const std::string* StringInterner::find(std::string_view text) {
+    Shard& shard = pool().shards[std::hash<std::string_view>()(text) % kShardCount];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.strings.find(text);
+    return it != shard.strings.end() ? it->second.get() : nullptr;
+}
+
+const std::string& StringInterner::intern(std::string_view text) {
+    Pool& p = pool();
+    Shard& shard = p.shards[std::hash<std::string_view>()(text) % kShardCount];
+
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.strings.find(text);
+        if (it != shard.strings.end())
+            return *it->second;
+    }
+
+    std::lock_guard<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.strings.find(text);
+    if (it != shard.strings.end())
+        return *it->second;
+
+    auto owned = std::make_unique<std::string>(text);
+    const std::string& stored = *owned;
+    shard.strings.emplace(std::string_view(stored), std::move(owned));
+    p.count.fetch_add(1, std::memory_order_relaxed);
+    p.bytes.fetch_add(stored.size(), std::memory_order_relaxed);
+    return stored;
+}
+
+const std::string& StringInterner::empty() {
+    static const std::string& instance = intern(std::string_view());
+    return instance;
+}
+
+std::size_t StringInterner::size() {
+    return pool().count.load(std::memory_order_relaxed);
+}
+
+std::size_t StringInterner::bytes() {
+    return pool().bytes.load(std::memory_order_relaxed);
+}
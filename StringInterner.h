@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Process-wide pool of distinct strings. Each distinct text is stored once
+// and never freed, so the returned reference stays valid for the life of
+// the program. Safe to use from several threads at once.
+class StringInterner {
+public:
+    static const std::string& intern(std::string_view text);
+    // The interned copy of `text`, or null if it was never interned. Never
+    // adds to the pool: use it for lookups with text from outside, such as
+    // query values, which would otherwise stay in the pool for good.
+    static const std::string* find(std::string_view text);
+    static const std::string& empty();
+
+    // Distinct strings held, and the bytes of text they hold.
+    static std::size_t size();
+    static std::size_t bytes();
+};
+
+// A pointer-sized handle to an interned string. Two handles are equal
+// exactly when their texts are, so comparing them is one pointer compare.
+class InternedString {
+public:
+    InternedString() : text(&StringInterner::empty()) {}
+    InternedString(std::string_view value) : text(&StringInterner::intern(value)) {}
+    InternedString(const std::string& value) : InternedString(std::string_view(value)) {}
+    InternedString(const char* value) : InternedString(std::string_view(value)) {}
+    // `interned` must come from StringInterner.
+    static InternedString fromInterned(const std::string& interned) { return InternedString(&interned); }
+
+    const std::string& str() const { return *text; }
+    operator const std::string&() const { return *text; }
+    bool empty() const { return text->empty(); }
+
+    bool operator==(const InternedString& other) const { return text == other.text; }
+    bool operator!=(const InternedString& other) const { return text != other.text; }
+
+    std::size_t hash() const { return std::hash<const std::string*>()(text); }
+
+private:
+    explicit InternedString(const std::string* interned) : text(interned) {}
+
+    const std::string* text;
+};
+
+namespace std {
+    template <>
+    struct hash<InternedString> {
+        std::size_t operator()(const InternedString& s) const { return s.hash(); }
+    };
+}
@@ -1,20 +1,350 @@
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include "BatchRunner.h"
 #include "Inventory.h"
+#include "Checkpointer.h"
 #include "ConsoleMenu.h"
+#include "InventoryServer.h"
+#include "Journal.h"
+#include "MetricsExporter.h"
+#include "Trace.h"
 
-int main() {
-    Inventory inventory;
+static const std::string kDataFile = "warehouse.json";
+static const std::string kSnapshotFile = "warehouse.snap";
+static const std::string kJournalFile = "warehouse.journal";
+
+static bool isSnapshotPath(const std::string& path) {
+    const std::string ext = ".snap";
+    return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+static bool loadAny(Inventory& inventory, const std::string& path) {
+    return isSnapshotPath(path) ? inventory.loadSnapshot(path) : inventory.loadFromFile(path);
+}
+
+static bool saveAny(Inventory& inventory, const std::string& path) {
+    return isSnapshotPath(path) ? inventory.saveSnapshot(path) : inventory.saveToFile(path);
+}
+
+// The snapshot (plus journal) wins unless warehouse.json was edited after both.
+static bool snapshotIsCurrent() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    if (!fs::exists(kSnapshotFile, ec))
+        return false;
+    if (!fs::exists(kDataFile, ec))
+        return true;
+
+    auto snapshotTime = fs::last_write_time(kSnapshotFile, ec);
+    auto jsonTime = fs::last_write_time(kDataFile, ec);
+    if (ec)
+        return false;
+
+    auto journalTime = Journal::lastWriteTime(kJournalFile);
+    if (journalTime > snapshotTime)
+        snapshotTime = journalTime;
+
+    return snapshotTime >= jsonTime;
+}
+
+static bool parseJournalSync(const std::string& name, JournalSync& sync) {
+    if (name == "every")
+        sync = JournalSync::EveryOperation;
+    else if (name == "group")
+        sync = JournalSync::GroupCommit;
+    else if (name == "periodic")
+        sync = JournalSync::Periodic;
+    else
+        return false;
+    return true;
+}
+
+static void printLoadStats(const Inventory& inventory, const std::string& file, std::ostream& log = std::cout) {
+    const LoadStats& stats = inventory.getLastLoadStats();
+    log << "Loaded " << stats.loaded << " products from " << file
+        << " (" << stats.skipped << " skipped) in " << stats.seconds * 1000.0 << " ms: "
+        << stats.recordsPerSecond() << " records/s, "
+        << stats.megabytesPerSecond() << " MB/s\n";
+}
+
+static bool parseLayout(const std::string& name, ProductRenderer::Layout& layout) {
+    if (name == "detailed")
+        layout = ProductRenderer::Layout::Detailed;
+    else if (name == "table")
+        layout = ProductRenderer::Layout::Table;
+    else
+        return false;
+    return true;
+}
 
-    if (!inventory.loadFromFile("warehouse.json")) {
-        std::cout << "Failed to load data file. Starting with empty inventory.\n";
+static bool parseCount(const std::string& text, std::uint64_t& value) {
+    try {
+        std::size_t used = 0;
+        value = std::stoull(text, &used);
+        return used == text.size();
     }
+    catch (...) {
+        return false;
+    }
+}
+
+static void printUsage() {
+    std::cout << "Usage: TechWarehouse [--journal-sync every|group|periodic]\n"
+        << "                     [--checkpoint-mb <journal MB>] [--checkpoint-age <seconds>]\n"
+        << "                     [--list detailed|table] [--page-size <products>]\n"
+        << "                     [--metrics-file <prometheus file>] [--metrics-interval <seconds>]\n"
+        << "                     [--trace <trace file>]\n"
+        << "                     [--batch <commands file, or - for stdin>]\n"
+        << "                     [--serve unix:<path>|tcp:<port>] [--workers <threads>]\n"
+        << "       TechWarehouse --convert <from> <to>\n"
+        << "\n--journal-sync: every syncs each change before it returns; group (default)\n"
+        << "and periodic acknowledge changes first, so the last 100 ms of them can be\n"
+        << "lost: group holds up to 64 in memory (lost even if only the process dies),\n"
+        << "periodic hands them to the OS at once (lost on an OS crash or power cut).\n";
+}
+
+// --convert <from> <to>: JSON <-> snapshot, chosen by the .snap extension.
+static int convert(const std::string& from, const std::string& to) {
+    Inventory inventory;
 
-    ConsoleMenu menu(inventory);
-    menu.run();
+    if (!loadAny(inventory, from)) {
+        std::cout << "Failed to load " << from << ".\n";
+        return 1;
+    }
+    printLoadStats(inventory, from);
 
-    if (!inventory.saveToFile("warehouse.json")) {
-        std::cout << "Failed to save data file.\n";
+    if (!saveAny(inventory, to)) {
+        std::cout << "Failed to write " << to << ".\n";
+        return 1;
     }
 
+    std::cout << "Wrote " << to << ".\n";
     return 0;
 }
+
+static void finishTrace(const std::string& file, std::ostream& log) {
+    if (file.empty())
+        return;
+
+    if (Trace::stop())
+        log << "Trace written to " << file << ".\n";
+    else
+        log << "Failed to write trace " << file << ".\n";
+}
+
+static InventoryServer* runningServer = nullptr;
+
+static void stopServer(int) {
+    if (runningServer)
+        runningServer->requestStop();
+}
+
+// --serve: the batch protocol over a socket until SIGINT or SIGTERM.
+static bool runServer(Inventory& inventory, const SocketAddress& address, const ServerOptions& options) {
+    InventoryServer server(inventory, kSnapshotFile, options);
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+
+    std::cout << "Serving on " << address.describe() << "; Ctrl+C stops.\n" << std::flush;
+    bool served = server.run(address);
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    runningServer = nullptr;
+
+    if (!served) {
+        std::cout << "Failed to listen on " << address.describe() << ".\n";
+        return false;
+    }
+
+    ServerStats stats = server.getStats();
+    std::cout << "Served " << stats.requests << " requests (" << stats.failed << " failed) on "
+        << stats.connections << " connections.\n";
+    return true;
+}
+
+// --batch: commands from a file or stdin, one JSON result line each on stdout.
+static bool runBatch(Inventory& inventory, const std::string& source) {
+    BatchRunner runner(inventory, kSnapshotFile);
+    BatchSummary summary;
+
+    if (source == "-") {
+        std::ios::sync_with_stdio(false);
+        summary = runner.run(std::cin, std::cout);
+    }
+    else {
+        std::ifstream in(source, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open " << source << ".\n";
+            return false;
+        }
+        summary = runner.run(in, std::cout);
+    }
+
+    std::cerr << "Batch: " << summary.commands << " commands, " << summary.succeeded << " ok, "
+        << summary.failed << " failed in " << summary.seconds << " s\n";
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // TW_TRACE=<file> traces any run, --convert included; --trace overrides it.
+    std::string traceFile;
+    if (const char* env = std::getenv("TW_TRACE"))
+        traceFile = env;
+
+    if (argc == 4 && std::string(argv[1]) == "--convert") {
+        if (!traceFile.empty())
+            Trace::start(traceFile);
+        int status = convert(argv[2], argv[3]);
+        finishTrace(traceFile, std::cout);
+        return status;
+    }
+
+    JournalOptions journalOptions;
+    CheckpointOptions checkpointOptions;
+    DisplayOptions display;
+    std::string metricsFile;
+    std::chrono::seconds metricsInterval{ 10 };
+    std::string batchSource;
+    SocketAddress serveAddress;
+    bool serve = false;
+    ServerOptions serverOptions;
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = i + 1 < argc ? argv[i + 1] : "";
+        std::uint64_t n = 0;
+
+        if (option == "--journal-sync" && parseJournalSync(value, journalOptions.sync))
+            continue;
+        if (option == "--checkpoint-mb" && parseCount(value, n) && n > 0) {
+            checkpointOptions.maxJournalBytes = n * 1024 * 1024;
+            continue;
+        }
+        if (option == "--checkpoint-age" && parseCount(value, n) && n > 0) {
+            checkpointOptions.maxAge = std::chrono::seconds(n);
+            continue;
+        }
+        if (option == "--list" && parseLayout(value, display.layout))
+            continue;
+        if (option == "--page-size" && parseCount(value, n)) {
+            display.pageSize = static_cast<std::size_t>(n);
+            continue;
+        }
+        if (option == "--metrics-file" && !value.empty()) {
+            metricsFile = value;
+            continue;
+        }
+        if (option == "--metrics-interval" && parseCount(value, n) && n > 0) {
+            metricsInterval = std::chrono::seconds(n);
+            continue;
+        }
+        if (option == "--trace" && !value.empty()) {
+            traceFile = value;
+            continue;
+        }
+        if (option == "--batch" && !value.empty()) {
+            batchSource = value;
+            continue;
+        }
+        if (option == "--serve" && SocketAddress::parse(value, serveAddress)) {
+            serve = true;
+            continue;
+        }
+        if (option == "--workers" && parseCount(value, n) && n > 0) {
+            serverOptions.workers = static_cast<std::size_t>(n);
+            continue;
+        }
+
+        printUsage();
+        return 1;
+    }
+
+    // Batch results own stdout; everything else goes to stderr there.
+    std::ostream& log = batchSource.empty() ? std::cout : std::cerr;
+
+    if (!traceFile.empty())
+        Trace::start(traceFile);
+
+    MetricsExporter metricsExporter(metricsFile, metricsInterval);
+    if (!metricsFile.empty())
+        metricsExporter.start();
+
+    Inventory inventory;
+    bool needsCheckpoint = true;
+    std::uint64_t sequence = 0;
+
+    if (snapshotIsCurrent()) {
+        // The journal only makes sense on top of this snapshot; falling back
+        // to warehouse.json and checkpointing would delete it.
+        if (!inventory.loadSnapshot(kSnapshotFile)) {
+            log << "Failed to load " << kSnapshotFile << "; " << kJournalFile
+                << " is left untouched. Repair or remove the snapshot and restart.\n";
+            metricsExporter.stop();
+            finishTrace(traceFile, log);
+            return 1;
+        }
+        printLoadStats(inventory, kSnapshotFile, log);
+
+        JournalReplayStats replayed = Journal::replay(kJournalFile, inventory, inventory.getLastLoadStats().sequence);
+        sequence = replayed.lastSequence;
+        needsCheckpoint = replayed.tornTail;
+        if (replayed.applied || replayed.failed || replayed.tornTail) {
+            log << "Replayed " << replayed.applied << " journal records from " << kJournalFile
+                << " (" << replayed.failed << " failed" << (replayed.tornTail ? ", torn tail dropped" : "") << ").\n";
+        }
+    }
+    else if (inventory.loadFromFile(kDataFile)) {
+        printLoadStats(inventory, kDataFile, log);
+    }
+    else {
+        log << "Failed to load data file. Starting with empty inventory.\n";
+    }
+
+    Journal journal;
+    Checkpointer checkpointer(inventory, journal, kSnapshotFile, checkpointOptions);
+    if (journal.open(kJournalFile, journalOptions, sequence)) {
+        inventory.setJournal(&journal);
+
+        // Segments left over from another base image, or past a gap that
+        // replay could not cross, must not be replayed onto this one.
+        if (needsCheckpoint && !inventory.checkpoint(kSnapshotFile))
+            log << "Failed to write " << kSnapshotFile << ".\n";
+
+        checkpointer.start();
+    }
+    else {
+        log << "Failed to open " << kJournalFile << "; changes are saved on exit only.\n";
+    }
+
+    int status = 0;
+    if (serve) {
+        if (!runServer(inventory, serveAddress, serverOptions))
+            status = 1;
+    }
+    else if (batchSource.empty()) {
+        ConsoleMenu menu(inventory, display);
+        menu.run();
+    }
+    else if (!runBatch(inventory, batchSource)) {
+        status = 1;
+    }
+
+    checkpointer.stop();
+    if (!inventory.checkpoint(kSnapshotFile)) {
+        log << "Failed to save data file.\n";
+    }
+
+    inventory.setJournal(nullptr);
+    if (journal.failedRecords())
+        log << journal.failedRecords() << " changes were refused or lost because " << kJournalFile << " could not be written.\n";
+    journal.close();
+    metricsExporter.stop();
+    finishTrace(traceFile, log);
+    return status;
+}
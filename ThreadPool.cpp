@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+
+#include <exception>
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers)
+        t.join();
+}
+
+std::size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// ===================== WORKERS =====================
+
+void ThreadPool::work() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+bool ThreadPool::runOne() {
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty())
+            return false;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+    }
+    job();
+    return true;
+}
+
+void ThreadPool::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+// ===================== PARALLEL FOR =====================
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& task) {
+    if (count == 0)
+        return;
+
+    struct Batch {
+        std::size_t remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    } batch;
+    batch.remaining = count;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::size_t i = 0; i < count; i++) {
+            jobs.emplace_back([&batch, &task, i] {
+                std::exception_ptr error;
+                try {
+                    task(i);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                // The batch lives on the caller's stack: touch it only under
+                // its mutex, which the caller takes before returning.
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                if (error && !batch.error)
+                    batch.error = error;
+                if (--batch.remaining == 0)
+                    batch.done.notify_all();
+            });
+        }
+    }
+    wake.notify_all();
+
+    // Help with the queue; once it is empty, wait for the stragglers.
+    while (runOne()) {
+    }
+    {
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.done.wait(lock, [&batch] { return batch.remaining == 0; });
+    }
+
+    if (batch.error)
+        std::rethrow_exception(batch.error);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one job queue.
+class ThreadPool {
+public:
+    // 0 means one worker per hardware thread.
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const;
+
+    // Runs task(0) .. task(count - 1) and returns once all have finished.
+    // The calling thread works on the queue too, so a task may call
+    // parallelFor itself. The first exception a task throws is rethrown here.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task);
+
+    // Queues `job` and returns at once. The job must not throw; jobs still
+    // queued when the pool is destroyed run before it finishes.
+    void post(std::function<void()> job);
+
+    // Process-wide pool sized to the machine.
+    static ThreadPool& shared();
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void work();
+    bool runOne();
+};
@@ -0,0 +1,175 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <memory>
+
+namespace {
+    // Never destroyed, like the metrics registry: pool threads may still end
+    // spans while statics are torn down.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Trace::Ring>> rings;
+        std::string file;
+        // steady_clock ticks at start(); read by every recording thread.
+        std::atomic<std::chrono::steady_clock::rep> origin{ 0 };
+    };
+
+    Registry& registry() {
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    struct Lane {
+        std::uint32_t lane;
+        Trace::Event event;
+    };
+
+    void appendNumber(std::string& out, std::uint64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    // Nanoseconds as microseconds with three decimals, the unit of "ts" and "dur".
+    void appendMicros(std::string& out, std::uint64_t nanos) {
+        appendNumber(out, nanos / 1000);
+        const unsigned fraction = static_cast<unsigned>(nanos % 1000);
+        out += '.';
+        out += static_cast<char>('0' + fraction / 100);
+        out += static_cast<char>('0' + fraction / 10 % 10);
+        out += static_cast<char>('0' + fraction % 10);
+    }
+}
+
+// ===================== RECORDING =====================
+
+void Trace::start(const std::string& file) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    for (const auto& ring : r.rings) {
+        std::lock_guard<std::mutex> ringLock(ring->mutex);
+        ring->written = 0;
+    }
+    r.file = file;
+    r.origin.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    recording.store(true, std::memory_order_release);
+}
+
+Trace::Ring* Trace::attach() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    for (const auto& ring : r.rings) {
+        if (!ring->inUse.load(std::memory_order_acquire)) {
+            ring->inUse.store(true, std::memory_order_relaxed);
+            return ring.get();
+        }
+    }
+
+    r.rings.push_back(std::unique_ptr<Ring>(new Ring()));
+    Ring* ring = r.rings.back().get();
+    ring->events.resize(kRingEvents);
+    ring->lane = static_cast<std::uint32_t>(r.rings.size());
+    ring->inUse.store(true, std::memory_order_relaxed);
+    return ring;
+}
+
+void Trace::record(const Span& span) {
+    thread_local RingLease lease;
+    if (!lease.ring)
+        lease.ring = attach();
+
+    const auto ended = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point origin(
+        std::chrono::steady_clock::duration(registry().origin.load(std::memory_order_relaxed)));
+    if (span.started < origin)
+        return;     // began before a restart of the trace
+
+    Ring& ring = *lease.ring;
+    std::lock_guard<std::mutex> lock(ring.mutex);
+
+    Event& e = ring.events[ring.written % kRingEvents];
+    e.name = span.name;
+    e.category = span.category;
+    e.startNanos = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(span.started - origin).count());
+    e.durationNanos = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(ended - span.started).count());
+    for (std::size_t i = 0; i < kMaxArgs; i++) {
+        e.argNames[i] = i < span.args ? span.argNames[i] : nullptr;
+        e.argValues[i] = i < span.args ? span.argValues[i] : 0;
+    }
+    ring.written++;
+}
+
+// ===================== OUTPUT =====================
+
+bool Trace::stop() {
+    if (!recording.exchange(false, std::memory_order_acq_rel))
+        return false;
+
+    Registry& r = registry();
+    std::vector<Lane> events;
+    std::uint64_t dropped = 0;
+    std::string file;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        file = r.file;
+
+        for (const auto& ring : r.rings) {
+            std::lock_guard<std::mutex> ringLock(ring->mutex);
+            const std::uint64_t kept = std::min<std::uint64_t>(ring->written, kRingEvents);
+            dropped += ring->written - kept;
+            for (std::uint64_t i = ring->written - kept; i < ring->written; i++)
+                events.push_back(Lane{ ring->lane, ring->events[i % kRingEvents] });
+            ring->written = 0;
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const Lane& a, const Lane& b) {
+        return a.event.startNanos < b.event.startNanos;
+    });
+
+    std::string out;
+    out.reserve(events.size() * 128 + 256);
+    out += "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":";
+    appendNumber(out, dropped);
+    out += "},\"traceEvents\":[\n";
+
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"TechWarehouse\"}}";
+    for (const Lane& lane : events) {
+        const Event& e = lane.event;
+        out += ",\n{\"name\":\"";
+        out += e.name;
+        out += "\",\"cat\":\"";
+        out += e.category;
+        out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        appendNumber(out, lane.lane);
+        out += ",\"ts\":";
+        appendMicros(out, e.startNanos);
+        out += ",\"dur\":";
+        appendMicros(out, e.durationNanos);
+
+        if (e.argNames[0]) {
+            out += ",\"args\":{";
+            for (std::size_t i = 0; i < kMaxArgs && e.argNames[i]; i++) {
+                if (i > 0)
+                    out += ',';
+                out += '"';
+                out += e.argNames[i];
+                out += "\":";
+                appendNumber(out, e.argValues[i]);
+            }
+            out += '}';
+        }
+        out += '}';
+    }
+    out += "\n]}\n";
+
+    std::ofstream f(file, std::ios::binary | std::ios::trunc);
+    if (!f.is_open())
+        return false;
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(f);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped spans written as Chrome trace events ("X" events in the JSON array
+// format), for chrome://tracing or ui.perfetto.dev. Recording is off until
+// start(); while off a Span is a single relaxed load.
+//
+// Each thread appends to its own ring of kRingEvents events, so spans never
+// contend; once a ring is full the oldest events are overwritten and counted
+// as dropped. stop() gathers every ring and writes the file.
+//
+// Span names, categories and argument names must be string literals (or
+// otherwise outlive the trace): only the pointers are kept.
+class Trace {
+public:
+    static constexpr std::size_t kRingEvents = 1 << 16;
+    static constexpr std::size_t kMaxArgs = 2;
+
+    // Starts recording; the events go to `file` at stop().
+    static void start(const std::string& file);
+    // Stops recording and writes the trace. False if nothing was started or
+    // the file cannot be written.
+    static bool stop();
+
+    static bool active() {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    struct Event {
+        const char* name;
+        const char* category;
+        std::uint64_t startNanos;
+        std::uint64_t durationNanos;
+        const char* argNames[kMaxArgs];
+        std::uint64_t argValues[kMaxArgs];
+    };
+
+    struct Ring {
+        std::mutex mutex;               // owner while appending, stop() while reading
+        std::vector<Event> events;
+        std::uint64_t written = 0;
+        std::uint32_t lane = 0;         // the trace's "tid"
+        std::atomic<bool> inUse{ false };
+    };
+
+    class Span {
+    public:
+        Span(const char* name, const char* category)
+            : name(active() ? name : nullptr), category(category) {
+            if (this->name)
+                started = std::chrono::steady_clock::now();
+        }
+
+        ~Span() {
+            if (name)
+                record(*this);
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        // Shown under "args" in the viewer; the first kMaxArgs calls are kept.
+        void arg(const char* key, std::uint64_t value) {
+            if (name && args < kMaxArgs) {
+                argNames[args] = key;
+                argValues[args] = value;
+                args++;
+            }
+        }
+
+    private:
+        friend class Trace;
+
+        const char* name;
+        const char* category;
+        std::chrono::steady_clock::time_point started;
+        std::size_t args = 0;
+        const char* argNames[kMaxArgs];
+        std::uint64_t argValues[kMaxArgs];
+    };
+
+private:
+    static inline std::atomic<bool> recording{ false };
+
+    struct RingLease {
+        Ring* ring = nullptr;
+        ~RingLease() {
+            if (ring)
+                ring->inUse.store(false, std::memory_order_release);
+        }
+    };
+
+    static Ring* attach();
+    static void record(const Span& span);
+};
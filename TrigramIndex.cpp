@@ -0,0 +1,193 @@
+#include "TrigramIndex.h"
+
+#include <algorithm>
+
+#include "Product.h"
+
+void TrigramIndex::Postings::push_back(DocId id) {
+    if (ids.size() % kSkipStride == 0)
+        skips.push_back(id);
+    ids.push_back(id);
+}
+
+namespace {
+    constexpr std::size_t kMinDeadForRebuild = 1024;
+
+    using DocIds = std::vector<std::uint32_t>;
+
+    // Keeps in `candidates` only the ids also present in `list`. Both are
+    // sorted; a much longer list is probed through its skip array instead of
+    // being merged element by element.
+    void intersectInto(DocIds& candidates, const DocIds& list, const DocIds& skips, std::size_t stride) {
+        auto out = candidates.begin();
+
+        if (list.size() > candidates.size() * 64) {
+            auto skip = skips.begin();
+            for (std::uint32_t id : candidates) {
+                // Gallop forward from the previous block; candidates ascend.
+                auto bound = skip;
+                std::size_t step = 1;
+                while (bound != skips.end() && *bound <= id) {
+                    skip = bound;
+                    bound += std::min<std::size_t>(step, skips.end() - bound);
+                    step *= 2;
+                }
+                skip = std::upper_bound(skip, bound, id);
+                if (skip == skips.begin())
+                    continue;
+                --skip;
+
+                std::size_t block = static_cast<std::size_t>(skip - skips.begin());
+                auto first = list.begin() + block * stride;
+                auto last = list.begin() + std::min(list.size(), (block + 1) * stride);
+                auto hit = std::lower_bound(first, last, id);
+                if (hit != last && *hit == id)
+                    *out++ = id;
+            }
+        }
+        else {
+            auto a = candidates.begin();
+            auto b = list.begin();
+            while (a != candidates.end() && b != list.end()) {
+                if (*a < *b)
+                    ++a;
+                else if (*b < *a)
+                    ++b;
+                else {
+                    *out++ = *a;
+                    ++a;
+                    ++b;
+                }
+            }
+        }
+
+        candidates.erase(out, candidates.end());
+    }
+}
+
+TrigramIndex::TrigramIndex()
+    : deadDocs(0) {
+}
+
+void TrigramIndex::gramsOf(std::string_view text, std::vector<Gram>& out) {
+    out.clear();
+    if (text.size() < kGramSize)
+        return;
+
+    for (std::size_t i = 0; i + kGramSize <= text.size(); i++) {
+        out.push_back(
+            (static_cast<Gram>(static_cast<unsigned char>(text[i])) << 16) |
+            (static_cast<Gram>(static_cast<unsigned char>(text[i + 1])) << 8) |
+            static_cast<Gram>(static_cast<unsigned char>(text[i + 2])));
+    }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+void TrigramIndex::index(const Product* product) {
+    const std::string& name = product->getName();
+
+    DocId id = static_cast<DocId>(docs.size());
+    docs.push_back(Doc{ product, static_cast<std::uint32_t>(names.size()), static_cast<std::uint32_t>(name.size()) });
+    names += name;
+    docIds[product] = id;
+
+    static thread_local std::vector<Gram> grams;
+    gramsOf(name, grams);
+    for (Gram g : grams)
+        postings[g].push_back(id);
+}
+
+void TrigramIndex::add(const Product* product) {
+    if (!product || docIds.count(product))
+        return;
+
+    index(product);
+}
+
+void TrigramIndex::remove(const Product* product) {
+    auto it = docIds.find(product);
+    if (it == docIds.end())
+        return;
+
+    docs[it->second].product = nullptr;
+    docIds.erase(it);
+    ++deadDocs;
+
+    if (deadDocs >= kMinDeadForRebuild && deadDocs > docIds.size())
+        rebuild();
+}
+
+void TrigramIndex::clear() {
+    docs.clear();
+    names.clear();
+    docIds.clear();
+    postings.clear();
+    deadDocs = 0;
+}
+
+void TrigramIndex::reserve(std::size_t count) {
+    docs.reserve(count);
+    docIds.reserve(count);
+}
+
+// A map node is taken as its value plus a next pointer and a cached hash.
+std::size_t TrigramIndex::bytes() const {
+    const std::size_t nodeExtra = 2 * sizeof(void*);
+    std::size_t used = docs.capacity() * sizeof(Doc) + names.capacity() +
+        docIds.bucket_count() * sizeof(void*) + docIds.size() * (sizeof(std::pair<const Product* const, DocId>) + nodeExtra) +
+        postings.bucket_count() * sizeof(void*) + postings.size() * (sizeof(std::pair<const Gram, Postings>) + nodeExtra);
+    for (const auto& entry : postings)
+        used += (entry.second.ids.capacity() + entry.second.skips.capacity()) * sizeof(DocId);
+    return used;
+}
+
+void TrigramIndex::rebuild() {
+    std::vector<const Product*> live;
+    live.reserve(docIds.size());
+    for (const Doc& d : docs) {
+        if (d.product)
+            live.push_back(d.product);
+    }
+
+    clear();
+    reserve(live.size());
+    for (const Product* p : live)
+        index(p);
+}
+
+std::vector<const Product*> TrigramIndex::search(std::string_view term) const {
+    std::vector<const Product*> result;
+
+    std::vector<Gram> grams;
+    gramsOf(term, grams);
+    if (grams.empty())
+        return result;
+
+    std::vector<const Postings*> lists;
+    lists.reserve(grams.size());
+    for (Gram g : grams) {
+        auto it = postings.find(g);
+        if (it == postings.end())
+            return result;
+        lists.push_back(&it->second);
+    }
+
+    std::sort(lists.begin(), lists.end(), [](const Postings* a, const Postings* b) {
+        return a->ids.size() < b->ids.size();
+    });
+
+    std::vector<DocId> candidates(lists.front()->ids);
+    for (std::size_t i = 1; i < lists.size() && !candidates.empty(); i++)
+        intersectInto(candidates, lists[i]->ids, lists[i]->skips, Postings::kSkipStride);
+
+    // Trigram hits are only candidates; the substring itself is confirmed here.
+    for (DocId id : candidates) {
+        const Doc& d = docs[id];
+        std::string_view name(names.data() + d.nameOffset, d.nameLength);
+        if (d.product && name.find(term) != std::string_view::npos)
+            result.push_back(d.product);
+    }
+    return result;
+}
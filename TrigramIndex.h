@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Product;
+
+// Inverted index from byte trigrams of product names to the products that
+// contain them. Removed products are tombstoned and purged by a periodic
+// rebuild, so posting lists stay sorted by document id at all times.
+class TrigramIndex {
+public:
+    static constexpr std::size_t kGramSize = 3;
+
+    TrigramIndex();
+
+    void add(const Product* product);
+    void remove(const Product* product);
+    void clear();
+    void reserve(std::size_t count);
+    // Heap bytes held by the index, hash-map nodes estimated.
+    std::size_t bytes() const;
+
+    // Products whose name contains term. Only valid for terms of at least
+    // kGramSize bytes; shorter terms have no trigrams to intersect.
+    std::vector<const Product*> search(std::string_view term) const;
+
+private:
+    using Gram = std::uint32_t;
+    using DocId = std::uint32_t;
+
+    // Sorted doc ids plus every kSkipStride-th id, so probing a long list
+    // touches the small skip array and one block instead of a binary search
+    // over the whole list.
+    struct Postings {
+        static constexpr std::size_t kSkipStride = 64;
+
+        std::vector<DocId> ids;
+        std::vector<DocId> skips;
+
+        void push_back(DocId id);
+    };
+
+    struct Doc {
+        const Product* product;
+        std::uint32_t nameOffset;
+        std::uint32_t nameLength;
+    };
+
+    // Names are copied into one arena so candidate verification scans
+    // contiguous bytes instead of chasing each product's heap string.
+    std::vector<Doc> docs;
+    std::string names;
+    std::unordered_map<const Product*, DocId> docIds;
+    std::unordered_map<Gram, Postings> postings;
+    std::size_t deadDocs;
+
+    static void gramsOf(std::string_view text, std::vector<Gram>& out);
+
+    void index(const Product* product);
+    void rebuild();
+};
@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+# Batch lines that are not valid UTF-8.
+#
+#   tests/batch_invalid_utf8.sh <TechWarehouse binary> [warehouse.json]
+#
+# Runs a batch file with raw bytes 0xFF 0xFE as a command line, as the serial
+# of a find and inside a JSON line, between two valid commands. Each bad line
+# fails on its own with "ok":false, the commands around it still run, the
+# results are valid UTF-8 and the run ends with its summary and exit status 0.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <TechWarehouse binary> [warehouse.json]" >&2
+    exit 2
+fi
+
+TW=$(realpath "$1")
+DATA=$(realpath "${2:-$(dirname "$0")/../warehouse.json}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+SERIAL=$(grep -o '"serialNumber"[^"]*"[^"]*"' "$DATA" | sed 's/.*"\([^"]*\)"$/\1/' | head -n 1)
+if [ -z "$SERIAL" ]; then
+    echo "No products in $DATA" >&2
+    exit 2
+fi
+
+cp "$DATA" "$WORK/warehouse.json"
+cd "$WORK" || exit 2
+
+printf 'find %s\n\xff\xfe\nfind \xff\xfe\n{"op":"find","serial":"\xff"}\nfind %s\n' "$SERIAL" "$SERIAL" >"$WORK/ops.txt"
+"$TW" --batch "$WORK/ops.txt" >"$WORK/out.txt" 2>"$WORK/log.txt"
+status=$?
+
+failures=0
+check() {
+    local what=$1 line=$2 pattern=$3
+    if grep -q "$pattern" <<<"$line"; then
+        echo "ok   $what"
+    else
+        echo "FAIL $what: $line"
+        failures=$((failures + 1))
+    fi
+}
+
+results=$(cat "$WORK/out.txt")
+check "exit status" "$status" '^0$'
+check "find before the bad lines" "$(sed -n 1p <<<"$results")" "\"ok\":true.*\"$SERIAL\""
+check "non-UTF-8 op" "$(sed -n 2p <<<"$results")" '"line":2.*"ok":false'
+check "unknown op not echoed" "$(sed -n 2p <<<"$results")" '^{"error":"unknown op","line":2,"ok":false}$'
+check "non-UTF-8 serial" "$(sed -n 3p <<<"$results")" '"line":3.*"ok":false'
+check "non-UTF-8 JSON line" "$(sed -n 4p <<<"$results")" '"line":4.*"ok":false'
+check "find after the bad lines" "$(sed -n 5p <<<"$results")" "\"ok\":true.*\"$SERIAL\""
+check "summary written" "$(cat "$WORK/log.txt")" '5 commands'
+
+if ! iconv -f UTF-8 -t UTF-8 "$WORK/out.txt" >/dev/null 2>&1; then
+    echo "FAIL results are not valid UTF-8"
+    failures=$((failures + 1))
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "$failures checks failed; log:"
+    cat "$WORK/log.txt"
+    exit 1
+fi
+echo "All checks passed."
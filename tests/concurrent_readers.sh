@@ -0,0 +1,149 @@
+#!/usr/bin/env bash
+# Readers running next to each other and next to stock movements.
+#
+#   tests/concurrent_readers.sh <TechWarehouse binary> [warehouse.json]
+#
+# Starts --serve on a local TCP port with several workers and opens three
+# connections at once:
+#
+#   - one moves stock on the first products, so quantity changes queue
+#   - one runs queries, which fold those changes into the quantity index
+#   - one runs memory, which reads that index and the queues
+#
+# A batch run adds $PRODUCTS phones first, so a memory command takes long
+# enough for the others to run in the middle of it even on one core.
+#
+# Every command must succeed and the server must still be running at the
+# end. Built with -fsanitize=thread, the server also has to run without a
+# ThreadSanitizer report (they go to the log); run it with
+# TSAN_OPTIONS=detect_deadlocks=0, as taking every shard holds more locks
+# at once than the deadlock detector can track.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <TechWarehouse binary> [warehouse.json]" >&2
+    exit 2
+fi
+
+TW=$(realpath "$1")
+DATA=$(realpath "${2:-$(dirname "$0")/../warehouse.json}")
+WORK=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill "$SERVER" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+ROUNDS=${ROUNDS:-500}
+PRODUCTS=${PRODUCTS:-20000}
+PORT=$((20000 + $$ % 20000))
+
+mapfile -t SERIALS < <(grep -o '"serialNumber"[^"]*"[^"]*"' "$DATA" | sed 's/.*"\([^"]*\)"$/\1/' | head -n 3)
+if [ ${#SERIALS[@]} -eq 0 ]; then
+    echo "No products in $DATA" >&2
+    exit 2
+fi
+
+cp "$DATA" "$WORK/warehouse.json"
+cd "$WORK" || exit 2
+
+for i in $(seq "$PRODUCTS"); do
+    echo "add {\"type\":\"Phone\",\"serialNumber\":\"READERS-$i\",\"name\":\"Readers Phone $i\",\"brand\":\"Test\",\"price\":$((i % 900 + 100)).5,\"quantity\":$((i % 50)),\"categoryId\":2,\"cpu\":\"Test SoC\",\"storageGB\":128,\"has5G\":true}"
+done >"$WORK/setup.txt"
+if ! "$TW" --batch "$WORK/setup.txt" >/dev/null 2>"$WORK/setup.log"; then
+    echo "Setup batch failed; log:" >&2
+    head -n 60 "$WORK/setup.log" >&2
+    exit 1
+fi
+
+"$TW" --serve "tcp:$PORT" --workers 4 >"$WORK/log.txt" 2>&1 &
+SERVER=$!
+for _ in $(seq 50); do
+    grep -q "Serving on" "$WORK/log.txt" && break
+    sleep 0.1
+done
+if ! grep -q "Serving on" "$WORK/log.txt"; then
+    echo "Server did not start; log:" >&2
+    head -n 60 "$WORK/log.txt" >&2
+    exit 1
+fi
+
+movements() {
+    local round i
+    for round in $(seq "$ROUNDS"); do
+        i=$((round % ${#SERIALS[@]}))
+        echo "stock-in ${SERIALS[$i]} $((round % 7 + 1))"
+        echo "stock-out ${SERIALS[$i]} 1"
+    done
+}
+
+queries() {
+    local round
+    for round in $(seq "$ROUNDS"); do
+        echo "query quantity>0 ORDER BY quantity DESC LIMIT 5"
+    done
+}
+
+memory() {
+    local round
+    for round in $(seq "$ROUNDS"); do
+        echo "memory"
+    done
+}
+
+# client <name> <commands> <expected results>: sends the commands while
+# reading the results, so neither side waits on a full socket buffer.
+client() {
+    local name=$1 commands=$2 expected=$3
+    exec 3<>"/dev/tcp/127.0.0.1/$PORT" || return 1
+    $commands >&3 &
+    timeout 120 head -n "$expected" <&3 >"$WORK/$name.txt"
+    exec 3<&-
+}
+
+client movements movements $((ROUNDS * 2)) &
+first=$!
+client queries queries "$ROUNDS" &
+second=$!
+client memory memory "$ROUNDS" &
+third=$!
+wait $first $second $third
+
+failures=0
+check() {
+    local what=$1 name=$2 expected=$3
+    local total ok
+    total=$(wc -l <"$WORK/$name.txt")
+    ok=$(grep -c '"ok":true' "$WORK/$name.txt")
+    if [ "$total" -eq "$expected" ] && [ "$ok" -eq "$expected" ]; then
+        echo "ok   $what ($ok results)"
+    else
+        echo "FAIL $what: $ok of $expected ok, $total results"
+        grep -v '"ok":true' "$WORK/$name.txt" | head -n 3
+        failures=$((failures + 1))
+    fi
+}
+
+check "stock movements" movements $((ROUNDS * 2))
+check "queries next to them" queries "$ROUNDS"
+check "memory next to both" memory "$ROUNDS"
+
+if kill -0 "$SERVER" 2>/dev/null; then
+    echo "ok   server still running"
+else
+    echo "FAIL server stopped"
+    failures=$((failures + 1))
+fi
+kill "$SERVER" 2>/dev/null
+wait "$SERVER" 2>/dev/null
+SERVER=
+
+if grep -q "ThreadSanitizer" "$WORK/log.txt"; then
+    echo "FAIL ThreadSanitizer report"
+    failures=$((failures + 1))
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "$failures checks failed; log:"
+    head -n 60 "$WORK/log.txt"
+    exit 1
+fi
+echo "All checks passed."
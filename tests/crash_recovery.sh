@@ -0,0 +1,113 @@
+#!/usr/bin/env bash
+# Crash-recovery test for checkpoints.
+#
+#   tests/crash_recovery.sh <TechWarehouse binary> [warehouse.json]
+#
+# Two directories start from the same warehouse.json. Each round runs the
+# same batch of changes ending in "checkpoint" in both. In one directory,
+# TW_CRASH_POINT kills the process (SIGKILL) at one step of that checkpoint:
+#
+#   checkpoint.sealed   old journal segments synced, snapshot not written
+#   snapshot.synced     warehouse.snap.tmp complete, not yet renamed
+#   snapshot.renamed    new warehouse.snap in place, directory not synced
+#   checkpoint.written  snapshot done, sealed segments not yet removed
+#   journal.removing    first sealed segment removed, the rest still there
+#
+# The crashed directory is then restarted, which replays the journal and
+# checkpoints on exit. Both snapshots are converted back to JSON with
+# --convert and must be identical. Rounds build on each other, so later
+# ones recover on top of files earlier crashes left behind.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <TechWarehouse binary> [warehouse.json]" >&2
+    exit 2
+fi
+
+TW=$(realpath "$1")
+DATA=$(realpath "${2:-$(dirname "$0")/../warehouse.json}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+SERIALS=($(grep -o '"serialNumber"[^"]*"[^"]*"' "$DATA" | sed 's/.*"\([^"]*\)"$/\1/' | head -n 8))
+if [ ${#SERIALS[@]} -lt 2 ]; then
+    echo "No products in $DATA" >&2
+    exit 2
+fi
+
+# Adds, updates, removes and stock movements, different in every round.
+changes() {
+    local round=$1
+    local i
+    for i in "${!SERIALS[@]}"; do
+        echo "stock-in ${SERIALS[$i]} $((round * 3 + i + 1))"
+        echo "stock-out ${SERIALS[$i]} $((round + i))"
+    done
+    echo "add {\"type\":\"Phone\",\"serialNumber\":\"CRASH-$round\",\"name\":\"Crash Phone $round\",\"brand\":\"Test\",\"price\":$((100 + round)).5,\"quantity\":$round,\"categoryId\":2,\"cpu\":\"Test SoC\",\"storageGB\":128,\"has5G\":true}"
+    echo "update CRASH-$round {\"name\":\"Crash Phone $round v2\",\"brand\":\"Test\",\"price\":$((200 + round)),\"quantity\":$((round * 2)),\"categoryId\":2,\"cpu\":\"Test SoC\",\"storageGB\":256,\"has5G\":false,\"serialNumber\":\"CRASH-$round\"}"
+    if [ "$round" -gt 1 ]; then
+        echo "remove CRASH-$((round - 1))"
+    fi
+    echo "{\"op\":\"stock-in\",\"serial\":\"${SERIALS[0]}\",\"amount\":7}"
+    echo "checkpoint"
+}
+
+# run <dir> <TechWarehouse args...>, with $CRASH_POINT as TW_CRASH_POINT.
+run() {
+    local dir=$1
+    shift
+    (cd "$dir" && TW_CRASH_POINT="${CRASH_POINT:-}" "$TW" "$@") >>"$WORK/log.txt" 2>&1
+}
+
+exportJson() {
+    (cd "$1" && "$TW" --convert warehouse.snap "$2" >>"$WORK/log.txt" 2>&1)
+}
+
+mkdir "$WORK/expected" "$WORK/crashed"
+for dir in expected crashed; do
+    cp "$DATA" "$WORK/$dir/warehouse.json"
+    # Start from a snapshot, so the rounds are the only checkpoints.
+    run "$WORK/$dir" --batch /dev/null || { echo "Initial run failed in $dir" >&2; cat "$WORK/log.txt" >&2; exit 1; }
+done
+
+failures=0
+round=0
+for point in checkpoint.sealed snapshot.synced snapshot.renamed checkpoint.written journal.removing; do
+    round=$((round + 1))
+    changes "$round" >"$WORK/ops.txt"
+
+    run "$WORK/expected" --batch "$WORK/ops.txt"
+
+    CRASH_POINT=$point run "$WORK/crashed" --batch "$WORK/ops.txt" 2>/dev/null
+    status=$?
+    if [ $status -ne 137 ]; then
+        echo "FAIL $point: exit status $status, expected SIGKILL (137)"
+        failures=$((failures + 1))
+        continue
+    fi
+    segments=$(ls "$WORK/crashed" | grep -c '^warehouse\.journal\.')
+
+    if ! run "$WORK/crashed" --batch /dev/null; then
+        echo "FAIL $point: restart failed"
+        failures=$((failures + 1))
+        continue
+    fi
+
+    exportJson "$WORK/expected" "$WORK/expected.json"
+    exportJson "$WORK/crashed" "$WORK/recovered.json"
+    if cmp -s "$WORK/expected.json" "$WORK/recovered.json"; then
+        echo "ok   $point (${segments} journal segments left by the crash)"
+    else
+        echo "FAIL $point: recovered inventory differs"
+        diff "$WORK/expected.json" "$WORK/recovered.json" | head -n 20
+        failures=$((failures + 1))
+    fi
+done
+
+if [ $failures -ne 0 ]; then
+    echo "$failures of $round crash points failed; log:"
+    cat "$WORK/log.txt"
+    exit 1
+fi
+echo "All $round crash points recovered."
@@ -0,0 +1,113 @@
+#!/usr/bin/env bash
+# All-or-nothing stock batches.
+#
+#   tests/stock_batch.sh <TechWarehouse binary> [warehouse.json]
+#
+# Runs stock-batch commands against the first products of warehouse.json:
+#
+#   - a batch with one line short of stock and one unknown serial is refused
+#     as a whole: every quantity it touches stays as it was, even the lines
+#     that were fine on their own
+#   - a valid batch moves every quantity, lines checked against the ones
+#     before them
+#   - with TW_CRASH_POINT=batch.logged the process is killed (SIGKILL) right
+#     after the batch reached the journal and before it was applied; the
+#     restart replays it as one journal record and every line is there
+#
+# The crash run uses --journal-sync every, so the record is on disk when
+# the batch is journaled.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <TechWarehouse binary> [warehouse.json]" >&2
+    exit 2
+fi
+
+TW=$(realpath "$1")
+DATA=$(realpath "${2:-$(dirname "$0")/../warehouse.json}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+SERIALS=($(grep -o '"serialNumber"[^"]*"[^"]*"' "$DATA" | sed 's/.*"\([^"]*\)"$/\1/' | head -n 3))
+if [ ${#SERIALS[@]} -lt 3 ]; then
+    echo "Need 3 products in $DATA" >&2
+    exit 2
+fi
+A=${SERIALS[0]}
+B=${SERIALS[1]}
+C=${SERIALS[2]}
+
+cp "$DATA" "$WORK/warehouse.json"
+cd "$WORK" || exit 2
+
+# batch [TechWarehouse args...] -- <commands...>: runs the commands, one per
+# line, and prints the JSON results.
+batch() {
+    local args=()
+    while [ "$1" != "--" ]; do
+        args+=("$1")
+        shift
+    done
+    shift
+    printf '%s\n' "$@" >"$WORK/ops.txt"
+    "$TW" "${args[@]}" --batch "$WORK/ops.txt" 2>>"$WORK/log.txt"
+}
+
+quantities() {
+    batch -- "find $A" "find $B" "find $C" | grep -o '"quantity":[0-9-]*' | cut -d: -f2 | tr '\n' ' '
+}
+
+failures=0
+check() {
+    local what=$1 line=$2 pattern=$3
+    if grep -q -- "$pattern" <<<"$line"; then
+        echo "ok   $what"
+    else
+        echo "FAIL $what: $line"
+        failures=$((failures + 1))
+    fi
+}
+
+read -r qa qb qc <<<"$(quantities)"
+if [ -z "$qc" ]; then
+    echo "find failed" >&2
+    cat "$WORK/log.txt" >&2
+    exit 1
+fi
+
+line() {
+    printf '{"serial":"%s","delta":%s}' "$1" "$2"
+}
+
+result=$(batch -- "stock-batch [$(line "$A" 5),$(line "$B" 1),$(line "$C" -$((qc + 1))),$(line NO-SUCH-SERIAL 1)]")
+check "bad batch refused" "$result" '"ok":false'
+check "bad batch line statuses" "$result" '"lines":\["ok","ok","not enough quantity","product not found"\]'
+check "bad batch changed nothing" "$(quantities)" "^$qa $qb $qc $"
+
+result=$(batch -- "{\"op\":\"stock-batch\",\"lines\":[$(line "$A" 5),$(line "$B" 4),$(line "$B" -3)]}")
+check "valid batch applied" "$result" '"ok":true'
+qa=$((qa + 5))
+qb=$((qb + 1))
+check "valid batch moved every quantity" "$(quantities)" "^$qa $qb $qc $"
+
+# A fresh snapshot and an empty journal, so the crash run replays nothing first.
+batch -- "checkpoint" >/dev/null
+
+: >"$WORK/log.txt"
+printf '%s\n' "stock-batch [$(line "$A" 3),$(line "$B" -1),$(line "$C" 2)]" >"$WORK/ops.txt"
+{ (TW_CRASH_POINT=batch.logged "$TW" --journal-sync every --batch "$WORK/ops.txt") >/dev/null 2>&1; status=$?; } 2>/dev/null
+check "killed at batch.logged" "$status" '^137$'
+
+qa=$((qa + 3))
+qb=$((qb - 1))
+qc=$((qc + 2))
+check "crashed batch replayed in full" "$(quantities)" "^$qa $qb $qc $"
+check "crashed batch is one journal record" "$(cat "$WORK/log.txt")" 'Replayed 1 journal records'
+
+if [ $failures -ne 0 ]; then
+    echo "$failures checks failed; log:"
+    cat "$WORK/log.txt"
+    exit 1
+fi
+echo "All checks passed."
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+# Stock IN at the INT_MAX edge.
+#
+#   tests/stock_overflow.sh <TechWarehouse binary> [warehouse.json]
+#
+# Fills the first product up to exactly INT_MAX, then checks that one more
+# unit is refused by a plain stock-in and by a JSON batch line, and that
+# the refused changes never reach the journal or the snapshot: after a
+# restart the quantity is still INT_MAX.
+
+set -u
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <TechWarehouse binary> [warehouse.json]" >&2
+    exit 2
+fi
+
+TW=$(realpath "$1")
+DATA=$(realpath "${2:-$(dirname "$0")/../warehouse.json}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+INT_MAX=2147483647
+SERIAL=$(grep -o '"serialNumber"[^"]*"[^"]*"' "$DATA" | sed 's/.*"\([^"]*\)"$/\1/' | head -n 1)
+if [ -z "$SERIAL" ]; then
+    echo "No products in $DATA" >&2
+    exit 2
+fi
+
+cp "$DATA" "$WORK/warehouse.json"
+cd "$WORK" || exit 2
+
+# batch <commands...>: runs them, one per line, and prints the JSON results.
+batch() {
+    printf '%s\n' "$@" >"$WORK/ops.txt"
+    "$TW" --batch "$WORK/ops.txt" 2>>"$WORK/log.txt"
+}
+
+quantity=$(batch "find $SERIAL" | grep -o '"quantity":[0-9-]*' | head -n 1 | cut -d: -f2)
+if [ -z "$quantity" ]; then
+    echo "find $SERIAL failed" >&2
+    cat "$WORK/log.txt" >&2
+    exit 1
+fi
+
+failures=0
+check() {
+    local what=$1 line=$2 pattern=$3
+    if grep -q "$pattern" <<<"$line"; then
+        echo "ok   $what"
+    else
+        echo "FAIL $what: $line"
+        failures=$((failures + 1))
+    fi
+}
+
+results=$(batch \
+    "stock-in $SERIAL $((INT_MAX - quantity))" \
+    "stock-in $SERIAL 1" \
+    "{\"op\":\"stock-in\",\"serial\":\"$SERIAL\",\"amount\":1}" \
+    "stock-in $SERIAL $INT_MAX" \
+    "find $SERIAL")
+
+check "fill up to INT_MAX" "$(sed -n 1p <<<"$results")" "\"ok\":true.*\"quantity\":$INT_MAX"
+check "stock-in 1 past INT_MAX" "$(sed -n 2p <<<"$results")" '"ok":false'
+check "JSON stock-in 1 past INT_MAX" "$(sed -n 3p <<<"$results")" '"ok":false'
+check "stock-in INT_MAX past INT_MAX" "$(sed -n 4p <<<"$results")" '"ok":false'
+check "quantity unchanged" "$(sed -n 5p <<<"$results")" "\"quantity\":$INT_MAX"
+
+# The restart replays the journal on top of the snapshot of the first run.
+check "quantity after restart" "$(batch "find $SERIAL")" "\"quantity\":$INT_MAX"
+
+if [ $failures -ne 0 ]; then
+    echo "$failures checks failed; log:"
+    cat "$WORK/log.txt"
+    exit 1
+fi
+echo "All checks passed."